@@ -0,0 +1,201 @@
+#ifndef SBG__CLOCK_ESTIMATOR_HPP_
+#define SBG__CLOCK_ESTIMATOR_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace sbg {
+
+// Estima la relacion entre el reloj del dispositivo (timeSinceReset, en ms) y el reloj monotono del host:
+//   llegada = muestra + offset + deriva * muestra + retardo
+// El retardo (transmision serie, planificador, executor) siempre es positivo, asi que de cada ventana
+// de muestras solo se usa la que llega antes (envolvente inferior). Sobre esos puntos se ajusta una recta
+// por minimos cuadrados con olvido exponencial y se descartan los puntos que se alejan demasiado de ella.
+// El sello de cada muestra es la recta evaluada en su tiempo de dispositivo: sin jitter del host.
+struct ClockEstimatorConfig {
+  std::size_t window = 50;                // muestras por punto de la envolvente inferior (0.1 s a 500 Hz)
+  double forgetting = 0.99;               // factor de olvido por punto (constante de ~100 puntos)
+  double outlier_sigma = 5.0;             // umbral de rechazo en desviaciones tipicas del residuo
+  int64_t min_outlier_ns = 200000;        // umbral minimo de rechazo (0.2 ms)
+  int max_consecutive_outliers = 20;      // puntos rechazados seguidos antes de reiniciar el ajuste
+};
+
+struct ClockEstimatorState {
+  bool valid = false;                     // hay al menos un punto en el ajuste
+  int64_t offset_ns = 0;                  // llegada minima - tiempo de dispositivo, en el ultimo punto
+  double drift_ppm = 0.0;                 // deriva del reloj del dispositivo respecto al host
+  double residual_ns = 0.0;               // desviacion tipica del residuo de los puntos aceptados
+  uint64_t samples = 0;                   // muestras recibidas
+  uint64_t accepted = 0;                  // puntos de la envolvente aceptados
+  uint64_t rejected = 0;                  // puntos de la envolvente rechazados
+  uint64_t wraps = 0;                     // vueltas del contador de 32 bits en ms
+  uint64_t resets = 0;                    // reinicios del dispositivo o del ajuste
+};
+
+class ClockEstimator {
+public:
+  explicit ClockEstimator(const ClockEstimatorConfig & config = ClockEstimatorConfig())
+  : config_(config)
+  {
+    if (config_.window == 0) {
+      config_.window = 1;
+    }
+  }
+
+  // Añade una muestra y devuelve su sello en tiempo monotono del host (ns).
+  // Mientras no hay ajuste devuelve la hora de llegada.
+  int64_t stamp(uint32_t device_ms, int64_t host_ns)
+  {
+    const int64_t device_ns = unwrap(device_ms) * 1000000;
+    state_.samples++;
+
+    const int64_t delay_ns = host_ns - device_ns;
+    if (window_count_ == 0 || delay_ns < window_min_delay_ns_) {
+      window_min_delay_ns_ = delay_ns;
+      window_min_device_ns_ = device_ns;
+    }
+    if (++window_count_ >= config_.window) {
+      addPoint(window_min_device_ns_, window_min_delay_ns_);
+      window_count_ = 0;
+    }
+
+    return state_.valid ? device_ns + predictDelay(device_ns) : host_ns;
+  }
+
+  const ClockEstimatorState & state() const {return state_;}
+
+  void reset()
+  {
+    resetFit();
+    last_ms_valid_ = false;
+    high_ms_ = 0;
+    window_count_ = 0;
+    state_.resets++;
+  }
+
+private:
+  // Quita las vueltas del contador de 32 bits en ms (cada ~49.7 dias).
+  // Un salto hacia atras que no es una vuelta es un reinicio del dispositivo.
+  int64_t unwrap(uint32_t device_ms)
+  {
+    if (last_ms_valid_ && device_ms < last_ms_) {
+      if (last_ms_ - device_ms > 0x80000000u) {
+        high_ms_ += 0x100000000ull;
+        state_.wraps++;
+      } else {
+        reset();
+      }
+    }
+    last_ms_ = device_ms;
+    last_ms_valid_ = true;
+    return static_cast<int64_t>(high_ms_) + device_ms;
+  }
+
+  // Retardo predicho por la recta para un tiempo de dispositivo
+  int64_t predictDelay(int64_t device_ns) const
+  {
+    const double x = (device_ns - x_ref_ns_) * 1e-9;
+    return y_ref_ns_ + static_cast<int64_t>(std::llround((a_ + b_ * x) * 1e9));
+  }
+
+  void addPoint(int64_t device_ns, int64_t delay_ns)
+  {
+    if (!state_.valid) {
+      startFit(device_ns, delay_ns);
+      return;
+    }
+
+    // Rechazo de puntos aberrantes respecto a la recta actual
+    const double residual_ns = static_cast<double>(delay_ns - predictDelay(device_ns));
+    const double gate_ns = std::max(config_.outlier_sigma * state_.residual_ns,
+                                    static_cast<double>(config_.min_outlier_ns));
+    if (std::fabs(residual_ns) > gate_ns) {
+      state_.rejected++;
+      if (++consecutive_outliers_ > config_.max_consecutive_outliers) {
+        // La recta ya no describe los datos (salto de reloj): se empieza de nuevo
+        state_.resets++;
+        startFit(device_ns, delay_ns);
+      }
+      return;
+    }
+    consecutive_outliers_ = 0;
+    state_.accepted++;
+    state_.residual_ns = std::sqrt(0.95 * state_.residual_ns * state_.residual_ns +
+                                   0.05 * residual_ns * residual_ns);
+
+    // Se recentran las sumas en el nuevo punto para no perder precision con tiempos grandes
+    const double shift = (device_ns - x_ref_ns_) * 1e-9;
+    sx_ -= s0_ * shift;
+    sxx_ += -2.0 * shift * (sx_ + s0_ * shift) + s0_ * shift * shift;
+    sxy_ -= shift * sy_;
+    x_ref_ns_ = device_ns;
+
+    // Olvido exponencial y nuevo punto en x = 0
+    const double lambda = config_.forgetting;
+    const double y = (delay_ns - y_ref_ns_) * 1e-9;
+    s0_ = lambda * s0_ + 1.0;
+    sx_ = lambda * sx_;
+    sy_ = lambda * sy_ + y;
+    sxx_ = lambda * sxx_;
+    sxy_ = lambda * sxy_;
+
+    const double det = s0_ * sxx_ - sx_ * sx_;
+    if (det > std::numeric_limits<double>::epsilon() * s0_ * sxx_) {
+      b_ = (s0_ * sxy_ - sx_ * sy_) / det;
+      a_ = (sy_ - b_ * sx_) / s0_;
+    } else {
+      a_ = sy_ / s0_;
+    }
+
+    state_.offset_ns = predictDelay(device_ns);
+    state_.drift_ppm = b_ * 1e6;
+  }
+
+  void startFit(int64_t device_ns, int64_t delay_ns)
+  {
+    resetFit();
+    x_ref_ns_ = device_ns;
+    y_ref_ns_ = delay_ns;
+    s0_ = 1.0;
+    state_.valid = true;
+    state_.accepted++;
+    state_.offset_ns = delay_ns;
+  }
+
+  void resetFit()
+  {
+    s0_ = sx_ = sy_ = sxx_ = sxy_ = 0.0;
+    a_ = b_ = 0.0;
+    consecutive_outliers_ = 0;
+    state_.valid = false;
+    state_.drift_ppm = 0.0;
+    state_.residual_ns = 0.0;
+  }
+
+  ClockEstimatorConfig config_;
+  ClockEstimatorState state_;
+
+  // Contador de 32 bits sin vueltas
+  bool last_ms_valid_ = false;
+  uint32_t last_ms_ = 0;
+  uint64_t high_ms_ = 0;
+
+  // Ventana actual de la envolvente inferior
+  std::size_t window_count_ = 0;
+  int64_t window_min_delay_ns_ = 0;
+  int64_t window_min_device_ns_ = 0;
+
+  // Recta retardo = a + b * x, con x en s desde x_ref_ns_ y retardo en s desde y_ref_ns_
+  int64_t x_ref_ns_ = 0;
+  int64_t y_ref_ns_ = 0;
+  double s0_ = 0.0, sx_ = 0.0, sy_ = 0.0, sxx_ = 0.0, sxy_ = 0.0;
+  double a_ = 0.0, b_ = 0.0;
+  int consecutive_outliers_ = 0;
+};
+
+}  // namespace sbg
+
+#endif  // SBG__CLOCK_ESTIMATOR_HPP_
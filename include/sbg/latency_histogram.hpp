@@ -0,0 +1,113 @@
+#ifndef SBG__LATENCY_HISTOGRAM_HPP_
+#define SBG__LATENCY_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace sbg {
+
+// Histograma de latencias log-lineal, como HdrHistogram: cada potencia de dos se divide en
+// SUB_BUCKETS / 2 intervalos iguales, asi el error relativo de cualquier percentil es menor que
+// 2 / SUB_BUCKETS (0.8 %) entre 1 ns y MAX_VALUE_NS, con memoria fija y record() sin reservas.
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 8;
+  static constexpr int64_t SUB_BUCKETS = int64_t(1) << SUB_BUCKET_BITS;
+  static constexpr int MAX_VALUE_BITS = 40;                          // ~18 minutos en ns
+  static constexpr int64_t MAX_VALUE_NS = (int64_t(1) << MAX_VALUE_BITS) - 1;
+
+  LatencyHistogram()
+  : counts_(bucketIndex(MAX_VALUE_NS) + 1, 0)
+  {
+    reset();
+  }
+
+  // Las latencias negativas (relojes desalineados) cuentan como 0, las que exceden el rango como MAX_VALUE_NS
+  void record(int64_t value_ns)
+  {
+    value_ns = std::min(std::max(value_ns, int64_t(0)), MAX_VALUE_NS);
+    counts_[bucketIndex(value_ns)]++;
+    count_++;
+    sum_ += static_cast<double>(value_ns);
+    min_ = std::min(min_, value_ns);
+    max_ = std::max(max_, value_ns);
+  }
+
+  void reset()
+  {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0.0;
+    min_ = std::numeric_limits<int64_t>::max();
+    max_ = 0;
+  }
+
+  uint64_t count() const {return count_;}
+  int64_t min() const {return count_ ? min_ : 0;}
+  int64_t max() const {return max_;}
+  double mean() const {return count_ ? sum_ / static_cast<double>(count_) : 0.0;}
+
+  // Valor por debajo del cual queda el percentil indicado (0-100), el mayor valor equivalente del
+  // intervalo como en HdrHistogram, sin pasar del maximo registrado
+  int64_t percentile(double percent) const
+  {
+    if (count_ == 0) return 0;
+    percent = std::min(std::max(percent, 0.0), 100.0);
+    uint64_t target = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(count_) + 0.5);
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t accumulated = 0;
+    for (std::size_t i = 0; i < counts_.size(); i++) {
+      accumulated += counts_[i];
+      if (accumulated >= target)
+        return std::min(std::max(highestEquivalent(i), min_), max_);
+    }
+    return max_;
+  }
+
+  // Suma otro histograma, por ejemplo el de varias ejecuciones
+  void add(const LatencyHistogram & other)
+  {
+    for (std::size_t i = 0; i < counts_.size(); i++)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.count_) {
+      min_ = std::min(min_, other.min_);
+      max_ = std::max(max_, other.max_);
+    }
+  }
+
+private:
+  // Los valores menores que SUB_BUCKETS tienen un intervalo cada uno; a partir de ahi, la magnitud
+  // es el desplazamiento que deja el valor en [SUB_BUCKETS / 2, SUB_BUCKETS)
+  static std::size_t bucketIndex(int64_t value)
+  {
+    if (value < SUB_BUCKETS) return static_cast<std::size_t>(value);
+    const int magnitude = (63 - __builtin_clzll(static_cast<uint64_t>(value))) - SUB_BUCKET_BITS + 1;
+    const int64_t sub_bucket = value >> magnitude;
+    return static_cast<std::size_t>(magnitude * (SUB_BUCKETS / 2) + sub_bucket);
+  }
+
+  static int64_t highestEquivalent(std::size_t index)
+  {
+    const int64_t i = static_cast<int64_t>(index);
+    if (i < SUB_BUCKETS) return i;
+    const int magnitude = static_cast<int>((i - SUB_BUCKETS) / (SUB_BUCKETS / 2)) + 1;
+    const int64_t sub_bucket = i - magnitude * (SUB_BUCKETS / 2);
+    return ((sub_bucket + 1) << magnitude) - 1;
+  }
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  double sum_ = 0.0;
+  int64_t min_ = 0;
+  int64_t max_ = 0;
+};
+
+}  // namespace sbg
+
+#endif  // SBG__LATENCY_HISTOGRAM_HPP_
@@ -0,0 +1,86 @@
+#ifndef SBG__SPSC_QUEUE_HPP_
+#define SBG__SPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace sbg {
+
+// Cola acotada sin bloqueos para un unico productor y un unico consumidor.
+// El productor es el hilo lector del puerto serie, el consumidor el hilo que publica.
+template <typename T>
+class SpscQueue {
+public:
+  // La capacidad se redondea a la siguiente potencia de dos
+  explicit SpscQueue(std::size_t capacity)
+  : mask_(roundUpPowerOfTwo(capacity < 2 ? 2 : capacity) - 1),
+    buffer_(mask_ + 1)
+  {
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue & operator=(const SpscQueue &) = delete;
+
+  // Solo desde el productor. Devuelve false si la cola esta llena.
+  bool push(const T & value)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_cache_ > mask_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head - tail_cache_ > mask_) {
+        return false;
+      }
+    }
+    buffer_[head & mask_] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Solo desde el consumidor. Devuelve false si la cola esta vacia.
+  bool pop(T & value)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_cache_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail == head_cache_) {
+        return false;
+      }
+    }
+    value = buffer_[tail & mask_];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const
+  {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const {return mask_ + 1;}
+
+private:
+  static std::size_t roundUpPowerOfTwo(std::size_t v)
+  {
+    std::size_t p = 1;
+    while (p < v) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  static constexpr std::size_t kCacheLine = 64;
+
+  const std::size_t mask_;
+  std::vector<T> buffer_;
+
+  // Indices en lineas de cache distintas para evitar false sharing entre hilos
+  alignas(kCacheLine) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_ = 0;     // copia local del productor
+  alignas(kCacheLine) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_ = 0;     // copia local del consumidor
+};
+
+}  // namespace sbg
+
+#endif  // SBG__SPSC_QUEUE_HPP_
@@ -0,0 +1,423 @@
+#ifndef SBG__STATIC_OUTPUT_DECODER_HPP_
+#define SBG__STATIC_OUTPUT_DECODER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <sbgCom/sbgCom.h>
+
+namespace sbg {
+
+// Decodificador generado en compilacion para una mascara y un modo de salida fijos.
+// El orden de los campos en la trama es el de los bits de la mascara, igual que en sbgFillOutputFromBuffer.
+// Con la mascara conocida no queda ninguna comprobacion de bits por muestra y la estructura
+// resultante solo contiene los campos activados (unos 100 bytes frente a los ~300 de SbgOutput).
+
+namespace detail {
+
+constexpr bool kHostLittleEndian = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+template <uint8_t Mode>
+constexpr bool needsSwap()
+{
+  return ((Mode & SBG_OUTPUT_MODE_LITTLE_ENDIAN) != 0) != kHostLittleEndian;
+}
+
+inline uint16_t bswap(uint16_t v) {return __builtin_bswap16(v);}
+inline uint32_t bswap(uint32_t v) {return __builtin_bswap32(v);}
+inline uint64_t bswap(uint64_t v) {return __builtin_bswap64(v);}
+
+// Lee un valor de la trama sin suponer alineacion y lo convierte al formato del host
+template <uint8_t Mode, typename Raw>
+inline Raw readRaw(const uint8_t * p)
+{
+  Raw raw;
+  std::memcpy(&raw, p, sizeof(raw));
+  if constexpr (needsSwap<Mode>() && sizeof(Raw) > 1) {
+    raw = bswap(raw);
+  }
+  return raw;
+}
+
+template <uint8_t Mode, typename T>
+inline void readValue(const uint8_t * p, T & dst)
+{
+  if constexpr (std::is_same<T, float>::value) {
+    const uint32_t raw = readRaw<Mode, uint32_t>(p);
+    if constexpr ((Mode & SBG_OUTPUT_MODE_FIXED) != 0) {
+      dst = static_cast<float>(static_cast<int32_t>(raw)) / 1048576.0f;
+    } else {
+      std::memcpy(&dst, &raw, sizeof(dst));
+    }
+  } else if constexpr (std::is_same<T, double>::value) {
+    const uint64_t raw = readRaw<Mode, uint64_t>(p);
+    if constexpr ((Mode & SBG_OUTPUT_MODE_FIXED) != 0) {
+      dst = static_cast<double>(static_cast<int64_t>(raw)) / 4294967296.0;
+    } else {
+      std::memcpy(&dst, &raw, sizeof(dst));
+    }
+  } else {
+    using Raw = typename std::make_unsigned<T>::type;
+    dst = static_cast<T>(readRaw<Mode, Raw>(p));
+  }
+}
+
+template <uint8_t Mode, typename T, std::size_t N, std::size_t... I>
+inline void readArray(const uint8_t * p, T (&dst)[N], std::index_sequence<I...>)
+{
+  (readValue<Mode>(p + I * sizeof(T), dst[I]), ...);
+}
+
+// Lee un escalar o un array y avanza el puntero de la trama
+template <uint8_t Mode, typename T>
+inline void read(const uint8_t *& p, T & dst)
+{
+  readValue<Mode>(p, dst);
+  p += sizeof(T);
+}
+
+template <uint8_t Mode, typename T, std::size_t N>
+inline void read(const uint8_t *& p, T (&dst)[N])
+{
+  readArray<Mode>(p, dst, std::make_index_sequence<N>{});
+  p += N * sizeof(T);
+}
+
+// Copia del campo desde un SbgOutput decodificado por la ruta generica
+template <typename T>
+inline void copy(T & dst, const T & src) {dst = src;}
+
+template <typename T, std::size_t N>
+inline void copy(T (&dst)[N], const T (&src)[N]) {std::memcpy(dst, src, sizeof(dst));}
+
+}  // namespace detail
+
+// Modo de salida nativo del host, el que negocia sbgComInit en hosts little endian
+constexpr uint8_t kNativeOutputMode = detail::kHostLittleEndian ?
+  (SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT) : SBG_OUTPUT_MODE_DEFAULT;
+
+// Descripcion de cada salida: miembros, tamaño en la trama y lectura.
+// Los nombres de los miembros son los de SbgOutput.
+template <uint32_t Bit>
+struct OutputField;
+
+#define SBG_STATIC_OUTPUT_FIELD(BIT, TYPE, NAME, DIM)                                  \
+  template <>                                                                          \
+  struct OutputField<BIT> {                                                            \
+    struct Storage {TYPE NAME DIM;};                                                   \
+    static constexpr uint16_t size = sizeof(Storage::NAME);                            \
+    template <uint8_t Mode>                                                            \
+    static void decode(const uint8_t *& p, Storage & s) {detail::read<Mode>(p, s.NAME);} \
+    static void copy(Storage & s, const SbgOutput & o) {detail::copy(s.NAME, o.NAME);}  \
+  };
+
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_QUATERNION, float, stateQuat, [4])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_EULER, float, stateEuler, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_MATRIX, float, stateMatrix, [9])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_GYROSCOPES, float, gyroscopes, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_ACCELEROMETERS, float, accelerometers, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_MAGNETOMETERS, float, magnetometers, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_TEMPERATURES, float, temperatures, [2])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_GYROSCOPES_RAW, uint16, gyroscopesRaw, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_ACCELEROMETERS_RAW, uint16, accelerometersRaw, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_MAGNETOMETERS_RAW, uint16, magnetometersRaw, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_TEMPERATURES_RAW, uint16, temperaturesRaw, [2])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_TIME_SINCE_RESET, uint32, timeSinceReset, )
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_DEVICE_STATUS, uint32, deviceStatus, )
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_BARO_ALTITUDE, int32, baroAltitude, )
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_BARO_PRESSURE, uint32, baroPressure, )
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_POSITION, double, position, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_VELOCITY, float, velocity, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_ATTITUDE_ACCURACY, float, attitudeAccuracy, )
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_GYRO_TEMPERATURES, float, gyroTemperatures, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_GYRO_TEMPERATURES_RAW, uint16, gyroTemperaturesRaw, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_MAG_CALIB_DATA, uint8, magCalibData, [12])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_ODO_VELOCITIES, float, odoRawVelocity, [2])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_DELTA_ANGLES, float, deltaAngles, [3])
+SBG_STATIC_OUTPUT_FIELD(SBG_OUTPUT_HEAVE, float, heave, )
+
+#undef SBG_STATIC_OUTPUT_FIELD
+
+// Salidas con varios miembros
+template <>
+struct OutputField<SBG_OUTPUT_GPS_POSITION> {
+  struct Storage {int32 gpsLatitude; int32 gpsLongitude; int32 gpsAltitude;};
+  static constexpr uint16_t size = 3 * sizeof(int32);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.gpsLatitude);
+    detail::read<Mode>(p, s.gpsLongitude);
+    detail::read<Mode>(p, s.gpsAltitude);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.gpsLatitude = o.gpsLatitude;
+    s.gpsLongitude = o.gpsLongitude;
+    s.gpsAltitude = o.gpsAltitude;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_GPS_NAVIGATION> {
+  struct Storage {int32 gpsVelocity[3]; int32 gpsHeading;};
+  static constexpr uint16_t size = 4 * sizeof(int32);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.gpsVelocity);
+    detail::read<Mode>(p, s.gpsHeading);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    detail::copy(s.gpsVelocity, o.gpsVelocity);
+    s.gpsHeading = o.gpsHeading;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_GPS_ACCURACY> {
+  struct Storage {uint32 gpsHorAccuracy; uint32 gpsVertAccuracy; uint32 gpsSpeedAccuracy; uint32 gpsHeadingAccuracy;};
+  static constexpr uint16_t size = 4 * sizeof(uint32);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.gpsHorAccuracy);
+    detail::read<Mode>(p, s.gpsVertAccuracy);
+    detail::read<Mode>(p, s.gpsSpeedAccuracy);
+    detail::read<Mode>(p, s.gpsHeadingAccuracy);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.gpsHorAccuracy = o.gpsHorAccuracy;
+    s.gpsVertAccuracy = o.gpsVertAccuracy;
+    s.gpsSpeedAccuracy = o.gpsSpeedAccuracy;
+    s.gpsHeadingAccuracy = o.gpsHeadingAccuracy;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_GPS_INFO> {
+  struct Storage {uint32 gpsTimeMs; uint8 gpsFlags; uint8 gpsNbSats;};
+  static constexpr uint16_t size = sizeof(uint32) + 2 * sizeof(uint8);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.gpsTimeMs);
+    detail::read<Mode>(p, s.gpsFlags);
+    detail::read<Mode>(p, s.gpsNbSats);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.gpsTimeMs = o.gpsTimeMs;
+    s.gpsFlags = o.gpsFlags;
+    s.gpsNbSats = o.gpsNbSats;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_NAV_ACCURACY> {
+  struct Storage {float positionAccuracy; float velocityAccuracy;};
+  static constexpr uint16_t size = 2 * sizeof(float);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.positionAccuracy);
+    detail::read<Mode>(p, s.velocityAccuracy);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.positionAccuracy = o.positionAccuracy;
+    s.velocityAccuracy = o.velocityAccuracy;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_UTC_TIME_REFERENCE> {
+  struct Storage {uint8 utcYear; uint8 utcMonth; uint8 utcDay; uint8 utcHour; uint8 utcMin; uint8 utcSec; uint32 utcNano;};
+  static constexpr uint16_t size = 6 * sizeof(uint8) + sizeof(uint32);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.utcYear);
+    detail::read<Mode>(p, s.utcMonth);
+    detail::read<Mode>(p, s.utcDay);
+    detail::read<Mode>(p, s.utcHour);
+    detail::read<Mode>(p, s.utcMin);
+    detail::read<Mode>(p, s.utcSec);
+    detail::read<Mode>(p, s.utcNano);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.utcYear = o.utcYear;
+    s.utcMonth = o.utcMonth;
+    s.utcDay = o.utcDay;
+    s.utcHour = o.utcHour;
+    s.utcMin = o.utcMin;
+    s.utcSec = o.utcSec;
+    s.utcNano = o.utcNano;
+  }
+};
+
+template <>
+struct OutputField<SBG_OUTPUT_GPS_TRUE_HEADING> {
+  struct Storage {int32 gpsTrueHeading; uint32 gpsTrueHeadingAccuracy;};
+  static constexpr uint16_t size = 2 * sizeof(uint32);
+  template <uint8_t Mode>
+  static void decode(const uint8_t *& p, Storage & s)
+  {
+    detail::read<Mode>(p, s.gpsTrueHeading);
+    detail::read<Mode>(p, s.gpsTrueHeadingAccuracy);
+  }
+  static void copy(Storage & s, const SbgOutput & o)
+  {
+    s.gpsTrueHeading = o.gpsTrueHeading;
+    s.gpsTrueHeadingAccuracy = o.gpsTrueHeadingAccuracy;
+  }
+};
+
+// Hueco para un bit de la mascara: vacio si la salida no esta activada (no ocupa espacio como base)
+template <uint32_t Bit, uint32_t Mask, bool Enabled = (Mask & Bit) != 0>
+struct OutputSlot {};
+
+template <uint32_t Bit, uint32_t Mask>
+struct OutputSlot<Bit, Mask, true> : OutputField<Bit>::Storage {};
+
+namespace detail {
+
+template <uint32_t Mask, typename Seq>
+struct CompactOutputBase;
+
+template <uint32_t Mask, std::size_t... I>
+struct CompactOutputBase<Mask, std::index_sequence<I...>> : OutputSlot<(1u << I), Mask>... {};
+
+template <uint32_t Bit, uint32_t Mask>
+constexpr uint16_t fieldSize()
+{
+  if constexpr ((Mask & Bit) != 0) {
+    return OutputField<Bit>::size;
+  } else {
+    return 0;
+  }
+}
+
+template <uint32_t Mask, std::size_t... I>
+constexpr uint16_t frameSize(std::index_sequence<I...>)
+{
+  return (0 + ... + fieldSize<(1u << I), Mask>());
+}
+
+}  // namespace detail
+
+// Estructura con solo los campos activados en Mask, con los mismos nombres que en SbgOutput.
+// outputMask indica los campos validos, como en SbgOutput.
+template <uint32_t Mask>
+struct CompactOutput : detail::CompactOutputBase<Mask, std::make_index_sequence<31>> {
+  uint32 outputMask = 0;
+};
+
+template <uint32_t Mask, uint8_t Mode>
+class StaticOutputDecoder {
+public:
+  using Output = CompactOutput<Mask>;
+
+  static constexpr uint32_t mask = Mask;
+  static constexpr uint8_t mode = Mode;
+
+  // Tamaño de la trama, calculado en compilacion
+  static constexpr uint16_t frameSize = detail::frameSize<Mask>(std::make_index_sequence<31>{});
+
+  // true si la trama puede decodificarse con el codigo generado
+  static bool matches(uint8_t targetOutputMode, uint32_t outputMask, uint16_t size)
+  {
+    return targetOutputMode == Mode && outputMask == Mask && size >= frameSize;
+  }
+
+  // Tamaño de la trama de una mascara contenida en Mask
+  template <uint32_t SubMask>
+  static constexpr uint16_t subsetFrameSize = detail::frameSize<SubMask>(std::make_index_sequence<31>{});
+
+  // Decodificacion desenrollada, sin ninguna comprobacion de la mascara
+  static void decode(const uint8_t * pBuffer, Output & output)
+  {
+    decodeFields<Mask>(pBuffer, output, std::make_index_sequence<31>{});
+    output.outputMask = Mask;
+  }
+
+  // Igual con una trama de SubMask, contenida en Mask: los campos que no estan en SubMask no se tocan
+  template <uint32_t SubMask>
+  static void decodeSubset(const uint8_t * pBuffer, Output & output)
+  {
+    static_assert((SubMask & ~Mask) == 0, "SubMask must be contained in the decoder mask");
+    decodeFields<SubMask>(pBuffer, output, std::make_index_sequence<31>{});
+    output.outputMask = SubMask;
+  }
+
+  // Decodifica una trama producida con outputMask si es una de SubMasks y tiene exactamente su tamaño.
+  // Si outputMask no esta en SubMasks o el tamaño no coincide devuelve false, para la ruta generica.
+  template <uint32_t... SubMasks>
+  static bool tryDecodeSubset(uint8_t targetOutputMode, uint32_t outputMask, const uint8_t * pBuffer, uint16_t size,
+                              Output & output)
+  {
+    if (targetOutputMode != Mode) {
+      return false;
+    }
+    return ((outputMask == SubMasks && size == subsetFrameSize<SubMasks> &&
+             (decodeSubset<SubMasks>(pBuffer, output), true)) || ...);
+  }
+
+  // Decodifica si la trama coincide con la mascara y el modo compilados, si no devuelve false
+  // y la trama debe pasar por la ruta generica de sbgCom
+  static bool tryDecode(uint8_t targetOutputMode, uint32_t outputMask, const uint8_t * pBuffer, uint16_t size, Output & output)
+  {
+    if (!matches(targetOutputMode, outputMask, size)) {
+      return false;
+    }
+    decode(pBuffer, output);
+    return true;
+  }
+
+  // Copia los campos de un SbgOutput de la ruta generica, solo los que esten a la vez en Mask y en la salida
+  static void fromSbgOutput(const SbgOutput & src, Output & output)
+  {
+    copyFields(src, output, std::make_index_sequence<31>{});
+    output.outputMask = src.outputMask & Mask;
+  }
+
+private:
+  template <uint32_t FrameMask, std::size_t... I>
+  static void decodeFields(const uint8_t * p, Output & output, std::index_sequence<I...>)
+  {
+    (decodeField<FrameMask, (1u << I)>(p, output), ...);
+  }
+
+  template <uint32_t FrameMask, uint32_t Bit>
+  static void decodeField(const uint8_t *& p, Output & output)
+  {
+    if constexpr ((FrameMask & Bit) != 0) {
+      OutputField<Bit>::template decode<Mode>(p, static_cast<typename OutputField<Bit>::Storage &>(output));
+    }
+  }
+
+  template <std::size_t... I>
+  static void copyFields(const SbgOutput & src, Output & output, std::index_sequence<I...>)
+  {
+    (copyField<(1u << I)>(src, output), ...);
+  }
+
+  template <uint32_t Bit>
+  static void copyField(const SbgOutput & src, Output & output)
+  {
+    if constexpr ((Mask & Bit) != 0) {
+      if (src.outputMask & Bit) {
+        OutputField<Bit>::copy(static_cast<typename OutputField<Bit>::Storage &>(output), src);
+      }
+    }
+  }
+};
+
+}  // namespace sbg
+
+#endif  // SBG__STATIC_OUTPUT_DECODER_HPP_
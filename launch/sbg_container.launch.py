@@ -0,0 +1,81 @@
+# Carga sbg::SBGNode en un contenedor de componentes con comunicacion intra-proceso.
+# Los consumidores cargados en el mismo contenedor (con use_intra_process_comms) reciben las muestras
+# sin serializar ni copiar; bench:=true carga tambien sbg::LatencyBench para medirlo.
+#
+#   ros2 launch sbg sbg_container.launch.py port:=/dev/sbg
+#   ros2 launch sbg sbg_container.launch.py port:=/tmp/sbg_emu time_source:=host bench:=true
+
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, Shutdown
+from launch.conditions import IfCondition
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.actions import ComposableNodeContainer, LoadComposableNodes
+from launch_ros.descriptions import ComposableNode
+from launch_ros.parameter_descriptions import ParameterValue
+from launch_ros.substitutions import FindPackageShare
+
+
+def generate_launch_description():
+    arguments = [
+        DeclareLaunchArgument('params_file', default_value=PathJoinSubstitution(
+            [FindPackageShare('sbg'), 'params', 'sbg.yaml'])),
+        DeclareLaunchArgument('port', default_value='/dev/sbg'),
+        DeclareLaunchArgument('baudrate', default_value='921600'),
+        DeclareLaunchArgument('frequency', default_value='500'),
+        DeclareLaunchArgument('pipeline_mode', default_value='streaming'),
+        DeclareLaunchArgument('time_source', default_value='device'),
+        DeclareLaunchArgument('output_routing', default_value='continuous'),
+        DeclareLaunchArgument('bench', default_value='false'),
+        DeclareLaunchArgument('bench_reference', default_value='probe'),
+        DeclareLaunchArgument('bench_expected_rate', default_value='0.0'),
+        DeclareLaunchArgument('bench_duration', default_value='10.0'),
+        DeclareLaunchArgument('bench_label', default_value=''),
+        DeclareLaunchArgument('bench_output', default_value=''),
+    ]
+
+    intra_process = [{'use_intra_process_comms': True}]
+
+    container = ComposableNodeContainer(
+        name='sbg_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container',
+        composable_node_descriptions=[
+            ComposableNode(
+                package='sbg',
+                plugin='sbg::SBGNode',
+                name='sbg_node',
+                parameters=[LaunchConfiguration('params_file'), {
+                    'port': LaunchConfiguration('port'),
+                    'baudrate': ParameterValue(LaunchConfiguration('baudrate'), value_type=int),
+                    'frequency': ParameterValue(LaunchConfiguration('frequency'), value_type=int),
+                    'pipeline_mode': LaunchConfiguration('pipeline_mode'),
+                    'time_source': LaunchConfiguration('time_source'),
+                    'output_routing': LaunchConfiguration('output_routing'),
+                }],
+                extra_arguments=intra_process),
+        ],
+        output='screen',
+        # sbg::LatencyBench cierra el contenedor al acabar la medida, y con el el launch
+        on_exit=Shutdown())
+
+    bench = LoadComposableNodes(
+        target_container='sbg_container',
+        condition=IfCondition(LaunchConfiguration('bench')),
+        composable_node_descriptions=[
+            ComposableNode(
+                package='sbg',
+                plugin='sbg::LatencyBench',
+                name='sbg_latency_bench',
+                parameters=[{
+                    'reference': LaunchConfiguration('bench_reference'),
+                    'expected_rate': ParameterValue(LaunchConfiguration('bench_expected_rate'), value_type=float),
+                    'duration': ParameterValue(LaunchConfiguration('bench_duration'), value_type=float),
+                    'report_period': 0.0,
+                    'label': ParameterValue(LaunchConfiguration('bench_label'), value_type=str),
+                    'output': ParameterValue(LaunchConfiguration('bench_output'), value_type=str),
+                }],
+                extra_arguments=intra_process),
+        ])
+
+    return LaunchDescription(arguments + [container, bench])
@@ -0,0 +1,90 @@
+#!/bin/bash
+# Latencia de extremo a extremo del nodo: sbgEmulator --probe -> sbg_node -> sbg_latency_bench
+# Recorre los modos de pipeline y las frecuencias indicadas y anade los percentiles de cada ejecucion al CSV.
+#
+#   scripts/latency_bench.sh -m "polling streaming reader_thread" -r "100 200 500" -d 10 -o latencia.csv
+#
+# Con -c el nodo y la medida se cargan en el mismo contenedor (launch/sbg_container.launch.py), con
+# comunicacion intra-proceso; sin -c son procesos separados y los mensajes pasan por el middleware.
+#
+# Requiere el paquete instalado (ros2 run sbg ...) y sbgEmulator de sdk/sbgCom/tools en el PATH o en -e.
+
+set -u
+
+MODES="polling streaming reader_thread"
+RATES="100 200 500"
+DURATION=10
+BAUD=921600
+FREQUENCY=500
+OUTPUT="latency_bench.csv"
+EMULATOR="sbgEmulator"
+PTY="/tmp/sbg_latency_bench"
+CONTAINER=0
+
+usage() {
+  cat <<EOF
+Usage: $0 [options]
+  -m MODES      pipeline_mode del nodo a medir (default "$MODES")
+  -r RATES      frecuencias del emulador en Hz (default "$RATES")
+  -d SECONDS    duracion de cada medida, tras 1 s de calentamiento (default $DURATION)
+  -b BAUD       baudrate emulado (default $BAUD)
+  -f HZ         parametro frequency del nodo, tick de polling y de streaming (default $FREQUENCY)
+  -o FILE       CSV de resultados (default $OUTPUT)
+  -e PATH       ejecutable sbgEmulator (default $EMULATOR)
+  -c            nodo y medida en un contenedor, intra-proceso
+EOF
+}
+
+while getopts "m:r:d:b:f:o:e:ch" option; do
+  case $option in
+    m) MODES=$OPTARG ;;
+    r) RATES=$OPTARG ;;
+    d) DURATION=$OPTARG ;;
+    b) BAUD=$OPTARG ;;
+    f) FREQUENCY=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    e) EMULATOR=$OPTARG ;;
+    c) CONTAINER=1 ;;
+    *) usage; exit 1 ;;
+  esac
+done
+
+PIDS=""
+cleanup() {
+  [ -n "$PIDS" ] && kill $PIDS 2>/dev/null
+  wait 2>/dev/null
+  PIDS=""
+}
+trap 'cleanup; exit 130' INT TERM
+
+for rate in $RATES; do
+  for mode in $MODES; do
+    # En polling se publica una muestra por tick del nodo, con el resto de modos una por frame del emulador
+    if [ "$mode" = "polling" ]; then expected=$FREQUENCY; else expected=$rate; fi
+    if [ $CONTAINER -eq 1 ]; then label="$mode@$rate+ipc"; else label="$mode@$rate"; fi
+    echo "=== $label ==="
+
+    "$EMULATOR" --probe --port "pty://$PTY" --baud "$BAUD" --rate "$rate" &
+    PIDS="$!"
+    sleep 0.5
+
+    if [ $CONTAINER -eq 1 ]; then
+      # El contenedor termina cuando sbg::LatencyBench acaba la medida
+      ros2 launch sbg sbg_container.launch.py port:="$PTY" baudrate:="$BAUD" frequency:="$FREQUENCY" \
+        pipeline_mode:="$mode" time_source:=host bench:=true bench_expected_rate:="$expected" \
+        bench_duration:="$DURATION" bench_label:="$label" bench_output:="$OUTPUT"
+    else
+      ros2 run sbg sbg_node --ros-args -p port:="$PTY" -p baudrate:="$BAUD" -p pipeline_mode:="$mode" \
+        -p frequency:="$FREQUENCY" -p time_source:=host > /dev/null &
+      PIDS="$PIDS $!"
+
+      ros2 run sbg sbg_latency_bench --ros-args -p reference:=probe -p expected_rate:="$expected" \
+        -p duration:="$DURATION" -p report_period:=0.0 -p label:="$label" -p output:="$OUTPUT"
+    fi
+
+    cleanup
+    sleep 0.5
+  done
+done
+
+echo "Results appended to $OUTPUT"
@@ -0,0 +1,491 @@
+/*!
+ *	\file		sbgComBenchmarks.cpp
+ *
+ *	\brief		Google Benchmark suite for the sbgCom hot paths.<br>
+ *				CRC, frame parser, output decoding and the whole receive, decode and callback pipeline.
+ *				Streams are served from memory by a mem:// transport so only the library code is measured.<br>
+ *				Run with --benchmark_format=json or --benchmark_out=file.json to compare builds.
+ */
+
+#include "../src/sbgCom.h"
+#include "../src/sbgComVersion.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef SBG_BENCH_C_FLAGS
+	#define SBG_BENCH_C_FLAGS		"unknown"
+#endif
+
+#ifndef SBG_BENCH_BUILD_TYPE
+	#define SBG_BENCH_BUILD_TYPE	"unknown"
+#endif
+
+namespace
+{
+
+//------------------------------------------------------------------------------//
+//- Benchmark definitions                                                      -//
+//------------------------------------------------------------------------------//
+
+const uint32 kStreamFrames = 256;			/*!< Frames in a synthetic stream, a benchmark iteration parses all of them. */
+
+/*!
+ *	A representative output mask.
+ */
+struct OutputMask
+{
+	const char	*pName;
+	uint32		mask;
+};
+
+const OutputMask kMasks[] =
+{
+	{"imu",		SBG_OUTPUT_QUATERNION | SBG_OUTPUT_GYROSCOPES | SBG_OUTPUT_ACCELEROMETERS},
+	{"node",	SBG_OUTPUT_MATRIX | SBG_OUTPUT_GYROSCOPES | SBG_OUTPUT_ACCELEROMETERS | SBG_OUTPUT_POSITION |
+				SBG_OUTPUT_NAV_ACCURACY | SBG_OUTPUT_GPS_INFO | SBG_OUTPUT_TIME_SINCE_RESET},
+	{"gps",		SBG_OUTPUT_GPS_POSITION | SBG_OUTPUT_GPS_NAVIGATION | SBG_OUTPUT_GPS_ACCURACY | SBG_OUTPUT_GPS_INFO |
+				SBG_OUTPUT_UTC_TIME_REFERENCE | SBG_OUTPUT_TIME_SINCE_RESET},
+	{"full",	0x7FFFFFFF & ~SBG_OUTPUT_MAG_CALIB_DATA}
+};
+
+const char *const kModeNames[] = {"be_float", "le_float", "be_fixed", "le_fixed"};
+
+//------------------------------------------------------------------------------//
+//- In memory transport                                                        -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Stream served by the mem:// transport.<br>
+ *	Reads return at most fragment bytes, 0 for as much as asked, until the stream is rewound.
+ */
+struct MemStream
+{
+	std::vector<uint8>	bytes;
+	size_t				offset;
+	uint32				fragment;
+};
+
+MemStream gMemStream;
+
+SbgErrorCode memOpen(const char *pPath, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	// Avoid warnings
+	(void)baudRate;
+
+	gMemStream.fragment = (uint32)strtoul(pPath, NULL, 0);
+	gMemStream.offset = 0;
+	*pContext = &gMemStream;
+
+	return SBG_NO_ERROR;
+}
+
+SbgErrorCode memClose(SbgDeviceContext context)
+{
+	// Avoid warnings
+	(void)context;
+
+	return SBG_NO_ERROR;
+}
+
+SbgErrorCode memWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	// Avoid warnings
+	(void)context;
+	(void)pBuffer;
+	(void)numBytesToWrite;
+
+	return SBG_NO_ERROR;
+}
+
+SbgErrorCode memRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	MemStream *pStream = (MemStream*)context;
+	size_t numBytes = pStream->bytes.size() - pStream->offset;
+
+	if (numBytes > numBytesToRead)
+	{
+		numBytes = numBytesToRead;
+	}
+	if ( (pStream->fragment) && (numBytes > pStream->fragment) )
+	{
+		numBytes = pStream->fragment;
+	}
+
+	memcpy(pBuffer, pStream->bytes.data() + pStream->offset, numBytes);
+	pStream->offset += numBytes;
+
+	if (pNumBytesRead)
+	{
+		*pNumBytesRead = (uint32)numBytes;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+SbgErrorCode memReadStamped(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs)
+{
+	//
+	// A constant stamp keeps the clock out of the measures
+	//
+	if (pTimeStampNs)
+	{
+		*pTimeStampNs = 0;
+	}
+
+	return memRead(context, pBuffer, numBytesToRead, pNumBytesRead);
+}
+
+SbgErrorCode memWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
+{
+	// Avoid warnings
+	(void)deadlineNs;
+
+	return (((MemStream*)context)->offset < ((MemStream*)context)->bytes.size())?SBG_NO_ERROR:SBG_TIME_OUT;
+}
+
+SbgDeviceOps makeMemOps()
+{
+	SbgDeviceOps ops;
+
+	memset(&ops, 0, sizeof(ops));
+	ops.pScheme = "mem";
+	ops.pOpen = memOpen;
+	ops.pClose = memClose;
+	ops.pWrite = memWrite;
+	ops.pRead = memRead;
+	ops.pReadStamped = memReadStamped;
+	ops.pWaitReadableUntil = memWaitReadableUntil;
+
+	return ops;
+}
+
+const SbgDeviceOps kMemOps = makeMemOps();
+
+//------------------------------------------------------------------------------//
+//- Synthetic data                                                             -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Returns outputs with plausible non zero values in every field.
+ */
+SbgOutput makeOutput(uint32 index)
+{
+	SbgOutput output;
+	uint8 *pBytes = (uint8*)&output;
+	size_t i;
+
+	//
+	// Each byte gets a value, then the real fields get values that fixed point can represent
+	//
+	for (i = 0; i < sizeof(output); i++)
+	{
+		pBytes[i] = (uint8)(i*31 + index);
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		output.stateQuat[i] = 0.5f - 0.01f*i;
+	}
+	for (i = 0; i < 9; i++)
+	{
+		output.stateMatrix[i] = 0.1f*i - 0.4f;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		output.stateEuler[i] = 0.2f*i;
+		output.gyroscopes[i] = 0.01f*(index % 100) - 0.3f*i;
+		output.accelerometers[i] = (i == 2)?-9.81f:0.05f*i;
+		output.magnetometers[i] = 0.3f + 0.1f*i;
+		output.velocity[i] = 1.5f*i;
+		output.gyroTemperatures[i] = 30.0f;
+		output.deltaAngles[i] = 0.001f*i;
+		output.position[i] = 43.6 + i;
+	}
+	output.temperatures[0] = 30.0f;
+	output.temperatures[1] = 31.0f;
+	output.attitudeAccuracy = 0.01f;
+	output.positionAccuracy = 1.5f;
+	output.velocityAccuracy = 0.1f;
+	output.odoRawVelocity[0] = 2.0f;
+	output.odoRawVelocity[1] = 2.0f;
+	output.heave = 0.1f;
+
+	return output;
+}
+
+/*!
+ *	Returns the raw buffer a device sends for a mask and an output mode.
+ */
+std::vector<uint8> makeOutputBuffer(uint8 outputMode, uint32 outputMask, uint32 index)
+{
+	SbgOutputDecodePlan plan;
+	SbgOutput output = makeOutput(index);
+	std::vector<uint8> buffer;
+
+	if (sbgBuildOutputDecodePlan(outputMode, outputMask, &plan) == SBG_NO_ERROR)
+	{
+		buffer.resize(plan.bufferSize);
+		sbgExecuteOutputEncodePlan(&plan, &output, buffer.data(), plan.bufferSize);
+	}
+
+	return buffer;
+}
+
+/*!
+ *	Append a complete frame to a stream.
+ */
+void appendFrame(std::vector<uint8> &stream, uint8 cmd, const std::vector<uint8> &data)
+{
+	size_t start = stream.size();
+	uint16 crc;
+
+	stream.push_back(SBG_SYNC);
+	stream.push_back(SBG_STX);
+	stream.push_back(cmd);
+	stream.push_back((uint8)(data.size() >> 8));
+	stream.push_back((uint8)(data.size()));
+	stream.insert(stream.end(), data.begin(), data.end());
+	crc = sbgProtocolCalcCRC(stream.data() + start + 2, (uint16)(data.size() + 3));
+	stream.push_back((uint8)(crc >> 8));
+	stream.push_back((uint8)(crc));
+	stream.push_back(SBG_ETC);
+}
+
+/*!
+ *	Fill the mem:// stream with continuous frames of a mask in the native output mode.
+ */
+void makeContinuousStream(uint32 outputMask)
+{
+	uint32 i;
+
+	gMemStream.bytes.clear();
+
+	for (i = 0; i < kStreamFrames; i++)
+	{
+		appendFrame(gMemStream.bytes, SBG_CONTINUOUS_DEFAULT_OUTPUT, makeOutputBuffer(SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT, outputMask, i));
+	}
+}
+
+/*!
+ *	Opens the mem:// device with a read fragment size, 0 for unfragmented reads.
+ */
+SbgProtocolHandle openMemDevice(benchmark::State &state, uint32 fragment)
+{
+	SbgProtocolHandle handle = SBG_INVALID_PROTOCOL_HANDLE;
+	char uri[32];
+
+	snprintf(uri, sizeof(uri), "mem://%u", fragment);
+
+	if (sbgProtocolInit(uri, 921600, &handle) != SBG_NO_ERROR)
+	{
+		state.SkipWithError("Unable to open the mem:// device");
+		return SBG_INVALID_PROTOCOL_HANDLE;
+	}
+
+	return handle;
+}
+
+//------------------------------------------------------------------------------//
+//- Benchmarks                                                                 -//
+//------------------------------------------------------------------------------//
+
+/// CRC over a payload of state.range(0) bytes
+void BM_ProtocolCalcCRC(benchmark::State &state)
+{
+	std::vector<uint8> payload((size_t)state.range(0));
+	size_t i;
+
+	for (i = 0; i < payload.size(); i++)
+	{
+		payload[i] = (uint8)(i*13);
+	}
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(sbgProtocolCalcCRC(payload.data(), (uint16)payload.size()));
+	}
+
+	state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)payload.size());
+}
+BENCHMARK(BM_ProtocolCalcCRC)->Arg(8)->Arg(64)->Arg(256)->Arg(1016);
+
+/// Parse a stream of continuous frames read in fragments of state.range(0) bytes (0 for whole reads)
+void BM_ProtocolReceive(benchmark::State &state)
+{
+	SbgProtocolHandle handle;
+	uint8 data[SBG_MAX_DATA_LENGTH];
+	uint32 numFrames = 0;
+	uint16 size;
+	uint8 cmd;
+
+	makeContinuousStream(kMasks[1].mask);
+	handle = openMemDevice(state, (uint32)state.range(0));
+
+	if (handle == SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		gMemStream.offset = 0;
+
+		for (;;)
+		{
+			SbgErrorCode errorCode = sbgProtocolReceive(handle, &cmd, data, &size, sizeof(data));
+
+			if (errorCode == SBG_NO_ERROR)
+			{
+				numFrames++;
+			}
+			else if ( (errorCode == SBG_NOT_READY) && (gMemStream.offset >= gMemStream.bytes.size()) )
+			{
+				break;
+			}
+		}
+	}
+
+	if (numFrames != state.iterations() * kStreamFrames)
+	{
+		state.SkipWithError("Frames have been lost");
+	}
+
+	state.SetItemsProcessed((int64_t)numFrames);
+	state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)gMemStream.bytes.size());
+	sbgProtocolClose(handle);
+}
+BENCHMARK(BM_ProtocolReceive)->ArgName("fragment")->Arg(0)->Arg(1)->Arg(16)->Arg(64)->Arg(256);
+
+/// Decode a raw output buffer for mask state.range(0) in output mode state.range(1)
+void BM_FillOutputFromBuffer(benchmark::State &state)
+{
+	const OutputMask &mask = kMasks[state.range(0)];
+	uint8 outputMode = (uint8)state.range(1);
+	std::vector<uint8> buffer = makeOutputBuffer(outputMode, mask.mask, 0);
+	SbgOutput output;
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(sbgFillOutputFromBuffer(outputMode, mask.mask, buffer.data(), (uint16)buffer.size(), &output));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetLabel(std::string(mask.pName) + "/" + kModeNames[outputMode]);
+	state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)buffer.size());
+}
+BENCHMARK(BM_FillOutputFromBuffer)->ArgNames({"mask", "mode"})->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3}});
+
+/// Decode the same buffers with a prebuilt plan, the path used for continuous and triggered frames
+void BM_ExecuteOutputDecodePlan(benchmark::State &state)
+{
+	const OutputMask &mask = kMasks[state.range(0)];
+	uint8 outputMode = (uint8)state.range(1);
+	std::vector<uint8> buffer = makeOutputBuffer(outputMode, mask.mask, 0);
+	SbgOutputDecodePlan plan;
+	SbgOutput output;
+
+	sbgBuildOutputDecodePlan(outputMode, mask.mask, &plan);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(sbgExecuteOutputDecodePlan(&plan, buffer.data(), (uint16)buffer.size(), &output));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetLabel(std::string(mask.pName) + "/" + kModeNames[outputMode]);
+	state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)buffer.size());
+}
+BENCHMARK(BM_ExecuteOutputDecodePlan)->ArgNames({"mask", "mode"})->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3}});
+
+/// Size of the raw buffer of mask state.range(0)
+void BM_CalculateOutputBufferSize(benchmark::State &state)
+{
+	const OutputMask &mask = kMasks[state.range(0)];
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(sbgCalculateOutputBufferSize(SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT, mask.mask));
+	}
+
+	state.SetLabel(mask.pName);
+}
+BENCHMARK(BM_CalculateOutputBufferSize)->ArgName("mask")->DenseRange(0, 3);
+
+/// Continuous frames callback, only counts the frames
+void countOutput(SbgProtocolHandleInt *pHandler, SbgOutput *pOutput, void *pUsrArg)
+{
+	// Avoid warnings
+	(void)pHandler;
+
+	benchmark::DoNotOptimize(pOutput->gyroscopes[0]);
+	(*(uint32*)pUsrArg)++;
+}
+
+/// Receive, decode and dispatch the continuous frames of mask state.range(1), read in fragments of state.range(0) bytes
+void BM_ReceiveDecodeCallback(benchmark::State &state)
+{
+	const OutputMask &mask = kMasks[state.range(1)];
+	SbgProtocolHandle handle;
+	uint32 numFrames = 0;
+
+	makeContinuousStream(mask.mask);
+	handle = openMemDevice(state, (uint32)state.range(0));
+
+	if (handle == SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		return;
+	}
+
+	sbgProtocolSetTargetOutput(handle, SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT, mask.mask);
+	sbgSetContinuousModeCallback(handle, countOutput, &numFrames);
+
+	for (auto _ : state)
+	{
+		gMemStream.offset = 0;
+
+		while (gMemStream.offset < gMemStream.bytes.size())
+		{
+			sbgProtocolContinuousModeHandle(handle);
+		}
+		sbgProtocolContinuousModeHandle(handle);
+	}
+
+	if (numFrames != state.iterations() * kStreamFrames)
+	{
+		state.SkipWithError("Frames have been lost");
+	}
+
+	state.SetLabel(mask.pName);
+	state.SetItemsProcessed((int64_t)numFrames);
+	state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)gMemStream.bytes.size());
+	sbgProtocolClose(handle);
+}
+BENCHMARK(BM_ReceiveDecodeCallback)->ArgNames({"fragment", "mask"})->ArgsProduct({{0, 64}, {0, 1, 2, 3}});
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	sbgDeviceRegisterTransport(&kMemOps);
+
+	//
+	// Record the build in the json context so results of different flags can be told apart
+	//
+	benchmark::AddCustomContext("sbgcom_version", SBG_COM_VERSION);
+	benchmark::AddCustomContext("sbgcom_build_type", SBG_BENCH_BUILD_TYPE);
+	benchmark::AddCustomContext("sbgcom_c_flags", SBG_BENCH_C_FLAGS);
+
+	benchmark::Initialize(&argc, argv);
+
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return EXIT_SUCCESS;
+}
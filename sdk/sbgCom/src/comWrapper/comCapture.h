@@ -0,0 +1,147 @@
+/*!
+ *	\file		comCapture.h
+ *
+ *	\brief		Capture file format used to record and replay the raw byte stream of a device.<br>
+ *				A capture is a SbgCaptureHeader followed by records, each one a SbgCaptureRecord
+ *				and either the bytes returned by one read of the device or a SbgCaptureOutputConfig
+ *				recorded when the output mode or default output mask changed. All fields are in host byte order.
+ */
+
+#ifndef __COM_CAPTURE_H__
+#define __COM_CAPTURE_H__
+
+#include "../sbgCommon.h"
+
+//------------------------------------------------------------------------------//
+//- Capture definitions                                                        -//
+//------------------------------------------------------------------------------//
+
+#define SBG_CAPTURE_MAGIC					"SBGCAP01"				/*!< First bytes of a capture file. */
+#define SBG_CAPTURE_MAGIC_SIZE				(8)						/*!< Size of the magic, without null character. */
+#define SBG_CAPTURE_VERSION					(2)						/*!< Version of the capture format, 2 adds the output configuration records. */
+#define SBG_CAPTURE_UNKNOWN					(0xFFFFFFFF)			/*!< Value of the header fields that weren't known when recording. */
+
+#define SBG_CAPTURE_RECORD_STREAM			(0)						/*!< Record holding stream bytes, the only type of version 1 captures. */
+#define SBG_CAPTURE_RECORD_OUTPUT_CONFIG	(1)						/*!< Record holding a SbgCaptureOutputConfig. */
+
+/*!
+ *	Capture file header.
+ */
+typedef struct _SbgCaptureHeader
+{
+	char	magic[SBG_CAPTURE_MAGIC_SIZE];	/*!< SBG_CAPTURE_MAGIC. */
+	uint32	version;						/*!< SBG_CAPTURE_VERSION. */
+	uint32	headerSize;						/*!< Size of the header, the first record starts right after it. */
+	uint32	baudRate;						/*!< Baud rate of the recorded link, 0 if unknown. */
+	uint32	outputMode;						/*!< Device output mode (endianness and fixed/float) when recording started. */
+	uint32	defaultOutputMask;				/*!< Device default output mask when recording started. */
+	uint32	reserved;						/*!< Set to 0. */
+	uint64	startTimeNs;					/*!< sbgGetTimeNs monotonic time at which recording started. */
+} SbgCaptureHeader;
+
+/*!
+ *	Header of a record, followed by size bytes of the stream.
+ */
+typedef struct _SbgCaptureRecord
+{
+	uint64	timeStampNs;					/*!< sbgGetTimeNs time at which the read returned, stamp of the last byte. */
+	uint32	size;							/*!< Number of bytes following the record header. */
+	uint32	type;							/*!< SBG_CAPTURE_RECORD_STREAM or SBG_CAPTURE_RECORD_OUTPUT_CONFIG, records of unknown types are skipped. */
+} SbgCaptureRecord;
+
+/*!
+ *	Output configuration of the device from a given stream byte on.<br>
+ *	Continuous frames that start at or after streamOffset are decoded with it.
+ */
+typedef struct _SbgCaptureOutputConfig
+{
+	uint64	streamOffset;					/*!< Number of stream bytes recorded before the first one sent with this configuration. */
+	uint32	outputMode;						/*!< Device output mode (endianness and fixed/float). */
+	uint32	defaultOutputMask;				/*!< Device default output mask. */
+} SbgCaptureOutputConfig;
+
+//------------------------------------------------------------------------------//
+//- Recorder definitions                                                       -//
+//------------------------------------------------------------------------------//
+
+#define SBG_CAPTURE_BLOCK_SIZE				(4096)					/*!< Alignment of the writer buffers and writes, required by O_DIRECT. */
+#define SBG_CAPTURE_MIN_BUFFER_SIZE			(65536)					/*!< Smallest writer buffer. */
+#define SBG_CAPTURE_DEFAULT_BUFFER_SIZE		(262144)				/*!< Default writer buffer, about 3 s of stream at 921600 bauds. */
+
+/*!
+ *	Capture recorder, NULL if invalid.
+ */
+typedef struct _SbgCapture* SbgCaptureHandle;
+
+#define SBG_INVALID_CAPTURE_HANDLE			NULL					/*!< Identify an invalid capture recorder. */
+
+/*!
+ *	Recorder statistics.
+ */
+typedef struct _SbgCaptureStats
+{
+	uint64	writtenBytes;					/*!< Bytes written to the file by the writer thread. */
+	uint64	maxWriteTimeNs;					/*!< Longest write of a buffer, shows the disk stalls the reader didn't see. */
+	uint32	droppedRecords;					/*!< Records dropped because the writer thread was still busy with the other buffer. */
+	uint32	writeErrors;					/*!< Number of failed writes. */
+} SbgCaptureStats;
+
+//------------------------------------------------------------------------------//
+//- Recorder operations                                                        -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Create a capture file and start its writer thread.<br>
+ *	Records are appended to one of two buffers while a background thread writes the other one,
+ *	so the reader never waits for the disk. Buffers are only written when full, as large aligned writes.
+ *	\param[in]	fileName				Capture file to create, truncated if it exists.
+ *	\param[in]	pHeader					baudRate, outputMode and defaultOutputMask of the recorded device, the other fields are filled by the recorder.
+ *	\param[in]	bufferSize				Size of each of the two buffers, rounded up to SBG_CAPTURE_BLOCK_SIZE, 0 for SBG_CAPTURE_DEFAULT_BUFFER_SIZE.
+ *	\param[in]	directIo				TRUE to bypass the page cache with O_DIRECT, ignored if the file system doesn't support it.
+ *	\param[out]	pHandle					The created recorder.
+ *	\return								SBG_NO_ERROR if the capture has been created.
+ */
+SbgErrorCode sbgCaptureOpen(const char *fileName, const SbgCaptureHeader *pHeader, uint32 bufferSize, bool directIo, SbgCaptureHandle *pHandle);
+
+/*!
+ *	Append the bytes returned by one read of the device.<br>
+ *	Never blocks: if the buffer is full while the writer thread is still busy, the record is dropped.<br>
+ *	Must not run concurrently with another sbgCaptureWrite or sbgCaptureWriteOutputConfig call.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[in]	pData					Bytes returned by the read.
+ *	\param[in]	size					Number of bytes.
+ *	\param[in]	timeStampNs				sbgGetTimeNs time at which the read returned.
+ *	\return								SBG_NO_ERROR if the record has been stored, SBG_BUFFER_OVERFLOW if it has been dropped.
+ */
+SbgErrorCode sbgCaptureWrite(SbgCaptureHandle handle, const void *pData, uint32 size, uint64 timeStampNs);
+
+/*!
+ *	Append a change of the device output configuration.<br>
+ *	The bytes already written but not parsed yet, such as the frames that followed the ACK of the change
+ *	in the same read, are sent with the new configuration: pendingBytes tells how many there are.<br>
+ *	Never blocks and must not run concurrently with another sbgCaptureWrite or sbgCaptureWriteOutputConfig call.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[in]	pendingBytes			Number of the last written stream bytes that are sent with the new configuration.
+ *	\param[in]	outputMode				New device output mode.
+ *	\param[in]	defaultOutputMask		New device default output mask.
+ *	\param[in]	timeStampNs				sbgGetTimeNs time of the change.
+ *	\return								SBG_NO_ERROR if the record has been stored, SBG_BUFFER_OVERFLOW if it has been dropped.
+ */
+SbgErrorCode sbgCaptureWriteOutputConfig(SbgCaptureHandle handle, uint32 pendingBytes, uint32 outputMode, uint32 defaultOutputMask, uint64 timeStampNs);
+
+/*!
+ *	Returns the recorder statistics, can be called from any thread.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[out]	pStats					Recorder statistics.
+ *	\return								SBG_NO_ERROR if the statistics have been returned.
+ */
+SbgErrorCode sbgCaptureGetStats(SbgCaptureHandle handle, SbgCaptureStats *pStats);
+
+/*!
+ *	Write the remaining records, stop the writer thread and close the file.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\return								SBG_NO_ERROR if every record has been written.
+ */
+SbgErrorCode sbgCaptureClose(SbgCaptureHandle handle);
+
+#endif
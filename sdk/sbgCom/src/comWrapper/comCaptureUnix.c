@@ -0,0 +1,480 @@
+#define _GNU_SOURCE
+#include "comCapture.h"
+#include "../time/sbgTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+//------------------------------------------------------------------------------//
+//- Recorder definitions                                                       -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	State of a capture recorder.<br>
+ *	The reader thread owns pActive, the writer thread owns pPending while pendingSize isn't 0.
+ */
+struct _SbgCapture
+{
+	int					fileId;						/*!< Capture file. */
+	bool				directIo;					/*!< TRUE if the file has been opened with O_DIRECT. */
+	uint32				bufferSize;					/*!< Size of each buffer, a multiple of SBG_CAPTURE_BLOCK_SIZE. */
+	uint8				*pBuffers[2];				/*!< The two buffers, aligned on SBG_CAPTURE_BLOCK_SIZE. */
+	uint8				*pActive;					/*!< Buffer the records are appended to. */
+	uint32				activeSize;					/*!< Number of bytes in pActive. */
+	uint64				streamBytes;				/*!< Number of stream bytes stored, dropped records excluded. */
+	uint8				*pPending;					/*!< Full buffer handed to the writer thread. */
+	uint32				pendingSize;				/*!< Number of bytes in pPending, 0 once written. */
+	bool				stop;						/*!< Asks the writer thread to exit once pPending has been written. */
+	SbgCaptureStats		stats;						/*!< Statistics, protected by mutex. */
+	pthread_mutex_t		mutex;						/*!< Protects pPending, pendingSize, stop and stats. */
+	pthread_cond_t		condition;					/*!< Signaled when a buffer is handed to the writer thread or on stop. */
+	pthread_t			writerThread;				/*!< Writes the full buffers. */
+};
+
+//------------------------------------------------------------------------------//
+//- Recorder helpers                                                           -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Write a whole buffer, going on after partial writes and signals.
+ *	\param[in]	fileId		Capture file.
+ *	\param[in]	pBuffer		Bytes to write.
+ *	\param[in]	size		Number of bytes.
+ *	\return					SBG_NO_ERROR if every byte has been written.
+ */
+static SbgErrorCode sbgCaptureWriteAll(int fileId, const uint8 *pBuffer, size_t size)
+{
+	ssize_t numBytesWritten;
+
+	while (size > 0)
+	{
+		numBytesWritten = write(fileId, pBuffer, size);
+
+		if (numBytesWritten < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			fprintf(stderr, "sbgCaptureWriteAll: %s\n", strerror(errno));
+			return SBG_WRITE_ERROR;
+		}
+
+		pBuffer += numBytesWritten;
+		size -= (size_t)numBytesWritten;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Writer thread: writes each full buffer handed by the reader.
+ *	\param[in]	pArg		Our recorder.
+ *	\return					NULL.
+ */
+static void *sbgCaptureWriterThread(void *pArg)
+{
+	struct _SbgCapture *pCapture = (struct _SbgCapture*)pArg;
+	SbgErrorCode error;
+	const uint8 *pBuffer;
+	uint32 size;
+	uint64 startTime;
+	uint64 writeTime;
+
+	pthread_mutex_lock(&pCapture->mutex);
+
+	for (;;)
+	{
+		while ( (pCapture->pendingSize == 0) && (!pCapture->stop) )
+		{
+			pthread_cond_wait(&pCapture->condition, &pCapture->mutex);
+		}
+
+		if (pCapture->pendingSize == 0)
+		{
+			break;
+		}
+
+		pBuffer = pCapture->pPending;
+		size = pCapture->pendingSize;
+
+		//
+		// The disk can stall here for a while, the reader keeps on filling the other buffer
+		//
+		pthread_mutex_unlock(&pCapture->mutex);
+		startTime = sbgGetTimeNs();
+		error = sbgCaptureWriteAll(pCapture->fileId, pBuffer, size);
+		writeTime = sbgGetTimeNs() - startTime;
+		pthread_mutex_lock(&pCapture->mutex);
+
+		if (error == SBG_NO_ERROR)
+		{
+			pCapture->stats.writtenBytes += size;
+		}
+		else
+		{
+			pCapture->stats.writeErrors++;
+		}
+
+		if (writeTime > pCapture->stats.maxWriteTimeNs)
+		{
+			pCapture->stats.maxWriteTimeNs = writeTime;
+		}
+
+		pCapture->pendingSize = 0;
+	}
+
+	pthread_mutex_unlock(&pCapture->mutex);
+
+	return NULL;
+}
+
+/*!
+ *	Append bytes to the active buffer, handing it to the writer thread when it gets full.<br>
+ *	The caller has checked there is enough room in the active buffer and, if the writer is idle, in the next one.
+ *	\param[in]	pCapture	Our recorder.
+ *	\param[in]	pData		Bytes to append.
+ *	\param[in]	size		Number of bytes.
+ */
+static void sbgCaptureAppend(struct _SbgCapture *pCapture, const uint8 *pData, uint32 size)
+{
+	uint32 chunkSize;
+
+	while (size > 0)
+	{
+		chunkSize = pCapture->bufferSize - pCapture->activeSize;
+		if (chunkSize > size)
+		{
+			chunkSize = size;
+		}
+
+		memcpy(pCapture->pActive + pCapture->activeSize, pData, chunkSize);
+		pCapture->activeSize += chunkSize;
+		pData += chunkSize;
+		size -= chunkSize;
+
+		//
+		// Buffers are only written when full so every write keeps the O_DIRECT alignment
+		//
+		if (pCapture->activeSize == pCapture->bufferSize)
+		{
+			pthread_mutex_lock(&pCapture->mutex);
+			pCapture->pPending = pCapture->pActive;
+			pCapture->pendingSize = pCapture->activeSize;
+			pthread_cond_signal(&pCapture->condition);
+			pthread_mutex_unlock(&pCapture->mutex);
+
+			pCapture->pActive = (pCapture->pActive == pCapture->pBuffers[0])?pCapture->pBuffers[1]:pCapture->pBuffers[0];
+			pCapture->activeSize = 0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------//
+//- Recorder operations                                                        -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Create a capture file and start its writer thread.
+ *	\param[in]	fileName				Capture file to create, truncated if it exists.
+ *	\param[in]	pHeader					baudRate, outputMode and defaultOutputMask of the recorded device, the other fields are filled by the recorder.
+ *	\param[in]	bufferSize				Size of each of the two buffers, rounded up to SBG_CAPTURE_BLOCK_SIZE, 0 for SBG_CAPTURE_DEFAULT_BUFFER_SIZE.
+ *	\param[in]	directIo				TRUE to bypass the page cache with O_DIRECT, ignored if the file system doesn't support it.
+ *	\param[out]	pHandle					The created recorder.
+ *	\return								SBG_NO_ERROR if the capture has been created.
+ */
+SbgErrorCode sbgCaptureOpen(const char *fileName, const SbgCaptureHeader *pHeader, uint32 bufferSize, bool directIo, SbgCaptureHandle *pHandle)
+{
+	struct _SbgCapture *pCapture;
+	SbgCaptureHeader header;
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	//
+	// First, check input pointers
+	//
+	if ( (!fileName) || (!pHeader) || (!pHandle) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	*pHandle = SBG_INVALID_CAPTURE_HANDLE;
+
+	if (bufferSize == 0)
+	{
+		bufferSize = SBG_CAPTURE_DEFAULT_BUFFER_SIZE;
+	}
+	else if (bufferSize < SBG_CAPTURE_MIN_BUFFER_SIZE)
+	{
+		bufferSize = SBG_CAPTURE_MIN_BUFFER_SIZE;
+	}
+	bufferSize = (bufferSize + SBG_CAPTURE_BLOCK_SIZE - 1) & ~(uint32)(SBG_CAPTURE_BLOCK_SIZE - 1);
+
+	pCapture = (struct _SbgCapture*)calloc(1, sizeof(struct _SbgCapture));
+	if (!pCapture)
+	{
+		return SBG_MALLOC_FAILED;
+	}
+
+	if ( (posix_memalign((void**)&pCapture->pBuffers[0], SBG_CAPTURE_BLOCK_SIZE, bufferSize) != 0) ||
+		 (posix_memalign((void**)&pCapture->pBuffers[1], SBG_CAPTURE_BLOCK_SIZE, bufferSize) != 0) )
+	{
+		free(pCapture->pBuffers[0]);
+		free(pCapture);
+		return SBG_MALLOC_FAILED;
+	}
+
+	//
+	// Touch the buffers now rather than page faulting in the reader
+	//
+	memset(pCapture->pBuffers[0], 0, bufferSize);
+	memset(pCapture->pBuffers[1], 0, bufferSize);
+
+	pCapture->bufferSize = bufferSize;
+	pCapture->pActive = pCapture->pBuffers[0];
+	pCapture->fileId = -1;
+
+	//
+	// tmpfs and some other file systems refuse O_DIRECT, fall back to buffered writes
+	//
+#ifdef O_DIRECT
+	if (directIo)
+	{
+		pCapture->fileId = open(fileName, flags | O_DIRECT, 0644);
+		pCapture->directIo = (pCapture->fileId != -1);
+	}
+#else
+	// Avoid warnings
+	(void)directIo;
+#endif
+
+	if (pCapture->fileId == -1)
+	{
+		pCapture->fileId = open(fileName, flags, 0644);
+	}
+
+	if (pCapture->fileId == -1)
+	{
+		fprintf(stderr, "sbgCaptureOpen: Unable to create %s: %s\n", fileName, strerror(errno));
+		free(pCapture->pBuffers[0]);
+		free(pCapture->pBuffers[1]);
+		free(pCapture);
+		return SBG_ERROR;
+	}
+
+	pthread_mutex_init(&pCapture->mutex, NULL);
+	pthread_cond_init(&pCapture->condition, NULL);
+
+	if (pthread_create(&pCapture->writerThread, NULL, sbgCaptureWriterThread, pCapture) != 0)
+	{
+		fprintf(stderr, "sbgCaptureOpen: Unable to start the writer thread\n");
+		pthread_cond_destroy(&pCapture->condition);
+		pthread_mutex_destroy(&pCapture->mutex);
+		close(pCapture->fileId);
+		free(pCapture->pBuffers[0]);
+		free(pCapture->pBuffers[1]);
+		free(pCapture);
+		return SBG_ERROR;
+	}
+
+	//
+	// The header goes through the buffers like the records
+	//
+	header = *pHeader;
+	memcpy(header.magic, SBG_CAPTURE_MAGIC, SBG_CAPTURE_MAGIC_SIZE);
+	header.version = SBG_CAPTURE_VERSION;
+	header.headerSize = sizeof(SbgCaptureHeader);
+	header.reserved = 0;
+	header.startTimeNs = sbgGetTimeNs();
+	sbgCaptureAppend(pCapture, (const uint8*)&header, sizeof(header));
+
+	*pHandle = pCapture;
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Append a record unless the writer thread is too late to make room for it.
+ *	\param[in]	pCapture	Our recorder.
+ *	\param[in]	type		Record type.
+ *	\param[in]	pData		Bytes following the record header.
+ *	\param[in]	size		Number of bytes.
+ *	\param[in]	timeStampNs	Stamp of the record.
+ *	\return					SBG_NO_ERROR if the record has been stored, SBG_BUFFER_OVERFLOW if it has been dropped.
+ */
+static SbgErrorCode sbgCaptureAppendRecord(struct _SbgCapture *pCapture, uint32 type, const void *pData, uint32 size, uint64 timeStampNs)
+{
+	SbgCaptureRecord record;
+	uint32 recordSize;
+	bool writerBusy;
+
+	recordSize = sizeof(SbgCaptureRecord) + size;
+
+	//
+	// Only look at the writer thread when the record fills the active buffer
+	//
+	if (pCapture->activeSize + recordSize >= pCapture->bufferSize)
+	{
+		pthread_mutex_lock(&pCapture->mutex);
+		writerBusy = (pCapture->pendingSize != 0);
+
+		//
+		// Drop whole records so the capture stays readable
+		//
+		if ( (writerBusy) || (recordSize > pCapture->bufferSize) )
+		{
+			pCapture->stats.droppedRecords++;
+			pthread_mutex_unlock(&pCapture->mutex);
+			return SBG_BUFFER_OVERFLOW;
+		}
+
+		pthread_mutex_unlock(&pCapture->mutex);
+	}
+
+	record.timeStampNs = timeStampNs;
+	record.size = size;
+	record.type = type;
+
+	sbgCaptureAppend(pCapture, (const uint8*)&record, sizeof(record));
+	sbgCaptureAppend(pCapture, (const uint8*)pData, size);
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Append the bytes returned by one read of the device.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[in]	pData					Bytes returned by the read.
+ *	\param[in]	size					Number of bytes.
+ *	\param[in]	timeStampNs				sbgGetTimeNs time at which the read returned.
+ *	\return								SBG_NO_ERROR if the record has been stored, SBG_BUFFER_OVERFLOW if it has been dropped.
+ */
+SbgErrorCode sbgCaptureWrite(SbgCaptureHandle handle, const void *pData, uint32 size, uint64 timeStampNs)
+{
+	SbgErrorCode error;
+
+	if ( (handle == SBG_INVALID_CAPTURE_HANDLE) || (!pData) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	error = sbgCaptureAppendRecord(handle, SBG_CAPTURE_RECORD_STREAM, pData, size, timeStampNs);
+
+	if (error == SBG_NO_ERROR)
+	{
+		handle->streamBytes += size;
+	}
+
+	return error;
+}
+
+/*!
+ *	Append a change of the device output configuration.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[in]	pendingBytes			Number of the last written stream bytes that are sent with the new configuration.
+ *	\param[in]	outputMode				New device output mode.
+ *	\param[in]	defaultOutputMask		New device default output mask.
+ *	\param[in]	timeStampNs				sbgGetTimeNs time of the change.
+ *	\return								SBG_NO_ERROR if the record has been stored, SBG_BUFFER_OVERFLOW if it has been dropped.
+ */
+SbgErrorCode sbgCaptureWriteOutputConfig(SbgCaptureHandle handle, uint32 pendingBytes, uint32 outputMode, uint32 defaultOutputMask, uint64 timeStampNs)
+{
+	SbgCaptureOutputConfig config;
+
+	if (handle == SBG_INVALID_CAPTURE_HANDLE)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	//
+	// Pending bytes of a dropped record were never stored
+	//
+	config.streamOffset = (pendingBytes < handle->streamBytes)?handle->streamBytes - pendingBytes:0;
+	config.outputMode = outputMode;
+	config.defaultOutputMask = defaultOutputMask;
+
+	return sbgCaptureAppendRecord(handle, SBG_CAPTURE_RECORD_OUTPUT_CONFIG, &config, sizeof(config), timeStampNs);
+}
+
+/*!
+ *	Returns the recorder statistics, can be called from any thread.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\param[out]	pStats					Recorder statistics.
+ *	\return								SBG_NO_ERROR if the statistics have been returned.
+ */
+SbgErrorCode sbgCaptureGetStats(SbgCaptureHandle handle, SbgCaptureStats *pStats)
+{
+	if ( (handle == SBG_INVALID_CAPTURE_HANDLE) || (!pStats) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	pthread_mutex_lock(&handle->mutex);
+	*pStats = handle->stats;
+	pthread_mutex_unlock(&handle->mutex);
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Write the remaining records, stop the writer thread and close the file.
+ *	\param[in]	handle					A valid capture recorder.
+ *	\return								SBG_NO_ERROR if every record has been written.
+ */
+SbgErrorCode sbgCaptureClose(SbgCaptureHandle handle)
+{
+	SbgErrorCode error = SBG_NO_ERROR;
+
+	if (handle == SBG_INVALID_CAPTURE_HANDLE)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	//
+	// The writer thread exits once the pending buffer has been written
+	//
+	pthread_mutex_lock(&handle->mutex);
+	handle->stop = TRUE;
+	pthread_cond_signal(&handle->condition);
+	pthread_mutex_unlock(&handle->mutex);
+	pthread_join(handle->writerThread, NULL);
+
+	//
+	// The last buffer isn't full so its size doesn't meet the O_DIRECT alignment
+	//
+#ifdef O_DIRECT
+	if (handle->directIo)
+	{
+		fcntl(handle->fileId, F_SETFL, fcntl(handle->fileId, F_GETFL) & ~O_DIRECT);
+	}
+#endif
+
+	if (handle->activeSize > 0)
+	{
+		if (sbgCaptureWriteAll(handle->fileId, handle->pActive, handle->activeSize) == SBG_NO_ERROR)
+		{
+			handle->stats.writtenBytes += handle->activeSize;
+		}
+		else
+		{
+			handle->stats.writeErrors++;
+		}
+	}
+
+	if ( (close(handle->fileId) != 0) || (handle->stats.writeErrors > 0) )
+	{
+		error = SBG_WRITE_ERROR;
+	}
+
+	pthread_cond_destroy(&handle->condition);
+	pthread_mutex_destroy(&handle->mutex);
+	free(handle->pBuffers[0]);
+	free(handle->pBuffers[1]);
+	free(handle);
+
+	return error;
+}
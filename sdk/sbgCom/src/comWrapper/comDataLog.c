@@ -1,203 +1,618 @@
 #include "comWrapper.h"
+#include "../time/sbgTime.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+//------------------------------------------------------------------------------//
+//- Replay definitions                                                         -//
+//------------------------------------------------------------------------------//
+
+#define SBG_DATA_LOG_BITS_PER_BYTE			(10)					/*!< Start, 8 data and stop bits, used to pace raw streams. */
+#define SBG_DATA_LOG_DEFAULT_BAUD			(921600)				/*!< Baud rate used when neither the capture nor the caller give one. */
+#define SBG_DATA_LOG_MAX_CONFIGS			(8)						/*!< Output configuration changes read but not applied yet, a power of 2. */
 
 /*!
- * Open the specified device at a specified baud and create a new device handle
- * \param[in]	deviceName			Device name / address (COM21 , /dev/ttys0, depending on platform)
- * \param[in]	baudRate			Baudrate to be used
- * \param[out]	pHandle				Device handle returned
- * \return							SBG_NO_ERROR if the device could be oppened properly
+ *	State of a replayed log file.<br>
+ *	The file is mapped in memory: reads are views on the mapping, or a single memcpy from it.<br>
+ *	A capture (see comCapture.h) is replayed record by record with its recorded stamps.
+ *	Any other file is a raw byte stream, one record holding the whole file, stamped from the baud rate.<br>
+ *	Output configuration records are queued as soon as the stream record before them has been returned,
+ *	the protocol takes each one once it has parsed the bytes recorded before it.
  */
-SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHandle *pHandle)
+typedef struct _SbgDataLog
 {
-	SbgErrorCode error;
-	FILE *fp;
+	const uint8			*pMap;						/*!< Mapped file. */
+	size_t				mapSize;					/*!< Size of the mapped file. */
+	bool				isCapture;					/*!< TRUE if the file starts with a SbgCaptureHeader. */
+	SbgCaptureHeader	header;						/*!< Capture header, or the header of a raw stream. */
+	size_t				nextRecord;					/*!< Offset of the next record header. */
+	size_t				dataOffset;					/*!< Offset of the next byte to return in the current record. */
+	size_t				dataEnd;					/*!< Offset of the end of the current record. */
+	uint64				recordTimeStamp;			/*!< Recorded stamp of the last byte of the current record. */
+	uint64				firstTimeStamp;				/*!< Recorded stamp of the first record, origin of the replay. */
+	uint64				byteTimeNs;					/*!< Transmission time of one byte. */
+	double				speed;						/*!< Replay speed, 1 for real time, 0 for as fast as possible. */
+	uint64				replayStartNs;				/*!< sbgGetTimeNs at the first read, 0 before. */
+	uint64				streamBytes;				/*!< Number of stream bytes returned so far. */
+	SbgCaptureOutputConfig	configs[SBG_DATA_LOG_MAX_CONFIGS];	/*!< Output configuration changes not applied yet. */
+	uint32				configRead;					/*!< Free running index of the next change to apply. */
+	uint32				configWrite;				/*!< Free running index of the next change to queue. */
+} SbgDataLog;
 
-	
-	// Avoid warnings
-	baudRate;
+//------------------------------------------------------------------------------//
+//- Replay helpers                                                             -//
+//------------------------------------------------------------------------------//
 
+/*!
+ *	Moves to the next non empty stream record once the current one has been fully returned.<br>
+ *	Output configuration records met on the way are queued.
+ *	\param[in]	pLog		Our log file.
+ *	\return					TRUE if some bytes are left, FALSE at the end of the file.
+ */
+static bool sbgDataLogNextRecord(SbgDataLog *pLog)
+{
+	SbgCaptureRecord record;
+	size_t recordStart;
+	size_t recordEnd;
 
-	//
-	// First, check input pointers
-	//
-	if ((deviceName) && (pHandle))
+	while (pLog->dataOffset >= pLog->dataEnd)
 	{
-	
+		if ( (!pLog->isCapture) || (pLog->mapSize - pLog->nextRecord < sizeof(SbgCaptureRecord)) )
+		{
+			return FALSE;
+		}
+
 		//
-		// Then try to open the Log file
+		// Records aren't aligned in the file
 		//
-		fp = fopen(deviceName,"rb");
+		memcpy(&record, pLog->pMap + pLog->nextRecord, sizeof(record));
+
+		recordStart = pLog->nextRecord + sizeof(SbgCaptureRecord);
+		recordEnd = recordStart + record.size;
 
 		//
-		// Check file open result
+		// A recorder killed while writing leaves a truncated last record
 		//
-		if (fp)
+		if ( (record.size > pLog->mapSize) || (recordEnd > pLog->mapSize) )
 		{
-			// File opened. We have the file handle
-			error = SBG_NO_ERROR;
-			*pHandle = (void*)fp;
+			recordEnd = pLog->mapSize;
 		}
-		else
+		pLog->nextRecord = recordEnd;
+
+		if (record.type == SBG_CAPTURE_RECORD_STREAM)
 		{
-			// File not found
-			error = SBG_DEVICE_NOT_FOUND;
-			*pHandle = NULL;
+			pLog->dataOffset = recordStart;
+			pLog->dataEnd = recordEnd;
+			pLog->recordTimeStamp = record.timeStampNs;
+		}
+		else if ( (record.type == SBG_CAPTURE_RECORD_OUTPUT_CONFIG) && (recordEnd - recordStart >= sizeof(SbgCaptureOutputConfig)) )
+		{
+			//
+			// Changes are applied in order, if too many are waiting the oldest one is lost
+			//
+			if (pLog->configWrite - pLog->configRead == SBG_DATA_LOG_MAX_CONFIGS)
+			{
+				pLog->configRead++;
+			}
+
+			memcpy(&pLog->configs[pLog->configWrite & (SBG_DATA_LOG_MAX_CONFIGS - 1)], pLog->pMap + recordStart, sizeof(SbgCaptureOutputConfig));
+			pLog->configWrite++;
 		}
 	}
+
+	return TRUE;
+}
+
+/*!
+ *	Returns the recorded arrival time of a byte of the current record.
+ *	\param[in]	pLog		Our log file.
+ *	\param[in]	offset		Offset of the byte in the file.
+ *	\return					Recorded arrival time in ns.
+ */
+static uint64 sbgDataLogByteTimeStamp(const SbgDataLog *pLog, size_t offset)
+{
+	if (pLog->isCapture)
+	{
+		//
+		// The record stamp is the arrival of its last byte, the previous ones came one byte time apart
+		//
+		return pLog->recordTimeStamp - (uint64)(pLog->dataEnd - offset - 1) * pLog->byteTimeNs;
+	}
 	else
 	{
-		// Invalid parameter / null pointers
-		error = SBG_NULL_POINTER;
+		return (uint64)(offset + 1) * pLog->byteTimeNs;
 	}
+}
 
-	return error;
+/*!
+ *	Returns the monotonic time at which a recorded time is replayed.
+ *	\param[in]	pLog		Our log file.
+ *	\param[in]	timeStamp	Recorded time in ns.
+ *	\return					Replay time in ns.
+ */
+static uint64 sbgDataLogReplayTime(const SbgDataLog *pLog, uint64 timeStamp)
+{
+	return pLog->replayStartNs + (uint64)((double)(timeStamp - pLog->firstTimeStamp) / pLog->speed);
 }
 
 /*!
- * Close the device
- * \param[in]	handle				Device handle to be closed
- * \return							SBG_NO_ERROR if the device could be closed properly
+ *	Returns the end of the bytes of the current record that have already been received at a given time.
+ *	\param[in]	pLog		Our log file.
+ *	\param[in]	currentTime	sbgGetTimeNs time.
+ *	\return					Offset of the first byte not received yet.
  */
-SbgErrorCode sbgDeviceClose(SbgDeviceHandle handle)
+static size_t sbgDataLogAvailableEnd(const SbgDataLog *pLog, uint64 currentTime)
 {
-	SbgErrorCode error;
+	uint64 elapsed;
+	size_t availableEnd;
+
+	if (pLog->speed <= 0.0)
+	{
+		return pLog->dataEnd;
+	}
+
+	if (pLog->isCapture)
+	{
+		//
+		// Like the recorded read, the whole record arrives at once
+		//
+		return (currentTime >= sbgDataLogReplayTime(pLog, pLog->recordTimeStamp))?pLog->dataEnd:pLog->dataOffset;
+	}
+	else
+	{
+		elapsed = (uint64)((double)(currentTime - pLog->replayStartNs) * pLog->speed);
+		availableEnd = (size_t)(elapsed / pLog->byteTimeNs);
+
+		return (availableEnd < pLog->dataEnd)?availableEnd:pLog->dataEnd;
+	}
+}
+
+//------------------------------------------------------------------------------//
+//- Replay operations                                                          -//
+//------------------------------------------------------------------------------//
+
+/*!
+ * Open and map a log file: a capture or a raw byte stream
+ * \param[in]	deviceName			Log file path, optionally followed by ?speed=x (1 real time by default, 0 as fast as possible)
+ * \param[in]	baudRate			Baud rate used to stamp and pace raw streams
+ * \param[out]	pContext			Log file returned
+ * \return							SBG_NO_ERROR if the file could be oppened properly
+ */
+static SbgErrorCode sbgDataLogOpen(const char *deviceName, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	SbgErrorCode error = SBG_NO_ERROR;
+	SbgDataLog *pLog;
+	const char *pOptions;
+	char *pPath;
+	struct stat fileStat;
+	int fileId;
+	void *pMap;
+
+	//
+	// First, check input pointers
+	//
+	if ( (!deviceName) || (!pContext) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	pLog = (SbgDataLog*)calloc(1, sizeof(SbgDataLog));
+	pPath = strdup(deviceName);
+
+	if ( (!pLog) || (!pPath) )
+	{
+		free(pLog);
+		free(pPath);
+		return SBG_MALLOC_FAILED;
+	}
+
+	//
+	// Replay in real time unless asked otherwise: a consumer gets the frames at the rate it was designed for
+	//
+	pLog->speed = 1.0;
+
 	//
-	// Check parameter
+	// Split the path and the replay options
 	//
-	if (handle)
+	pOptions = strchr(deviceName, '?');
+	if (pOptions)
+	{
+		pPath[pOptions - deviceName] = '\0';
+
+		if (strstr(pOptions, "speed="))
+		{
+			pLog->speed = strtod(strstr(pOptions, "speed=") + strlen("speed="), NULL);
+
+			if (pLog->speed < 0.0)
+			{
+				fprintf(stderr, "sbgDataLogOpen: Invalid replay speed in %s\n", deviceName);
+				error = SBG_INVALID_PARAMETER;
+			}
+		}
+	}
+
+	//
+	// Map the whole file, the kernel reads it ahead as we go
+	//
+	if (error == SBG_NO_ERROR)
+	{
+		fileId = open(pPath, O_RDONLY);
+
+		if ( (fileId != -1) && (fstat(fileId, &fileStat) == 0) && (fileStat.st_size > 0) )
+		{
+			pMap = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fileId, 0);
+
+			if (pMap != MAP_FAILED)
+			{
+				madvise(pMap, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+				pLog->pMap = (const uint8*)pMap;
+				pLog->mapSize = (size_t)fileStat.st_size;
+			}
+			else
+			{
+				error = SBG_ERROR;
+			}
+		}
+		else
+		{
+			// File not found or empty
+			error = SBG_DEVICE_NOT_FOUND;
+		}
+
+		if (fileId != -1)
+		{
+			close(fileId);
+		}
+
+		if (error != SBG_NO_ERROR)
+		{
+			fprintf(stderr, "sbgDataLogOpen: Unable to map %s: %s\n", pPath, strerror(errno));
+		}
+	}
+
+	if (error == SBG_NO_ERROR)
 	{
 		//
-		// Try to Close file
+		// Captures start with their header, anything else is a raw stream
 		//
-		if (fclose((FILE*)handle) == 0)
+		if ( (pLog->mapSize >= sizeof(SbgCaptureHeader)) && (memcmp(pLog->pMap, SBG_CAPTURE_MAGIC, SBG_CAPTURE_MAGIC_SIZE) == 0) )
 		{
-			error = SBG_NO_ERROR;
+			memcpy(&pLog->header, pLog->pMap, sizeof(SbgCaptureHeader));
+			pLog->isCapture = TRUE;
+			pLog->nextRecord = (pLog->header.headerSize < pLog->mapSize)?pLog->header.headerSize:pLog->mapSize;
+			pLog->dataOffset = pLog->nextRecord;
+			pLog->dataEnd = pLog->nextRecord;
+
+			if ( (pLog->header.baudRate != 0) && (pLog->header.baudRate != SBG_CAPTURE_UNKNOWN) )
+			{
+				baudRate = pLog->header.baudRate;
+			}
 		}
 		else
 		{
-			error = SBG_ERROR;
+			memcpy(pLog->header.magic, SBG_CAPTURE_MAGIC, SBG_CAPTURE_MAGIC_SIZE);
+			pLog->header.version = SBG_CAPTURE_VERSION;
+			pLog->header.headerSize = 0;
+			pLog->header.baudRate = SBG_CAPTURE_UNKNOWN;
+			pLog->header.outputMode = SBG_CAPTURE_UNKNOWN;
+			pLog->header.defaultOutputMask = SBG_CAPTURE_UNKNOWN;
+			pLog->dataOffset = 0;
+			pLog->dataEnd = pLog->mapSize;
+			pLog->nextRecord = pLog->mapSize;
 		}
+
+		if (baudRate == 0)
+		{
+			baudRate = SBG_DATA_LOG_DEFAULT_BAUD;
+		}
+		pLog->byteTimeNs = SBG_DATA_LOG_BITS_PER_BYTE * 1000000000ull / baudRate;
+
+		//
+		// The replay starts at the first recorded byte
+		//
+		if (sbgDataLogNextRecord(pLog))
+		{
+			pLog->firstTimeStamp = sbgDataLogByteTimeStamp(pLog, pLog->dataOffset);
+		}
+
+		*pContext = pLog;
 	}
 	else
 	{
-		error = SBG_NULL_POINTER;
+		free(pLog);
+		*pContext = NULL;
 	}
 
+	free(pPath);
+
 	return error;
 }
 
 /*!
- * Change the baud rate out the opened device
- * \param[in]	handle				Device handle returned
- * \param[in]	baudRate			New baudrate to apply on COM port
+ * Close the device
+ * \param[in]	context				Log file to be closed
+ * \return							SBG_NO_ERROR if the device could be closed properly
+ */
+static SbgErrorCode sbgDataLogClose(SbgDeviceContext context)
+{
+	SbgDataLog *pLog = (SbgDataLog*)context;
+
+	munmap((void*)pLog->pMap, pLog->mapSize);
+	free(pLog);
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ * Change the baud rate used to pace and stamp raw streams
+ * \param[in]	context				Log file
+ * \param[in]	baudRate			New baudrate
  * \return							SBG_NO_ERROR if baudrate could be changed properly
  */
-SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
+static SbgErrorCode sbgDataLogChangeBaud(SbgDeviceContext context, uint32 baudRate)
 {
-	// Avoid warnings
-	baudRate;
-	handle;
+	SbgDataLog *pLog = (SbgDataLog*)context;
 
-	//
-	// Dummy function
-	//
-	return SBG_ERROR;
+	if ( (!pLog->isCapture) && (baudRate > 0) )
+	{
+		pLog->byteTimeNs = SBG_DATA_LOG_BITS_PER_BYTE * 1000000000ull / baudRate;
+	}
+
+	return SBG_NO_ERROR;
 }
 
 /*!
- * Write some bytes to the tx queue
- * \param[in]	handle				Device handle returned
+ * Nobody listens to a log file: the bytes are dropped
+ * \param[in]	context				Log file
  * \param[in]	pBuffer				Buffer to be sent through interface
  * \param[in]	numBytesToWrite		Size of the buffer in bytes
- * \return							SBG_NO_ERROR if write could be done
+ * \return							SBG_NO_ERROR
+ */
+static SbgErrorCode sbgDataLogWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	// Avoid warnings
+	(void)context;
+	(void)numBytesToWrite;
+
+	return (pBuffer)?SBG_NO_ERROR:SBG_NULL_POINTER;
+}
+
+/*!
+ * Returns a view on the next replayed bytes, at most one record
+ * \param[in]	context				Log file
+ * \param[out]	ppData				Pointer to the bytes in the mapping
+ * \param[in]	maxSize				Max number of bytes to return
+ * \param[out]	pSize				Actual number of bytes in the view
+ * \param[out]	pTimeStampNs		Replayed arrival time of the last byte of the view
+ * \return							SBG_NO_ERROR if one or more bytes are returned
  */
-SbgErrorCode sbgDeviceWrite(SbgDeviceHandle handle, const void *pBuffer, uint32 numBytesToWrite)
+static SbgErrorCode sbgDataLogReadView(SbgDeviceContext context, const void **ppData, uint32 maxSize, uint32 *pSize, uint64 *pTimeStampNs)
 {
-	pBuffer;
-	numBytesToWrite;
-	handle;
+	SbgDataLog *pLog = (SbgDataLog*)context;
+	uint64 currentTime;
+	size_t availableEnd;
+	size_t size;
+
+	*pSize = 0;
+
+	if ( (maxSize == 0) || (!sbgDataLogNextRecord(pLog)) )
+	{
+		return SBG_READ_ERROR;
+	}
+
+	currentTime = sbgGetTimeNs();
+	if (pLog->replayStartNs == 0)
+	{
+		pLog->replayStartNs = currentTime;
+	}
+
 	//
-	// Dummy function
+	// When paced, only return what the link would have delivered by now
 	//
-	return SBG_ERROR;
+	availableEnd = sbgDataLogAvailableEnd(pLog, currentTime);
+	if (availableEnd <= pLog->dataOffset)
+	{
+		return SBG_READ_ERROR;
+	}
+
+	size = availableEnd - pLog->dataOffset;
+	if (size > maxSize)
+	{
+		size = maxSize;
+	}
+
+	*ppData = pLog->pMap + pLog->dataOffset;
+	*pSize = (uint32)size;
+	pLog->dataOffset += size;
+	pLog->streamBytes += size;
+
+	//
+	// Stamps keep the recorded spacing whatever the replay speed, so a replay is deterministic
+	//
+	if (pTimeStampNs)
+	{
+		*pTimeStampNs = pLog->replayStartNs + (sbgDataLogByteTimeStamp(pLog, pLog->dataOffset - 1) - pLog->firstTimeStamp);
+	}
+
+	//
+	// Queue the output configuration changes recorded right after these bytes before they are parsed
+	//
+	sbgDataLogNextRecord(pLog);
+
+	return SBG_NO_ERROR;
 }
 
 /*!
- * Read some bytes from the rx queue
- * \param[in]	handle				Device handle returned
+ * Read some bytes from the file, stamped with their replayed arrival time
+ * \param[in]	context				Log file
  * \param[in]	pBuffer				Buffer to be sent through interface
  * \param[in]	numBytesToRead		Max number of bytes to be read
  * \param[out]	pNumBytesRead		Actual number read by the function
+ * \param[out]	pTimeStampNs		Replayed arrival time of the last read byte
  * \return							SBG_NO_ERROR if one or more bytes read
  */
-SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+static SbgErrorCode sbgDataLogReadStamped(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs)
 {
 	SbgErrorCode error;
+	const void *pData;
+	uint32 size;
 
-	//
-	// Check input parameters
-	//
-	if ((handle) && (pBuffer) && (pNumBytesRead))
+	if (!pBuffer)
 	{
-		//
-		// Then try to read the file
-		//
-		*pNumBytesRead = fread(pBuffer,sizeof(uint8),numBytesToRead,(FILE*)handle);
+		return SBG_NULL_POINTER;
+	}
 
-		//
-		// if no byte were read and the user wanted 1 or more byte to be read, return appropriate error code
-		//
-		if (!(*pNumBytesRead) && (numBytesToRead))
-		{
-			// No more unread byte in the file
-			error = SBG_READ_ERROR;
-		}
-		else
-		{
-			// At least 1 byte could be read (or user didn't want any byte to be read)
-			error = SBG_NO_ERROR;
-		}
+	error = sbgDataLogReadView(context, &pData, numBytesToRead, &size, pTimeStampNs);
+
+	if (error == SBG_NO_ERROR)
+	{
+		memcpy(pBuffer, pData, size);
 	}
-	else
+
+	if (pNumBytesRead)
 	{
-		// Invalid param
-		error = SBG_NULL_POINTER;
+		*pNumBytesRead = size;
 	}
+
 	return error;
 }
 
 /*!
- * Flush the RX and TX buffers (remove all old data)
- * \param[in]	handle				Device handle returned
- * \return							SBG_NO_ERROR if everything is OK
+ * Read some bytes from the file
+ * \param[in]	context				Log file
+ * \param[in]	pBuffer				Buffer to be sent through interface
+ * \param[in]	numBytesToRead		Max number of bytes to be read
+ * \param[out]	pNumBytesRead		Actual number read by the function
+ * \return							SBG_NO_ERROR if one or more bytes read
+ */
+static SbgErrorCode sbgDataLogRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	return sbgDataLogReadStamped(context, pBuffer, numBytesToRead, pNumBytesRead, NULL);
+}
+
+/*!
+ * Block until the next replayed byte is due or the deadline is reached.
+ * \param[in]	context				Log file
+ * \param[in]	deadlineNs			Absolute monotonic time in ns at which we give up
+ * \return							SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if none arrived in time
  */
-SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle)
+static SbgErrorCode sbgDataLogWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
 {
-	// Avoid warnings
-	handle;
+	SbgDataLog *pLog = (SbgDataLog*)context;
+	uint64 dueTime;
 
 	//
-	// Dummy function
+	// Once the file has been replayed behave like a silent link instead of spinning
 	//
-	return SBG_ERROR;
+	if (!sbgDataLogNextRecord(pLog))
+	{
+		sbgSleepUntilNs(deadlineNs);
+		return SBG_TIME_OUT;
+	}
+
+	if (pLog->speed <= 0.0)
+	{
+		return SBG_NO_ERROR;
+	}
+
+	if (pLog->replayStartNs == 0)
+	{
+		pLog->replayStartNs = sbgGetTimeNs();
+	}
+
+	dueTime = sbgDataLogReplayTime(pLog, pLog->isCapture?pLog->recordTimeStamp:sbgDataLogByteTimeStamp(pLog, pLog->dataOffset));
+
+	if (dueTime <= deadlineNs)
+	{
+		sbgSleepUntilNs(dueTime);
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		sbgSleepUntilNs(deadlineNs);
+		return SBG_TIME_OUT;
+	}
 }
 
 /*!
- *	Defines the serial DTR and RTS pins states.
- *	\param[in]	handle				The serial communication handle.
- *	\param[in]	function			One of the SbgEscapeComm enum function.
- *	\return							SBG_NO_ERROR if the pin state has been defined.
+ * A replay is deterministic: flushing doesn't drop recorded bytes
+ * \param[in]	context				Log file
+ * \return							SBG_NO_ERROR
  */
-SbgErrorCode sbgSetEscapeComm(SbgDeviceHandle handle, SbgEscapeComm function)
+static SbgErrorCode sbgDataLogFlush(SbgDeviceContext context)
 {
 	// Avoid warnings
-	handle;
-	function;
+	(void)context;
 
-	//
-	// Dummy function
-	//
-	return SBG_ERROR;
-}
\ No newline at end of file
+	return SBG_NO_ERROR;
+}
+
+/*!
+ * Returns the capture header
+ * \param[in]	context				Log file
+ * \param[out]	pHeader				Capture header, a raw stream has SBG_CAPTURE_UNKNOWN fields
+ * \return							SBG_NO_ERROR
+ */
+static SbgErrorCode sbgDataLogGetCaptureHeader(SbgDeviceContext context, SbgCaptureHeader *pHeader)
+{
+	*pHeader = ((SbgDataLog*)context)->header;
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ * Returns the next output configuration change once the protocol has parsed the bytes recorded before it
+ * \param[in]	context				Log file
+ * \param[in]	pendingBytes		Number of read bytes not parsed yet
+ * \param[out]	pConfig				Output configuration from the next parsed byte on
+ * \return							SBG_NO_ERROR if a change has been returned, SBG_NOT_READY if none applies yet
+ */
+static SbgErrorCode sbgDataLogNextOutputConfig(SbgDeviceContext context, uint32 pendingBytes, SbgCaptureOutputConfig *pConfig)
+{
+	SbgDataLog *pLog = (SbgDataLog*)context;
+	const SbgCaptureOutputConfig *pNext;
+	uint64 parsedBytes;
+
+	if (pLog->configRead == pLog->configWrite)
+	{
+		return SBG_NOT_READY;
+	}
+
+	pNext = &pLog->configs[pLog->configRead & (SBG_DATA_LOG_MAX_CONFIGS - 1)];
+	parsedBytes = (pendingBytes < pLog->streamBytes)?pLog->streamBytes - pendingBytes:0;
+
+	if (pNext->streamOffset > parsedBytes)
+	{
+		return SBG_NOT_READY;
+	}
+
+	*pConfig = *pNext;
+	pLog->configRead++;
+
+	return SBG_NO_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- Transport                                                                  -//
+//------------------------------------------------------------------------------//
+
+const SbgDeviceOps sbgDataLogOps =
+{
+	.pScheme				= "file",
+	.pOpen					= sbgDataLogOpen,
+	.pClose					= sbgDataLogClose,
+	.pChangeBaud			= sbgDataLogChangeBaud,
+	.pWrite					= sbgDataLogWrite,
+	.pRead					= sbgDataLogRead,
+	.pReadStamped			= sbgDataLogReadStamped,
+	.pWaitReadableUntil		= sbgDataLogWaitReadableUntil,
+	.pFlush					= sbgDataLogFlush,
+	.pGetCaptureHeader		= sbgDataLogGetCaptureHeader,
+	.pNextOutputConfig		= sbgDataLogNextOutputConfig
+};
@@ -0,0 +1,623 @@
+#include "comWrapper.h"
+#include "../time/sbgTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------//
+//- Fault injection definitions                                                -//
+//------------------------------------------------------------------------------//
+
+#define SBG_FAULT_READ_SIZE					(1024)					/*!< Max number of bytes read at once from the wrapped device. */
+#define SBG_FAULT_BUFFER_SIZE				(8192)					/*!< Faulted bytes waiting to be read, room for duplicates and bursts. */
+#define SBG_FAULT_DEFAULT_BURST_LENGTH		(32)					/*!< Default length of an injected burst. */
+#define SBG_FAULT_MAX_BURST_LENGTH			(1024)					/*!< Max length of an injected burst. */
+#define SBG_FAULT_SYNC						(0xFF)					/*!< SYNC char of the protocol frames, see protocol.h. */
+#define SBG_FAULT_STX						(0x02)					/*!< STX char of the protocol frames, see protocol.h. */
+
+/*!
+ *	State of a device wrapped by the fault injection transport.<br>
+ *	Bytes read from the wrapped device are faulted into a buffer then returned in fragments of random sizes.
+ *	Every random draw comes from a seeded generator so a given seed and input always give the same stream.
+ */
+typedef struct _SbgFaultDevice
+{
+	SbgDeviceHandle		innerHandle;						/*!< Wrapped device. */
+	uint64				rngState;							/*!< xorshift64* generator state. */
+	uint32				maxFragment;						/*!< Max size returned by a read, 0 to return everything available. */
+	double				flipProbability;					/*!< Probability for each bit to be flipped. */
+	double				dropProbability;					/*!< Probability for each byte to be dropped. */
+	double				dupProbability;						/*!< Probability for each byte to be duplicated. */
+	double				burstProbability;					/*!< Probability to inject a burst before each byte. */
+	uint32				burstLength;						/*!< Max length of an injected burst. */
+	uint8				buffer[SBG_FAULT_BUFFER_SIZE];		/*!< Faulted bytes not read yet. */
+	uint32				bufferRead;							/*!< Offset of the next byte to return. */
+	uint32				bufferWrite;						/*!< Number of bytes in the buffer. */
+	uint64				bufferTimeStamp;					/*!< Time at which the buffered bytes have been read from the wrapped device. */
+	SbgFaultStats		stats;								/*!< Injected faults. */
+} SbgFaultDevice;
+
+//------------------------------------------------------------------------------//
+//- Fault injection helpers                                                    -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Returns the next 64 bits random value.
+ *	\param[in]	pFault		Our faulted device.
+ *	\return					Random value.
+ */
+static uint64 sbgFaultRandom(SbgFaultDevice *pFault)
+{
+	pFault->rngState ^= pFault->rngState >> 12;
+	pFault->rngState ^= pFault->rngState << 25;
+	pFault->rngState ^= pFault->rngState >> 27;
+
+	return pFault->rngState * 2685821657736338717ull;
+}
+
+/*!
+ *	Returns a random value in [0, 1).
+ *	\param[in]	pFault		Our faulted device.
+ *	\return					Uniform random value.
+ */
+static double sbgFaultUniform(SbgFaultDevice *pFault)
+{
+	return (double)(sbgFaultRandom(pFault) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*!
+ *	Returns TRUE with a given probability, without drawing when the probability is 0.
+ *	\param[in]	pFault		Our faulted device.
+ *	\param[in]	probability	Probability of the event.
+ *	\return					TRUE if the event happens.
+ */
+static bool sbgFaultEvent(SbgFaultDevice *pFault, double probability)
+{
+	return (probability > 0.0) && (sbgFaultUniform(pFault) < probability);
+}
+
+/*!
+ *	Append a burst of bytes that look like the start of frames: SYNC and STX chars, sometimes followed by a plausible header.<br>
+ *	These make the parser enter its header and data states and pay for a full resync.
+ *	\param[in]	pFault		Our faulted device.
+ */
+static void sbgFaultInjectBurst(SbgFaultDevice *pFault)
+{
+	uint32 length;
+	uint32 i;
+	uint64 value;
+
+	length = 1 + (uint32)(sbgFaultRandom(pFault) % pFault->burstLength);
+
+	//
+	// Always keep room for the rest of the chunk, each byte may be duplicated
+	//
+	if (pFault->bufferWrite + length + 2*SBG_FAULT_READ_SIZE > SBG_FAULT_BUFFER_SIZE)
+	{
+		return;
+	}
+
+	for (i = 0; i < length; i++)
+	{
+		value = sbgFaultRandom(pFault);
+
+		switch (value & 0x03)
+		{
+		case 0:
+			pFault->buffer[pFault->bufferWrite + i] = SBG_FAULT_SYNC;
+			break;
+		case 1:
+			pFault->buffer[pFault->bufferWrite + i] = SBG_FAULT_STX;
+			break;
+		case 2:
+			//
+			// A complete false header with a small size so the parser waits for a whole false frame
+			//
+			if (i + 5 <= length)
+			{
+				pFault->buffer[pFault->bufferWrite + i] = SBG_FAULT_SYNC;
+				pFault->buffer[pFault->bufferWrite + i + 1] = SBG_FAULT_STX;
+				pFault->buffer[pFault->bufferWrite + i + 2] = (uint8)(value >> 8);
+				pFault->buffer[pFault->bufferWrite + i + 3] = 0;
+				pFault->buffer[pFault->bufferWrite + i + 4] = (uint8)(value >> 16) & 0x7F;
+				i += 4;
+				break;
+			}
+			pFault->buffer[pFault->bufferWrite + i] = SBG_FAULT_SYNC;
+			break;
+		default:
+			pFault->buffer[pFault->bufferWrite + i] = (uint8)(value >> 8);
+			break;
+		}
+	}
+
+	pFault->bufferWrite += length;
+	pFault->stats.bursts++;
+	pFault->stats.burstBytes += length;
+}
+
+/*!
+ *	Read a chunk from the wrapped device and append it, faulted, to the buffer.
+ *	\param[in]	pFault		Our faulted device.
+ *	\return					SBG_NO_ERROR if some bytes have been read from the wrapped device.
+ */
+static SbgErrorCode sbgFaultFill(SbgFaultDevice *pFault)
+{
+	uint8 chunk[SBG_FAULT_READ_SIZE];
+	uint32 numBytesRead;
+	SbgErrorCode error;
+	uint32 i;
+	uint32 bit;
+	uint8 value;
+
+	error = sbgDeviceReadStamped(pFault->innerHandle, chunk, sizeof(chunk), &numBytesRead, &pFault->bufferTimeStamp);
+
+	if ( (error != SBG_NO_ERROR) || (numBytesRead == 0) )
+	{
+		return (error != SBG_NO_ERROR)?error:SBG_NOT_READY;
+	}
+
+	pFault->bufferRead = 0;
+	pFault->bufferWrite = 0;
+	pFault->stats.bytesRead += numBytesRead;
+
+	//
+	// Each input byte takes at most two bytes, bursts only take the room left by the whole chunk
+	//
+	for (i = 0; i < numBytesRead; i++)
+	{
+		if (sbgFaultEvent(pFault, pFault->burstProbability))
+		{
+			sbgFaultInjectBurst(pFault);
+		}
+
+		if (sbgFaultEvent(pFault, pFault->dropProbability))
+		{
+			pFault->stats.bytesDropped++;
+			continue;
+		}
+
+		value = chunk[i];
+
+		if (pFault->flipProbability > 0.0)
+		{
+			for (bit = 0; bit < 8; bit++)
+			{
+				if (sbgFaultUniform(pFault) < pFault->flipProbability)
+				{
+					value ^= (uint8)(1 << bit);
+					pFault->stats.bitsFlipped++;
+				}
+			}
+		}
+
+		pFault->buffer[pFault->bufferWrite++] = value;
+
+		if (sbgFaultEvent(pFault, pFault->dupProbability))
+		{
+			pFault->buffer[pFault->bufferWrite++] = value;
+			pFault->stats.bytesDuplicated++;
+		}
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Parse the fault options.
+ *	\param[in]	pFault		Our faulted device.
+ *	\param[in]	pOptions	Options such as seed=1&frag=16&flip=1e-5&drop=1e-4&dup=1e-4&burst=1e-4&burstlen=32.
+ *	\return					SBG_NO_ERROR if every option is valid.
+ */
+static SbgErrorCode sbgFaultParseOptions(SbgFaultDevice *pFault, const char *pOptions)
+{
+	const char *pOption = pOptions;
+	const char *pValue;
+	size_t nameLength;
+	double value;
+
+	while ( (pOption) && (*pOption) )
+	{
+		pValue = strchr(pOption, '=');
+
+		if (!pValue)
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+		nameLength = (size_t)(pValue - pOption);
+		value = strtod(pValue + 1, NULL);
+
+		if (value < 0.0)
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+		if ( (nameLength == 4) && (strncmp(pOption, "seed", 4) == 0) )
+		{
+			pFault->rngState = strtoull(pValue + 1, NULL, 0);
+		}
+		else if ( (nameLength == 4) && (strncmp(pOption, "frag", 4) == 0) )
+		{
+			pFault->maxFragment = (uint32)value;
+		}
+		else if ( (nameLength == 4) && (strncmp(pOption, "flip", 4) == 0) )
+		{
+			pFault->flipProbability = value;
+		}
+		else if ( (nameLength == 4) && (strncmp(pOption, "drop", 4) == 0) )
+		{
+			pFault->dropProbability = value;
+		}
+		else if ( (nameLength == 3) && (strncmp(pOption, "dup", 3) == 0) )
+		{
+			pFault->dupProbability = value;
+		}
+		else if ( (nameLength == 5) && (strncmp(pOption, "burst", 5) == 0) )
+		{
+			pFault->burstProbability = value;
+		}
+		else if ( (nameLength == 8) && (strncmp(pOption, "burstlen", 8) == 0) )
+		{
+			pFault->burstLength = (uint32)value;
+		}
+		else
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+		pOption = strchr(pValue, '&');
+		if (pOption)
+		{
+			pOption++;
+		}
+	}
+
+	if ( (pFault->burstLength == 0) || (pFault->burstLength > SBG_FAULT_MAX_BURST_LENGTH) )
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+
+	//
+	// xorshift never leaves the 0 state
+	//
+	if (pFault->rngState == 0)
+	{
+		pFault->rngState = 0x9E3779B97F4A7C15ull;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- Operations                                                                 -//
+//------------------------------------------------------------------------------//
+
+/*!
+ * Open the wrapped device
+ * \param[in]	deviceName			Wrapped device URI followed by #options, for example file://capture.bin?speed=0#seed=3&flip=1e-5
+ * \param[in]	baudRate			Baud rate passed to the wrapped device
+ * \param[out]	pContext			Faulted device returned
+ * \return							SBG_NO_ERROR if the device could be oppened properly
+ */
+static SbgErrorCode sbgFaultOpen(const char *deviceName, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	SbgErrorCode error;
+	SbgFaultDevice *pFault;
+	const char *pOptions;
+	char *pInnerName;
+
+	//
+	// First, check input pointers
+	//
+	if ( (!deviceName) || (!pContext) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	*pContext = NULL;
+
+	pFault = (SbgFaultDevice*)calloc(1, sizeof(SbgFaultDevice));
+	pInnerName = strdup(deviceName);
+
+	if ( (!pFault) || (!pInnerName) )
+	{
+		free(pFault);
+		free(pInnerName);
+		return SBG_MALLOC_FAILED;
+	}
+
+	//
+	// The options follow a '#' so the wrapped URI keeps its own '?' options
+	//
+	pFault->burstLength = SBG_FAULT_DEFAULT_BURST_LENGTH;
+	pOptions = strchr(deviceName, '#');
+
+	if (pOptions)
+	{
+		pInnerName[pOptions - deviceName] = '\0';
+		pOptions++;
+	}
+
+	error = sbgFaultParseOptions(pFault, pOptions);
+
+	if (error == SBG_NO_ERROR)
+	{
+		error = sbgDeviceOpen(pInnerName, baudRate, &pFault->innerHandle);
+	}
+	else
+	{
+		fprintf(stderr, "sbgFaultOpen: Invalid fault options in %s\n", deviceName);
+	}
+
+	if (error == SBG_NO_ERROR)
+	{
+		*pContext = pFault;
+	}
+	else
+	{
+		free(pFault);
+	}
+
+	free(pInnerName);
+
+	return error;
+}
+
+/*!
+ * Close the wrapped device
+ * \param[in]	context				Faulted device to be closed
+ * \return							SBG_NO_ERROR if the device could be closed properly
+ */
+static SbgErrorCode sbgFaultClose(SbgDeviceContext context)
+{
+	SbgFaultDevice *pFault = (SbgFaultDevice*)context;
+	SbgErrorCode error;
+
+	error = sbgDeviceClose(pFault->innerHandle);
+	free(pFault);
+
+	return error;
+}
+
+/*!
+ * Change the baud rate of the wrapped device
+ * \param[in]	context				Faulted device
+ * \param[in]	baudRate			New baudrate
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultChangeBaud(SbgDeviceContext context, uint32 baudRate)
+{
+	return sbgDeviceChangeBaud(((SbgFaultDevice*)context)->innerHandle, baudRate);
+}
+
+/*!
+ * Write some bytes to the wrapped device, faults are only injected in the received bytes
+ * \param[in]	context				Faulted device
+ * \param[in]	pBuffer				Buffer to be sent through interface
+ * \param[in]	numBytesToWrite		Size of the buffer in bytes
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	return sbgDeviceWrite(((SbgFaultDevice*)context)->innerHandle, pBuffer, numBytesToWrite);
+}
+
+/*!
+ * Read a fragment of the faulted bytes
+ * \param[in]	context				Faulted device
+ * \param[in]	pBuffer				Buffer to be sent through interface
+ * \param[in]	numBytesToRead		Max number of bytes to be read
+ * \param[out]	pNumBytesRead		Actual number read by the function
+ * \param[out]	pTimeStampNs		Time at which the wrapped device returned these bytes
+ * \return							SBG_NO_ERROR if the read has succeeded, possibly without bytes
+ */
+static SbgErrorCode sbgFaultReadStamped(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs)
+{
+	SbgFaultDevice *pFault = (SbgFaultDevice*)context;
+	SbgErrorCode error = SBG_NO_ERROR;
+	uint32 fragmentSize;
+	uint32 numBytes;
+
+	if (pNumBytesRead)
+	{
+		*pNumBytesRead = 0;
+	}
+
+	if (!pBuffer)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	//
+	// Drops may leave a whole chunk empty, so keep reading until some bytes come or the wrapped device is empty
+	//
+	while (pFault->bufferRead >= pFault->bufferWrite)
+	{
+		error = sbgFaultFill(pFault);
+
+		if (error != SBG_NO_ERROR)
+		{
+			return (error == SBG_NOT_READY)?SBG_NO_ERROR:error;
+		}
+	}
+
+	numBytes = pFault->bufferWrite - pFault->bufferRead;
+
+	if (pFault->maxFragment > 0)
+	{
+		fragmentSize = 1 + (uint32)(sbgFaultRandom(pFault) % pFault->maxFragment);
+
+		if (numBytes > fragmentSize)
+		{
+			numBytes = fragmentSize;
+		}
+	}
+
+	if (numBytes > numBytesToRead)
+	{
+		numBytes = numBytesToRead;
+	}
+
+	memcpy(pBuffer, pFault->buffer + pFault->bufferRead, numBytes);
+	pFault->bufferRead += numBytes;
+	pFault->stats.bytesDelivered += numBytes;
+	pFault->stats.reads++;
+
+	if (pNumBytesRead)
+	{
+		*pNumBytesRead = numBytes;
+	}
+
+	if (pTimeStampNs)
+	{
+		*pTimeStampNs = pFault->bufferTimeStamp;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ * Read a fragment of the faulted bytes
+ * \param[in]	context				Faulted device
+ * \param[in]	pBuffer				Buffer to be sent through interface
+ * \param[in]	numBytesToRead		Max number of bytes to be read
+ * \param[out]	pNumBytesRead		Actual number read by the function
+ * \return							SBG_NO_ERROR if the read has succeeded, possibly without bytes
+ */
+static SbgErrorCode sbgFaultRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	return sbgFaultReadStamped(context, pBuffer, numBytesToRead, pNumBytesRead, NULL);
+}
+
+/*!
+ * Block until some faulted bytes are pending or the wrapped device is readable
+ * \param[in]	context				Faulted device
+ * \param[in]	deadlineNs			Absolute monotonic time in ns at which we give up
+ * \return							SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if none arrived in time
+ */
+static SbgErrorCode sbgFaultWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
+{
+	SbgFaultDevice *pFault = (SbgFaultDevice*)context;
+
+	if (pFault->bufferRead < pFault->bufferWrite)
+	{
+		return SBG_NO_ERROR;
+	}
+
+	return sbgDeviceWaitReadableUntil(pFault->innerHandle, deadlineNs);
+}
+
+/*!
+ * Drop the pending faulted bytes and flush the wrapped device
+ * \param[in]	context				Faulted device
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultFlush(SbgDeviceContext context)
+{
+	SbgFaultDevice *pFault = (SbgFaultDevice*)context;
+
+	pFault->bufferRead = 0;
+	pFault->bufferWrite = 0;
+
+	return sbgDeviceFlush(pFault->innerHandle);
+}
+
+/*!
+ * Defines the DTR and RTS pins states of the wrapped device
+ * \param[in]	context				Faulted device
+ * \param[in]	function			One of the SbgEscapeComm enum function
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultSetEscapeComm(SbgDeviceContext context, SbgEscapeComm function)
+{
+	return sbgSetEscapeComm(((SbgFaultDevice*)context)->innerHandle, function);
+}
+
+/*!
+ * Set the low latency mode of the wrapped device
+ * \param[in]	context				Faulted device
+ * \param[in]	latencyTimerMs		Latency timer to apply in ms, 0 to leave it unchanged
+ * \param[out]	pInfo				Effective settings after the call, may be NULL
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultSetLowLatency(SbgDeviceContext context, uint32 latencyTimerMs, SbgDeviceLatencyInfo *pInfo)
+{
+	return sbgDeviceSetLowLatency(((SbgFaultDevice*)context)->innerHandle, latencyTimerMs, pInfo);
+}
+
+/*!
+ * Returns the latency related settings of the wrapped device
+ * \param[in]	context				Faulted device
+ * \param[out]	pInfo				Effective settings
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultGetLatencyInfo(SbgDeviceContext context, SbgDeviceLatencyInfo *pInfo)
+{
+	return sbgDeviceGetLatencyInfo(((SbgFaultDevice*)context)->innerHandle, pInfo);
+}
+
+/*!
+ * Returns the capture header of the wrapped device
+ * \param[in]	context				Faulted device
+ * \param[out]	pHeader				Capture header
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultGetCaptureHeader(SbgDeviceContext context, SbgCaptureHeader *pHeader)
+{
+	return sbgDeviceGetCaptureHeader(((SbgFaultDevice*)context)->innerHandle, pHeader);
+}
+
+/*!
+ * Returns the output configuration changes of the wrapped device, injected bytes shift where they apply
+ * \param[in]	context				Faulted device
+ * \param[in]	pendingBytes		Number of read bytes not parsed yet
+ * \param[out]	pConfig				Output configuration from the next parsed byte on
+ * \return							Result of the wrapped device
+ */
+static SbgErrorCode sbgFaultNextOutputConfig(SbgDeviceContext context, uint32 pendingBytes, SbgCaptureOutputConfig *pConfig)
+{
+	return sbgDeviceNextOutputConfig(((SbgFaultDevice*)context)->innerHandle, pendingBytes, pConfig);
+}
+
+//------------------------------------------------------------------------------//
+//- Transport                                                                  -//
+//------------------------------------------------------------------------------//
+
+const SbgDeviceOps sbgFaultOps =
+{
+	.pScheme				= "fault",
+	.pOpen					= sbgFaultOpen,
+	.pClose					= sbgFaultClose,
+	.pChangeBaud			= sbgFaultChangeBaud,
+	.pWrite					= sbgFaultWrite,
+	.pRead					= sbgFaultRead,
+	.pReadStamped			= sbgFaultReadStamped,
+	.pWaitReadableUntil		= sbgFaultWaitReadableUntil,
+	.pFlush					= sbgFaultFlush,
+	.pSetEscapeComm			= sbgFaultSetEscapeComm,
+	.pSetLowLatency			= sbgFaultSetLowLatency,
+	.pGetLatencyInfo		= sbgFaultGetLatencyInfo,
+	.pGetCaptureHeader		= sbgFaultGetCaptureHeader,
+	.pNextOutputConfig		= sbgFaultNextOutputConfig
+};
+
+/// Returns the faults injected so far by a fault:// device
+SbgErrorCode sbgDeviceGetFaultStats(SbgDeviceHandle handle, SbgFaultStats *pStats)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) && (pStats) )
+	{
+		if (handle->pOps != &sbgFaultOps)
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+		*pStats = ((SbgFaultDevice*)handle->context)->stats;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
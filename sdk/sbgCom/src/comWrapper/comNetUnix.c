@@ -0,0 +1,606 @@
+#include "comWrapper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+//------------------------------------------------------------------------------//
+//- Network transports definitions                                             -//
+//------------------------------------------------------------------------------//
+
+#define SBG_NET_MAX_DATAGRAM				(65536)					/*!< Largest UDP datagram we can receive. */
+#define SBG_NET_SOCKET_RX_BUFFER_SIZE		(262144)				/*!< Kernel receive buffer asked for, absorbs bursts while the reader is late. */
+#define SBG_NET_WRITE_TIME_OUT				(100)					/*!< Time in ms we wait for a full TCP send buffer. */
+#define SBG_NET_MAX_NAME_LENGTH				(256)					/*!< Size of the host and port buffers used to parse a path. */
+
+/*!
+ *	State of the UDP and TCP transports.
+ */
+typedef struct _SbgNetUnix
+{
+	int32					socketId;					/*!< Our socket. */
+	bool					isDatagram;					/*!< TRUE for UDP. */
+	bool					isClosed;					/*!< TRUE once the TCP peer has closed the connection. */
+	bool					answersLastSender;			/*!< TRUE for udp://:port, writes go to the last sender. */
+	struct sockaddr_storage	remoteAddress;				/*!< UDP destination of our writes. */
+	socklen_t				remoteAddressLength;		/*!< 0 until we know where to send, udp://:port learns it from the last sender. */
+	uint8					*pDatagram;					/*!< UDP datagram not fully read yet. */
+	uint32					datagramSize;				/*!< Number of bytes in pDatagram. */
+	uint32					datagramOffset;				/*!< Number of bytes of pDatagram already returned. */
+} SbgNetUnix;
+
+//------------------------------------------------------------------------------//
+//- Helpers                                                                    -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Splits a network path such as 127.0.0.1:5000, [::1]:5000 or :5000?local=5001.
+ *	\param[in]	pPath		Part of the URI after "://".
+ *	\param[out]	pHost		Host name, empty if none.
+ *	\param[out]	pPort		Port.
+ *	\param[out]	pLocalPort	Local port given by the local option, empty if none.
+ *	\param[in]	bufferSize	Size of each output buffer.
+ *	\return					TRUE if the path holds at least a port.
+ */
+static bool sbgNetUnixParsePath(const char *pPath, char *pHost, char *pPort, char *pLocalPort, size_t bufferSize)
+{
+	const char *pHostEnd;
+	const char *pPortStart;
+	const char *pPortEnd;
+	const char *pOption;
+
+	pHost[0] = '\0';
+	pPort[0] = '\0';
+	pLocalPort[0] = '\0';
+
+	//
+	// IPv6 addresses are written in brackets
+	//
+	if (pPath[0] == '[')
+	{
+		pHostEnd = strchr(pPath, ']');
+		if ( (!pHostEnd) || (pHostEnd[1] != ':') )
+		{
+			return FALSE;
+		}
+		pPath++;
+		pPortStart = pHostEnd + 2;
+	}
+	else
+	{
+		pHostEnd = strrchr(pPath, ':');
+		if (!pHostEnd)
+		{
+			return FALSE;
+		}
+		pPortStart = pHostEnd + 1;
+	}
+
+	pPortEnd = strchr(pPortStart, '?');
+	if (!pPortEnd)
+	{
+		pPortEnd = pPortStart + strlen(pPortStart);
+	}
+
+	if ( ((size_t)(pHostEnd - pPath) >= bufferSize) || ((size_t)(pPortEnd - pPortStart) >= bufferSize) || (pPortEnd == pPortStart) )
+	{
+		return FALSE;
+	}
+
+	memcpy(pHost, pPath, pHostEnd - pPath);
+	pHost[pHostEnd - pPath] = '\0';
+	memcpy(pPort, pPortStart, pPortEnd - pPortStart);
+	pPort[pPortEnd - pPortStart] = '\0';
+
+	//
+	// Only the local option is supported
+	//
+	pOption = strstr(pPortEnd, "local=");
+	if (pOption)
+	{
+		pOption += strlen("local=");
+		if (strcspn(pOption, "&") >= bufferSize)
+		{
+			return FALSE;
+		}
+		memcpy(pLocalPort, pOption, strcspn(pOption, "&"));
+		pLocalPort[strcspn(pOption, "&")] = '\0';
+	}
+
+	return TRUE;
+}
+
+/*!
+ *	Allocates a network context.
+ *	\param[in]	isDatagram	TRUE for UDP.
+ *	\return					The context or NULL if we are out of memory.
+ */
+static SbgNetUnix *sbgNetUnixCreate(bool isDatagram)
+{
+	SbgNetUnix *pNet;
+
+	pNet = (SbgNetUnix*)calloc(1, sizeof(SbgNetUnix));
+
+	if (pNet)
+	{
+		pNet->socketId = -1;
+		pNet->isDatagram = isDatagram;
+
+		if (isDatagram)
+		{
+			pNet->pDatagram = (uint8*)malloc(SBG_NET_MAX_DATAGRAM);
+
+			if (!pNet->pDatagram)
+			{
+				free(pNet);
+				pNet = NULL;
+			}
+		}
+	}
+
+	return pNet;
+}
+
+/// Close the socket and release the context
+static SbgErrorCode sbgNetUnixClose(SbgDeviceContext context)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+
+	if (pNet->socketId != -1)
+	{
+		close(pNet->socketId);
+	}
+
+	free(pNet->pDatagram);
+	free(pNet);
+
+	return SBG_NO_ERROR;
+}
+
+/// The serial side of a bridge is configured on the bridge, any baud rate is accepted
+static SbgErrorCode sbgNetUnixChangeBaud(SbgDeviceContext context, uint32 baudRate)
+{
+	// Avoid warnings
+	(void)context;
+	(void)baudRate;
+
+	return SBG_NO_ERROR;
+}
+
+/// Wait until some bytes can be read or the deadline is reached
+static SbgErrorCode sbgNetUnixWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+
+	if (pNet->isClosed)
+	{
+		return SBG_READ_ERROR;
+	}
+
+	//
+	// The end of the last datagram is still waiting for us
+	//
+	if (pNet->datagramOffset < pNet->datagramSize)
+	{
+		return SBG_NO_ERROR;
+	}
+
+	return sbgDevicePollUntil(pNet->socketId, deadlineNs);
+}
+
+/// Drop the pending bytes
+static SbgErrorCode sbgNetUnixFlush(SbgDeviceContext context)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+	uint8 dropBuffer[1024];
+
+	pNet->datagramOffset = 0;
+	pNet->datagramSize = 0;
+
+	while (recv(pNet->socketId, dropBuffer, sizeof(dropBuffer), MSG_DONTWAIT) > 0)
+	{
+	}
+
+	return SBG_NO_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- UDP transport                                                              -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Opens an UDP socket.<br>
+ *	udp://host:port sends to host:port and receives on the same local port, or on the one given by ?local=port.
+ *	udp://:port only receives on port and answers to the last sender.
+ *	\param[in]	pPath		Part of the URI after "://".
+ *	\param[in]	baudRate	Unused.
+ *	\param[out]	pContext	Context returned.
+ *	\return					SBG_NO_ERROR if the socket is ready.
+ */
+static SbgErrorCode sbgUdpOpen(const char *pPath, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	SbgErrorCode errorCode = SBG_ERROR;
+	SbgNetUnix *pNet;
+	char host[SBG_NET_MAX_NAME_LENGTH];
+	char port[SBG_NET_MAX_NAME_LENGTH];
+	char localPort[SBG_NET_MAX_NAME_LENGTH];
+	struct addrinfo hints;
+	struct addrinfo *pRemote = NULL;
+	struct addrinfo *pLocal = NULL;
+	int optionValue;
+
+	// Avoid warnings
+	(void)baudRate;
+
+	if ( (!pPath) || (!pContext) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	if (!sbgNetUnixParsePath(pPath, host, port, localPort, sizeof(port)))
+	{
+		fprintf(stderr, "sbgUdpOpen: Invalid address: %s\n", pPath);
+		return SBG_INVALID_PARAMETER;
+	}
+
+	pNet = sbgNetUnixCreate(TRUE);
+
+	if (!pNet)
+	{
+		return SBG_MALLOC_FAILED;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	//
+	// Resolve the bridge address, the local socket uses the same address family
+	//
+	if ( (host[0] == '\0') || (getaddrinfo(host, port, &hints, &pRemote) == 0) )
+	{
+		if (pRemote)
+		{
+			memcpy(&pNet->remoteAddress, pRemote->ai_addr, pRemote->ai_addrlen);
+			pNet->remoteAddressLength = pRemote->ai_addrlen;
+			hints.ai_family = pRemote->ai_family;
+		}
+		else
+		{
+			hints.ai_family = AF_INET;
+			pNet->answersLastSender = TRUE;
+		}
+		hints.ai_flags = AI_PASSIVE;
+
+		if (getaddrinfo(NULL, (localPort[0])?localPort:port, &hints, &pLocal) == 0)
+		{
+			pNet->socketId = socket(pLocal->ai_family, pLocal->ai_socktype, pLocal->ai_protocol);
+
+			if (pNet->socketId != -1)
+			{
+				optionValue = 1;
+				setsockopt(pNet->socketId, SOL_SOCKET, SO_REUSEADDR, &optionValue, sizeof(optionValue));
+				optionValue = SBG_NET_SOCKET_RX_BUFFER_SIZE;
+				setsockopt(pNet->socketId, SOL_SOCKET, SO_RCVBUF, &optionValue, sizeof(optionValue));
+
+				if ( (bind(pNet->socketId, pLocal->ai_addr, pLocal->ai_addrlen) != -1) && (fcntl(pNet->socketId, F_SETFL, O_NONBLOCK) != -1) )
+				{
+					errorCode = SBG_NO_ERROR;
+				}
+			}
+
+			freeaddrinfo(pLocal);
+		}
+
+		if (pRemote)
+		{
+			freeaddrinfo(pRemote);
+		}
+	}
+
+	if (errorCode == SBG_NO_ERROR)
+	{
+		*pContext = pNet;
+	}
+	else
+	{
+		fprintf(stderr, "sbgUdpOpen: Unable to open %s: %s\n", pPath, strerror(errno));
+		sbgNetUnixClose(pNet);
+	}
+
+	return errorCode;
+}
+
+/// Send the bytes as one datagram
+static SbgErrorCode sbgUdpWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+
+	if (!pBuffer)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	if (pNet->remoteAddressLength == 0)
+	{
+		fprintf(stderr, "sbgUdpWrite: No peer to send to yet\n");
+		return SBG_WRITE_ERROR;
+	}
+
+	if (sendto(pNet->socketId, pBuffer, numBytesToWrite, 0, (const struct sockaddr*)&pNet->remoteAddress, pNet->remoteAddressLength) != (ssize_t)numBytesToWrite)
+	{
+		fprintf(stderr, "sbgUdpWrite: Unable to write to our device: %s\n", strerror(errno));
+		return SBG_WRITE_ERROR;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/// Read some bytes, a datagram larger than the caller buffer is returned over several reads
+static SbgErrorCode sbgUdpRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+	struct sockaddr_storage senderAddress;
+	socklen_t senderAddressLength = sizeof(senderAddress);
+	uint32 numBytesRead = 0;
+	ssize_t datagramSize;
+
+	if (!pBuffer)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	if (pNet->datagramOffset >= pNet->datagramSize)
+	{
+		//
+		// Receive directly in the caller buffer when a whole datagram fits in it
+		//
+		if (numBytesToRead >= SBG_NET_MAX_DATAGRAM)
+		{
+			datagramSize = recvfrom(pNet->socketId, pBuffer, numBytesToRead, 0, (struct sockaddr*)&senderAddress, &senderAddressLength);
+			numBytesRead = (datagramSize > 0)?(uint32)datagramSize:0;
+		}
+		else
+		{
+			datagramSize = recvfrom(pNet->socketId, pNet->pDatagram, SBG_NET_MAX_DATAGRAM, 0, (struct sockaddr*)&senderAddress, &senderAddressLength);
+			pNet->datagramSize = (datagramSize > 0)?(uint32)datagramSize:0;
+			pNet->datagramOffset = 0;
+		}
+
+		//
+		// Without configured host we answer to the last sender
+		//
+		if ( (datagramSize > 0) && (pNet->answersLastSender) )
+		{
+			memcpy(&pNet->remoteAddress, &senderAddress, senderAddressLength);
+			pNet->remoteAddressLength = senderAddressLength;
+		}
+	}
+
+	if (pNet->datagramOffset < pNet->datagramSize)
+	{
+		numBytesRead = pNet->datagramSize - pNet->datagramOffset;
+		if (numBytesRead > numBytesToRead)
+		{
+			numBytesRead = numBytesToRead;
+		}
+
+		memcpy(pBuffer, pNet->pDatagram + pNet->datagramOffset, numBytesRead);
+		pNet->datagramOffset += numBytesRead;
+	}
+
+	if (pNumBytesRead)
+	{
+		*pNumBytesRead = numBytesRead;
+	}
+
+	return (numBytesRead > 0)?SBG_NO_ERROR:SBG_READ_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- TCP transport                                                              -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Connects to tcp://host:port.
+ *	\param[in]	pPath		Part of the URI after "://".
+ *	\param[in]	baudRate	Unused.
+ *	\param[out]	pContext	Context returned.
+ *	\return					SBG_NO_ERROR if we are connected.
+ */
+static SbgErrorCode sbgTcpOpen(const char *pPath, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	SbgErrorCode errorCode = SBG_ERROR;
+	SbgNetUnix *pNet;
+	char host[SBG_NET_MAX_NAME_LENGTH];
+	char port[SBG_NET_MAX_NAME_LENGTH];
+	char localPort[SBG_NET_MAX_NAME_LENGTH];
+	struct addrinfo hints;
+	struct addrinfo *pAddresses;
+	struct addrinfo *pAddress;
+	int optionValue;
+
+	// Avoid warnings
+	(void)baudRate;
+
+	if ( (!pPath) || (!pContext) )
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	if ( (!sbgNetUnixParsePath(pPath, host, port, localPort, sizeof(port))) || (host[0] == '\0') )
+	{
+		fprintf(stderr, "sbgTcpOpen: Invalid address: %s\n", pPath);
+		return SBG_INVALID_PARAMETER;
+	}
+
+	pNet = sbgNetUnixCreate(FALSE);
+
+	if (!pNet)
+	{
+		return SBG_MALLOC_FAILED;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host, port, &hints, &pAddresses) == 0)
+	{
+		//
+		// Try each resolved address until one accepts the connection
+		//
+		for (pAddress = pAddresses; (pAddress) && (errorCode != SBG_NO_ERROR); pAddress = pAddress->ai_next)
+		{
+			pNet->socketId = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+
+			if (pNet->socketId != -1)
+			{
+				if (connect(pNet->socketId, pAddress->ai_addr, pAddress->ai_addrlen) != -1)
+				{
+					//
+					// Frames are small, send them right away instead of waiting for more bytes
+					//
+					optionValue = 1;
+					setsockopt(pNet->socketId, IPPROTO_TCP, TCP_NODELAY, &optionValue, sizeof(optionValue));
+					optionValue = SBG_NET_SOCKET_RX_BUFFER_SIZE;
+					setsockopt(pNet->socketId, SOL_SOCKET, SO_RCVBUF, &optionValue, sizeof(optionValue));
+
+					if (fcntl(pNet->socketId, F_SETFL, O_NONBLOCK) != -1)
+					{
+						errorCode = SBG_NO_ERROR;
+					}
+				}
+
+				if (errorCode != SBG_NO_ERROR)
+				{
+					close(pNet->socketId);
+					pNet->socketId = -1;
+				}
+			}
+		}
+
+		freeaddrinfo(pAddresses);
+	}
+
+	if (errorCode == SBG_NO_ERROR)
+	{
+		*pContext = pNet;
+	}
+	else
+	{
+		fprintf(stderr, "sbgTcpOpen: Unable to connect to %s: %s\n", pPath, strerror(errno));
+		sbgNetUnixClose(pNet);
+	}
+
+	return errorCode;
+}
+
+/// Write all the bytes, waiting for room in the send buffer if needed
+static SbgErrorCode sbgTcpWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+	const uint8 *pCurrentBuffer = (const uint8*)pBuffer;
+	struct pollfd pollDesc;
+	ssize_t numBytesWritten;
+
+	if (!pBuffer)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	while (numBytesToWrite > 0)
+	{
+		numBytesWritten = send(pNet->socketId, pCurrentBuffer, numBytesToWrite, MSG_NOSIGNAL);
+
+		if (numBytesWritten > 0)
+		{
+			numBytesToWrite -= (uint32)numBytesWritten;
+			pCurrentBuffer += numBytesWritten;
+		}
+		else if ( (numBytesWritten == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) )
+		{
+			pollDesc.fd = pNet->socketId;
+			pollDesc.events = POLLOUT;
+
+			if (poll(&pollDesc, 1, SBG_NET_WRITE_TIME_OUT) <= 0)
+			{
+				fprintf(stderr, "sbgTcpWrite: Send buffer full\n");
+				return SBG_WRITE_ERROR;
+			}
+		}
+		else if ( (numBytesWritten == -1) && (errno != EINTR) )
+		{
+			fprintf(stderr, "sbgTcpWrite: Unable to write to our device: %s\n", strerror(errno));
+			return SBG_WRITE_ERROR;
+		}
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/// Read the bytes available on the stream
+static SbgErrorCode sbgTcpRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	SbgNetUnix *pNet = (SbgNetUnix*)context;
+	ssize_t numBytesRead;
+
+	if (!pBuffer)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	numBytesRead = recv(pNet->socketId, pBuffer, numBytesToRead, 0);
+
+	//
+	// A stream that returns 0 bytes has been closed by the peer
+	//
+	if ( (numBytesRead == 0) && (numBytesToRead > 0) && (!pNet->isClosed) )
+	{
+		fprintf(stderr, "sbgTcpRead: Connection closed by the peer\n");
+		pNet->isClosed = TRUE;
+	}
+
+	if (pNumBytesRead)
+	{
+		*pNumBytesRead = (numBytesRead > 0)?(uint32)numBytesRead:0;
+	}
+
+	return (numBytesRead > 0)?SBG_NO_ERROR:SBG_READ_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- Transports                                                                 -//
+//------------------------------------------------------------------------------//
+
+const SbgDeviceOps sbgUdpOps =
+{
+	.pScheme				= "udp",
+	.pOpen					= sbgUdpOpen,
+	.pClose					= sbgNetUnixClose,
+	.pChangeBaud			= sbgNetUnixChangeBaud,
+	.pWrite					= sbgUdpWrite,
+	.pRead					= sbgUdpRead,
+	.pWaitReadableUntil		= sbgNetUnixWaitReadableUntil,
+	.pFlush					= sbgNetUnixFlush
+};
+
+const SbgDeviceOps sbgTcpOps =
+{
+	.pScheme				= "tcp",
+	.pOpen					= sbgTcpOpen,
+	.pClose					= sbgNetUnixClose,
+	.pChangeBaud			= sbgNetUnixChangeBaud,
+	.pWrite					= sbgTcpWrite,
+	.pRead					= sbgTcpRead,
+	.pWaitReadableUntil		= sbgNetUnixWaitReadableUntil,
+	.pFlush					= sbgNetUnixFlush
+};
@@ -1,3 +1,7 @@
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE				// posix_openpt, ptsname and cfmakeraw
+#endif
+
 #include "comWrapper.h"
 #include "../time/sbgTime.h"
 #include <stdio.h>
@@ -6,8 +10,41 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <termios.h>
+#include <poll.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <sys/ioctl.h>
 
+#if defined(__linux__)
+	#include <linux/serial.h>
+#endif
+
+#if defined(__linux__) && defined(TCGETS2) && !defined(BOTHER) && (defined(__x86_64__) || defined(__i386__) || defined(__arm__) || defined(__aarch64__) || defined(__riscv))
+	//
+	// The glibc termios.h and the kernel asm/termbits.h can't be included together,
+	// so we declare the kernel termios2 structure used by TCGETS2 / TCSETS2 ourselves
+	//
+	#define SBG_UNIX_HAS_TERMIOS2
+	#define BOTHER	0010000
+
+	struct termios2
+	{
+		tcflag_t	c_iflag;
+		tcflag_t	c_oflag;
+		tcflag_t	c_cflag;
+		tcflag_t	c_lflag;
+		cc_t		c_line;
+		cc_t		c_cc[19];
+		speed_t		c_ispeed;
+		speed_t		c_ospeed;
+	};
+#endif
+
+/// The serial transport stores its file descriptor directly in the device context
+#define SBG_SERIAL_UNIX_FD(context)		((int32)(intptr_t)(context))
+
 //------------------------------------------------------------------------------//
 //- SBG Device operations                                                      -//
 //------------------------------------------------------------------------------//
@@ -15,7 +52,7 @@
 /*!
  *	Returns the right unix baud rate const according to a baud rate value.
  *	\param[in] baudRate		Our baud rate value (ie 115200).
- *	\return					Our Unix baud rate constante.
+ *	\return					Our Unix baud rate constante or B0 if the baud rate has no constante and has to be set using sbgDeviceSetCustomBaud.
  */
 uint32 sbgDeviceGetBaudRateConst(uint32 baudRate)
 {
@@ -63,14 +100,111 @@ uint32 sbgDeviceGetBaudRateConst(uint32 baudRate)
 			break;
 #endif
 		default:
-			baudRateConst = baudRate;
+			baudRateConst = B0;
 	}
 
 	return baudRateConst;
 }
 
-/// Open the specified device at a specified baud and create a new device handle
-SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHandle *pHandle)
+/*!
+ *	Applies a baud rate that has no unix const using termios2 and BOTHER.<br>
+ *	The termios options should have been applied before as tcsetattr would overwrite the speed.
+ *	\param[in]	fileId		Our opened device.
+ *	\param[in]	baudRate	Our baud rate value (ie 1000000).
+ *	\return					SBG_NO_ERROR if the baud rate has been applied.
+ */
+static SbgErrorCode sbgDeviceSetCustomBaud(int32 fileId, uint32 baudRate)
+{
+#ifdef SBG_UNIX_HAS_TERMIOS2
+	struct termios2 options;
+
+	if (ioctl(fileId, TCGETS2, &options) != -1)
+	{
+		//
+		// Use the same arbitrary speed for input and output
+		//
+		options.c_cflag &= ~CBAUD;
+#ifdef CIBAUD
+		options.c_cflag &= ~CIBAUD;
+#endif
+		options.c_cflag |= BOTHER;
+		options.c_ispeed = baudRate;
+		options.c_ospeed = baudRate;
+
+		if (ioctl(fileId, TCSETS2, &options) != -1)
+		{
+			return SBG_NO_ERROR;
+		}
+	}
+
+	fprintf(stderr, "sbgDeviceSetCustomBaud: Unable to set %u bauds: %s\n", baudRate, strerror(errno));
+	return SBG_ERROR;
+#else
+	fprintf(stderr, "sbgDeviceSetCustomBaud: %u bauds isn't supported on this platform.\n", baudRate);
+	return SBG_INVALID_PARAMETER;
+#endif
+}
+
+/*!
+ *	Returns the baud rate currently used by the driver.
+ *	\param[in]	fileId		Our opened device.
+ *	\return					The baud rate read back from the driver or 0 if unknown.
+ */
+static uint32 sbgDeviceGetEffectiveBaud(int32 fileId)
+{
+#ifdef SBG_UNIX_HAS_TERMIOS2
+	struct termios2 options;
+
+	//
+	// The kernel fills the speed fields for both standard and arbitrary baud rates
+	//
+	if (ioctl(fileId, TCGETS2, &options) != -1)
+	{
+		return options.c_ospeed;
+	}
+#endif
+
+	return 0;
+}
+
+#if defined(__linux__)
+/*!
+ *	Builds the sysfs path of the USB-serial latency timer of our device.
+ *	\param[in]	fileId		Our opened device.
+ *	\param[out]	pPath		Buffer that receives the path.
+ *	\param[in]	pathSize	Size of the pPath buffer.
+ *	\return					TRUE if the device exposes a latency timer.
+ */
+static bool sbgDeviceGetLatencyTimerPath(int32 fileId, char *pPath, size_t pathSize)
+{
+	char fdPath[32];
+	char devicePath[PATH_MAX];
+	const char *pDeviceName;
+	ssize_t length;
+
+	//
+	// Resolve the real tty name so udev symlinks such as /dev/sbg work too
+	//
+	snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d", fileId);
+	length = readlink(fdPath, devicePath, sizeof(devicePath) - 1);
+
+	if (length <= 0)
+	{
+		return FALSE;
+	}
+	devicePath[length] = '\0';
+
+	pDeviceName = strrchr(devicePath, '/');
+	pDeviceName = (pDeviceName)?(pDeviceName + 1):devicePath;
+
+	snprintf(pPath, pathSize, "/sys/class/tty/%s/device/latency_timer", pDeviceName);
+
+	return (access(pPath, F_OK) == 0)?TRUE:FALSE;
+}
+#endif
+
+/// Open the specified serial port at a specified baud
+static SbgErrorCode sbgSerialUnixOpen(const char *deviceName, uint32 baudRate, SbgDeviceContext *pContext)
 {
 	SbgErrorCode errorCode = SBG_ERROR;
 	struct termios options;
@@ -78,9 +212,9 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 	int32 fileId;
 	
 	//
-	// Check if we have a valid handle
+	// Check if we have a valid context
 	//
-	if (pHandle)
+	if (pContext)
 	{
 		//
 		// Check if we have a valid deviceName
@@ -100,9 +234,9 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 			if (fileId != -1)
 			{
 				//
-				// Sotre our file id into our pHandle
+				// Sotre our file id into our context
 				//
-				*((int32*)pHandle) = fileId;
+				*pContext = (SbgDeviceContext)(intptr_t)fileId;
 				
 				//
 				// Don't block on read call if no data are available
@@ -141,18 +275,20 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 						
 						//
 						// Set both input and output baud
+						// Baud rates without unix const are applied with termios2 once the options are defined
 						//
-						if ( (cfsetispeed(&options, baudRateConst) != -1)  && (cfsetospeed(&options, baudRateConst) != -1) )
+						if ( (cfsetispeed(&options, (baudRateConst != B0)?baudRateConst:B38400) != -1)  && (cfsetospeed(&options, (baudRateConst != B0)?baudRateConst:B38400) != -1) )
 						{
 							//
 							// Define options
 							//
-							if (tcsetattr(fileId, TCSANOW, &options) != -1)
+							if ( (tcsetattr(fileId, TCSANOW, &options) != -1) && ( (baudRateConst != B0) || (sbgDeviceSetCustomBaud(fileId, baudRate) == SBG_NO_ERROR) ) )
 							{								
 								//
 								// Flush our port com
 								//
-								return sbgDeviceFlush(pHandle);
+								tcflush(fileId, TCIOFLUSH);
+								return SBG_NO_ERROR;
 							}
 							else
 							{
@@ -177,7 +313,7 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 				//
 				// Close our device if only some part has been initialised
 				//
-				sbgDeviceClose(pHandle);
+				close(fileId);
 			}
 			else
 			{
@@ -191,14 +327,10 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 			errorCode = SBG_NULL_POINTER;
 		}
 		
-		//
-		// We have an invalid device handle
-		//
-		*pHandle = SBG_INVALID_DEVICE_HANDLE;
 	}
 	else
 	{
-		fprintf(stderr, "sbgDeviceOpen: pHandle == NULL.\n");
+		fprintf(stderr, "sbgDeviceOpen: pContext == NULL.\n");
 		errorCode = SBG_NULL_POINTER;
 	}
 	
@@ -206,11 +338,11 @@ SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHan
 }
 
 /// Close the device
-SbgErrorCode sbgDeviceClose(SbgDeviceHandle handle)
+static SbgErrorCode sbgSerialUnixClose(SbgDeviceContext context)
 {
-	int32 fileId = *((int32*)&handle);
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
 	
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
+	if (fileId >= 0)
 	{
 		//
 		// Close our port com
@@ -226,13 +358,13 @@ SbgErrorCode sbgDeviceClose(SbgDeviceHandle handle)
 }
 
 /// Change the baud rate out our opened device
-SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
+static SbgErrorCode sbgSerialUnixChangeBaud(SbgDeviceContext context, uint32 baudRate)
 {
-	int32 fileId = *((int32*)&handle);
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
 	struct termios options;
 	uint32 baudRateConst;
 
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
+	if (fileId >= 0)
 	{
 		//
 		// Get our baud rate const for our Unix platform
@@ -247,7 +379,7 @@ SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
 			//
 			// Set both input and output baud
 			//
-			if ( (cfsetispeed(&options, baudRateConst) == -1)  || (cfsetospeed(&options, baudRateConst) == -1) )
+			if ( (cfsetispeed(&options, (baudRateConst != B0)?baudRateConst:B38400) == -1)  || (cfsetospeed(&options, (baudRateConst != B0)?baudRateConst:B38400) == -1) )
 			{
 				fprintf(stderr, "sbgDeviceChangeBaud: Unable to set speed.\n");
 				return SBG_ERROR;
@@ -258,7 +390,7 @@ SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
 			//
 			if (tcsetattr(fileId, TCSADRAIN, &options) != -1)
 			{
-				return SBG_NO_ERROR;
+				return (baudRateConst != B0)?SBG_NO_ERROR:sbgDeviceSetCustomBaud(fileId, baudRate);
 			}
 			else
 			{
@@ -278,43 +410,15 @@ SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
 	}
 }
 
-/// Write one byte to our tx queue
-SbgErrorCode sbgDeviceWriteByte(SbgDeviceHandle handle, uint8 value)
-{
-	return sbgDeviceWrite(handle, &value, 1);
-}
-
-/// Read one byte from our rx queue
-SbgErrorCode sbgDeviceReadByte(SbgDeviceHandle handle, uint8 *pValue)
-{
-	int32 fileId = *((int32*)&handle);
-	
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
-	{
-		if (read(fileId, pValue, sizeof(uint8)) == sizeof(uint8))
-		{
-			return SBG_NO_ERROR;
-		}
-		else
-		{
-			return SBG_NOT_READY;
-		}
-	}
-	else
-	{
-		return SBG_NULL_POINTER;
-	}
-}
-
 /// Write some bytes to our tx queue
-SbgErrorCode sbgDeviceWrite(SbgDeviceHandle handle, const void *pBuffer, uint32 numBytesToWrite)
+static SbgErrorCode sbgSerialUnixWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
 {
-	int32 fileId = *((int32*)&handle);
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
 	uint32 numBytesWritten;
 	uint32 numBytesLeftToWrite = numBytesToWrite;
 	uint8 *pCurrentBuffer = (uint8*)pBuffer;
 	
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
+	if (fileId >= 0)
 	{
 		if (pBuffer)
 		{
@@ -353,13 +457,13 @@ SbgErrorCode sbgDeviceWrite(SbgDeviceHandle handle, const void *pBuffer, uint32
 }
 
 /// Read some bytes from our rx queue
-SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+static SbgErrorCode sbgSerialUnixRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
 {
 	SbgErrorCode errorCode = SBG_ERROR;
-	int32 fileId = *((int32*)&handle);
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
 	int32 numBytesRead;
 	
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
+	if (fileId >= 0)
 	{
 		if (pBuffer)
 		{
@@ -402,12 +506,71 @@ SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numByte
 	return errorCode;
 }
 
+/// Wait until a file descriptor is readable or the deadline is reached
+SbgErrorCode sbgDevicePollUntil(int32 fileId, uint64 deadlineNs)
+{
+	struct pollfd pollDesc;
+	int pollResult;
+	uint64 currentTime;
+	uint64 remainingMs;
+	
+	if (fileId >= 0)
+	{
+		pollDesc.fd = fileId;
+		pollDesc.events = POLLIN;
+		
+		//
+		// Sleep in the kernel until the driver has some bytes for us
+		// If a signal interrupts the wait, resume it with the time left until the deadline
+		//
+		do
+		{
+			currentTime = sbgGetTimeNs();
+			
+			//
+			// Round up so we never wake up before the deadline
+			//
+			remainingMs = (deadlineNs > currentTime)?((deadlineNs - currentTime + 999999ull) / 1000000ull):0;
+			if (remainingMs > 0x7FFFFFFF)
+			{
+				remainingMs = 0x7FFFFFFF;
+			}
+			
+			pollDesc.revents = 0;
+			pollResult = poll(&pollDesc, 1, (int)remainingMs);
+		} while ((pollResult < 0) && (errno == EINTR));
+		
+		if (pollResult > 0)
+		{
+			return (pollDesc.revents & POLLIN)?SBG_NO_ERROR:SBG_READ_ERROR;
+		}
+		else if (pollResult == 0)
+		{
+			return SBG_TIME_OUT;
+		}
+		else
+		{
+			return SBG_READ_ERROR;
+		}
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Wait until our rx queue holds at least one byte or the deadline is reached
+static SbgErrorCode sbgSerialUnixWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
+{
+	return sbgDevicePollUntil(SBG_SERIAL_UNIX_FD(context), deadlineNs);
+}
+
 /// Flush our RX and TX buffers (remove all old data)
-SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle)
+static SbgErrorCode sbgSerialUnixFlush(SbgDeviceContext context)
 {
-	int32 fileId = *((int32*)&handle);
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
 	
-	if (handle != SBG_INVALID_DEVICE_HANDLE)
+	if (fileId >= 0)
 	{
 		//
 		// Flush our port
@@ -421,3 +584,300 @@ SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle)
 		return SBG_NULL_POINTER;
 	}
 }
+
+/// Returns the effective latency related settings of our device
+static SbgErrorCode sbgSerialUnixGetLatencyInfo(SbgDeviceContext context, SbgDeviceLatencyInfo *pInfo)
+{
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
+#if defined(__linux__)
+	struct serial_struct serialInfo;
+	char latencyTimerPath[PATH_MAX];
+	FILE *pLatencyTimer;
+	int latencyTimerMs;
+#endif
+
+	if ( (fileId >= 0) && (pInfo) )
+	{
+		pInfo->lowLatency = FALSE;
+		pInfo->latencyTimerMs = -1;
+		pInfo->baudRate = sbgDeviceGetEffectiveBaud(fileId);
+
+#if defined(__linux__)
+		if (ioctl(fileId, TIOCGSERIAL, &serialInfo) != -1)
+		{
+			pInfo->lowLatency = (serialInfo.flags & ASYNC_LOW_LATENCY)?TRUE:FALSE;
+		}
+
+		if (sbgDeviceGetLatencyTimerPath(fileId, latencyTimerPath, sizeof(latencyTimerPath)))
+		{
+			pLatencyTimer = fopen(latencyTimerPath, "r");
+
+			if (pLatencyTimer)
+			{
+				if (fscanf(pLatencyTimer, "%d", &latencyTimerMs) == 1)
+				{
+					pInfo->latencyTimerMs = latencyTimerMs;
+				}
+				fclose(pLatencyTimer);
+			}
+		}
+#endif
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Set the ASYNC_LOW_LATENCY flag and the USB-serial latency timer of our device
+static SbgErrorCode sbgSerialUnixSetLowLatency(SbgDeviceContext context, uint32 latencyTimerMs, SbgDeviceLatencyInfo *pInfo)
+{
+	SbgErrorCode errorCode = SBG_NO_ERROR;
+#if defined(__linux__)
+	int32 fileId = SBG_SERIAL_UNIX_FD(context);
+	struct serial_struct serialInfo;
+	char latencyTimerPath[PATH_MAX];
+	FILE *pLatencyTimer;
+#endif
+
+	if (fileId >= 0)
+	{
+		if (latencyTimerMs > 255)
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+#if defined(__linux__)
+		//
+		// Ask the driver to push received bytes to the tty layer without deferring them
+		//
+		if ( (ioctl(fileId, TIOCGSERIAL, &serialInfo) == -1) || ((serialInfo.flags |= ASYNC_LOW_LATENCY), (ioctl(fileId, TIOCSSERIAL, &serialInfo) == -1)) )
+		{
+			fprintf(stderr, "sbgDeviceSetLowLatency: Unable to set ASYNC_LOW_LATENCY: %s\n", strerror(errno));
+			errorCode = SBG_ERROR;
+		}
+		
+		//
+		// USB-serial adapters such as FTDI chips batch bytes until their latency timer expires
+		// Devices without latency timer have nothing to change
+		//
+		if ( (latencyTimerMs > 0) && (sbgDeviceGetLatencyTimerPath(fileId, latencyTimerPath, sizeof(latencyTimerPath))) )
+		{
+			pLatencyTimer = fopen(latencyTimerPath, "w");
+
+			if ( (!pLatencyTimer) || (fprintf(pLatencyTimer, "%u", latencyTimerMs) < 0) || (fclose(pLatencyTimer) != 0) )
+			{
+				fprintf(stderr, "sbgDeviceSetLowLatency: Unable to write %s: %s\n", latencyTimerPath, strerror(errno));
+				errorCode = SBG_ERROR;
+			}
+		}
+#else
+		errorCode = SBG_ERROR;
+#endif
+
+		//
+		// Report what the driver actually uses
+		//
+		if (pInfo)
+		{
+			sbgSerialUnixGetLatencyInfo(context, pInfo);
+		}
+
+		return errorCode;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+//------------------------------------------------------------------------------//
+//- Pseudo terminal transport                                                  -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	State of the pty transport: we talk on the master side, other programs open the slave.
+ */
+typedef struct _SbgPtyUnix
+{
+	int32	masterFd;						/*!< Our side of the pseudo terminal. */
+	int32	slaveFd;						/*!< Slave kept opened so the master doesn't hang up between two clients. */
+	char	linkPath[PATH_MAX];				/*!< Symbolic link to the slave, empty if none. */
+} SbgPtyUnix;
+
+/// Create a pseudo terminal and optionally link its slave to pPath
+static SbgErrorCode sbgPtyUnixOpen(const char *pPath, uint32 baudRate, SbgDeviceContext *pContext)
+{
+	SbgErrorCode errorCode = SBG_ERROR;
+	SbgPtyUnix *pPty;
+	struct termios options;
+	struct stat linkStat;
+	const char *pSlaveName = NULL;
+
+	// Avoid warnings
+	(void)baudRate;
+
+	if (!pContext)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	pPty = (SbgPtyUnix*)calloc(1, sizeof(SbgPtyUnix));
+
+	if (!pPty)
+	{
+		return SBG_MALLOC_FAILED;
+	}
+
+	pPty->slaveFd = -1;
+	pPty->masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ( (pPty->masterFd != -1) && (grantpt(pPty->masterFd) == 0) && (unlockpt(pPty->masterFd) == 0) && ((pSlaveName = ptsname(pPty->masterFd)) != NULL) )
+	{
+		//
+		// The line discipline lives on the slave side: make it raw so binary frames go through untouched
+		//
+		pPty->slaveFd = open(pSlaveName, O_RDWR | O_NOCTTY);
+
+		if ( (pPty->slaveFd != -1) && (tcgetattr(pPty->slaveFd, &options) != -1) )
+		{
+			cfmakeraw(&options);
+
+			if ( (tcsetattr(pPty->slaveFd, TCSANOW, &options) != -1) && (fcntl(pPty->masterFd, F_SETFL, O_NONBLOCK) != -1) )
+			{
+				errorCode = SBG_NO_ERROR;
+
+				//
+				// Give the slave a stable name, replacing a link left by a previous run
+				//
+				if ( (pPath) && (pPath[0]) )
+				{
+					if ( (lstat(pPath, &linkStat) == 0) && (S_ISLNK(linkStat.st_mode)) )
+					{
+						unlink(pPath);
+					}
+
+					if ( (strlen(pPath) < sizeof(pPty->linkPath)) && (symlink(pSlaveName, pPath) == 0) )
+					{
+						strcpy(pPty->linkPath, pPath);
+					}
+					else
+					{
+						fprintf(stderr, "sbgPtyUnixOpen: Unable to link %s to %s: %s\n", pPath, pSlaveName, strerror(errno));
+						errorCode = SBG_INVALID_PARAMETER;
+					}
+				}
+				else
+				{
+					fprintf(stderr, "sbgPtyUnixOpen: Pseudo terminal opened on %s\n", pSlaveName);
+				}
+			}
+		}
+	}
+
+	if (errorCode == SBG_NO_ERROR)
+	{
+		*pContext = pPty;
+	}
+	else
+	{
+		fprintf(stderr, "sbgPtyUnixOpen: Unable to create the pseudo terminal: %s\n", strerror(errno));
+
+		if (pPty->slaveFd != -1)
+		{
+			close(pPty->slaveFd);
+		}
+		if (pPty->masterFd != -1)
+		{
+			close(pPty->masterFd);
+		}
+		free(pPty);
+	}
+
+	return errorCode;
+}
+
+/// Close the pseudo terminal and remove its link
+static SbgErrorCode sbgPtyUnixClose(SbgDeviceContext context)
+{
+	SbgPtyUnix *pPty = (SbgPtyUnix*)context;
+
+	if (pPty->linkPath[0])
+	{
+		unlink(pPty->linkPath);
+	}
+
+	close(pPty->slaveFd);
+	close(pPty->masterFd);
+	free(pPty);
+
+	return SBG_NO_ERROR;
+}
+
+/// A pseudo terminal has no line speed, any baud rate is accepted
+static SbgErrorCode sbgPtyUnixChangeBaud(SbgDeviceContext context, uint32 baudRate)
+{
+	// Avoid warnings
+	(void)context;
+	(void)baudRate;
+
+	return SBG_NO_ERROR;
+}
+
+/// Write some bytes to the master side
+static SbgErrorCode sbgPtyUnixWrite(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite)
+{
+	return sbgSerialUnixWrite((SbgDeviceContext)(intptr_t)((SbgPtyUnix*)context)->masterFd, pBuffer, numBytesToWrite);
+}
+
+/// Read some bytes from the master side
+static SbgErrorCode sbgPtyUnixRead(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	return sbgSerialUnixRead((SbgDeviceContext)(intptr_t)((SbgPtyUnix*)context)->masterFd, pBuffer, numBytesToRead, pNumBytesRead);
+}
+
+/// Wait until the master side holds at least one byte or the deadline is reached
+static SbgErrorCode sbgPtyUnixWaitReadableUntil(SbgDeviceContext context, uint64 deadlineNs)
+{
+	return sbgDevicePollUntil(((SbgPtyUnix*)context)->masterFd, deadlineNs);
+}
+
+/// Flush the pending bytes of the pseudo terminal
+static SbgErrorCode sbgPtyUnixFlush(SbgDeviceContext context)
+{
+	tcflush(((SbgPtyUnix*)context)->masterFd, TCIOFLUSH);
+
+	return SBG_NO_ERROR;
+}
+
+//------------------------------------------------------------------------------//
+//- Transports                                                                 -//
+//------------------------------------------------------------------------------//
+
+const SbgDeviceOps sbgSerialUnixOps =
+{
+	.pScheme				= "serial",
+	.pOpen					= sbgSerialUnixOpen,
+	.pClose					= sbgSerialUnixClose,
+	.pChangeBaud			= sbgSerialUnixChangeBaud,
+	.pWrite					= sbgSerialUnixWrite,
+	.pRead					= sbgSerialUnixRead,
+	.pWaitReadableUntil		= sbgSerialUnixWaitReadableUntil,
+	.pFlush					= sbgSerialUnixFlush,
+	.pSetLowLatency			= sbgSerialUnixSetLowLatency,
+	.pGetLatencyInfo		= sbgSerialUnixGetLatencyInfo
+};
+
+const SbgDeviceOps sbgPtyUnixOps =
+{
+	.pScheme				= "pty",
+	.pOpen					= sbgPtyUnixOpen,
+	.pClose					= sbgPtyUnixClose,
+	.pChangeBaud			= sbgPtyUnixChangeBaud,
+	.pWrite					= sbgPtyUnixWrite,
+	.pRead					= sbgPtyUnixRead,
+	.pWaitReadableUntil		= sbgPtyUnixWaitReadableUntil,
+	.pFlush					= sbgPtyUnixFlush
+};
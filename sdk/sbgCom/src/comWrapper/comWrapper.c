@@ -0,0 +1,375 @@
+#include "comWrapper.h"
+#include "../time/sbgTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------//
+//- Transports registry                                                        -//
+//------------------------------------------------------------------------------//
+
+/// Registered transports, the built-in ones first
+static const SbgDeviceOps *gSbgDeviceTransports[SBG_DEVICE_MAX_TRANSPORTS] =
+{
+	&sbgSerialUnixOps,
+	&sbgPtyUnixOps,
+	&sbgDataLogOps,
+	&sbgUdpOps,
+	&sbgTcpOps,
+	&sbgFaultOps
+};
+
+/// Registers a transport so its scheme can be used in device URIs
+SbgErrorCode sbgDeviceRegisterTransport(const SbgDeviceOps *pOps)
+{
+	uint32 i;
+
+	if ( (pOps) && (pOps->pScheme) && (pOps->pOpen) && (pOps->pClose) && (pOps->pRead) && (pOps->pWrite) && (pOps->pWaitReadableUntil) )
+	{
+		//
+		// Replace a transport with the same scheme or take the first free slot
+		//
+		for (i = 0; i < SBG_DEVICE_MAX_TRANSPORTS; i++)
+		{
+			if ( (!gSbgDeviceTransports[i]) || (strcmp(gSbgDeviceTransports[i]->pScheme, pOps->pScheme) == 0) )
+			{
+				gSbgDeviceTransports[i] = pOps;
+				return SBG_NO_ERROR;
+			}
+		}
+
+		return SBG_BUFFER_OVERFLOW;
+	}
+	else
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+}
+
+/// Returns the transport that handles a device URI
+const SbgDeviceOps *sbgDeviceFindTransport(const char *deviceName, const char **ppPath)
+{
+	const char *pSeparator;
+	size_t schemeLength;
+	uint32 i;
+
+	if (!deviceName)
+	{
+		return NULL;
+	}
+
+	pSeparator = strstr(deviceName, "://");
+
+	//
+	// Plain device names such as /dev/sbg are serial ports
+	//
+	if (!pSeparator)
+	{
+		if (ppPath)
+		{
+			*ppPath = deviceName;
+		}
+		return &sbgSerialUnixOps;
+	}
+
+	schemeLength = (size_t)(pSeparator - deviceName);
+
+	for (i = 0; (i < SBG_DEVICE_MAX_TRANSPORTS) && (gSbgDeviceTransports[i]); i++)
+	{
+		if ( (strlen(gSbgDeviceTransports[i]->pScheme) == schemeLength) && (strncmp(gSbgDeviceTransports[i]->pScheme, deviceName, schemeLength) == 0) )
+		{
+			if (ppPath)
+			{
+				*ppPath = pSeparator + 3;
+			}
+			return gSbgDeviceTransports[i];
+		}
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------//
+//- SBG Device operations                                                      -//
+//------------------------------------------------------------------------------//
+
+/// Open the specified device at a specified baud and create a new device handle
+SbgErrorCode sbgDeviceOpen(const char *deviceName, uint32 baudRate, SbgDeviceHandle *pHandle)
+{
+	SbgErrorCode errorCode;
+	const SbgDeviceOps *pOps;
+	const char *pPath;
+	SbgDevice *pDevice;
+
+	if (pHandle)
+	{
+		*pHandle = SBG_INVALID_DEVICE_HANDLE;
+
+		if (deviceName)
+		{
+			//
+			// Select the transport using the URI scheme
+			//
+			pOps = sbgDeviceFindTransport(deviceName, &pPath);
+
+			if (pOps)
+			{
+				pDevice = (SbgDevice*)malloc(sizeof(SbgDevice));
+
+				if (pDevice)
+				{
+					pDevice->pOps = pOps;
+					errorCode = pOps->pOpen(pPath, baudRate, &pDevice->context);
+
+					if (errorCode == SBG_NO_ERROR)
+					{
+						*pHandle = pDevice;
+					}
+					else
+					{
+						free(pDevice);
+					}
+				}
+				else
+				{
+					errorCode = SBG_MALLOC_FAILED;
+				}
+			}
+			else
+			{
+				fprintf(stderr, "sbgDeviceOpen: Unknown transport for %s\n", deviceName);
+				errorCode = SBG_INVALID_PARAMETER;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "sbgDeviceOpen: Invalid device name.\n");
+			errorCode = SBG_NULL_POINTER;
+		}
+	}
+	else
+	{
+		fprintf(stderr, "sbgDeviceOpen: pHandle == NULL.\n");
+		errorCode = SBG_NULL_POINTER;
+	}
+
+	return errorCode;
+}
+
+/// Close the device
+SbgErrorCode sbgDeviceClose(SbgDeviceHandle handle)
+{
+	SbgErrorCode errorCode;
+
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		errorCode = handle->pOps->pClose(handle->context);
+		free(handle);
+
+		return errorCode;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Change the baud rate out our opened device
+SbgErrorCode sbgDeviceChangeBaud(SbgDeviceHandle handle, uint32 baudRate)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return (handle->pOps->pChangeBaud)?handle->pOps->pChangeBaud(handle->context, baudRate):SBG_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Write one byte to our tx queue
+SbgErrorCode sbgDeviceWriteByte(SbgDeviceHandle handle, uint8 value)
+{
+	return sbgDeviceWrite(handle, &value, 1);
+}
+
+/// Read one byte from our rx queue
+SbgErrorCode sbgDeviceReadByte(SbgDeviceHandle handle, uint8 *pValue)
+{
+	return sbgDeviceRead(handle, pValue, 1, NULL);
+}
+
+/// Write some bytes to our tx queue
+SbgErrorCode sbgDeviceWrite(SbgDeviceHandle handle, const void *pBuffer, uint32 numBytesToWrite)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return handle->pOps->pWrite(handle->context, pBuffer, numBytesToWrite);
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Read some bytes from our rx queue
+SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return handle->pOps->pRead(handle->context, pBuffer, numBytesToRead, pNumBytesRead);
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Read some bytes from our rx queue and stamp them with the monotonic time at which read returned
+SbgErrorCode sbgDeviceReadStamped(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs)
+{
+	SbgErrorCode errorCode;
+
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		//
+		// Transports that know when the bytes arrived (replay) return their own stamps
+		//
+		if (handle->pOps->pReadStamped)
+		{
+			return handle->pOps->pReadStamped(handle->context, pBuffer, numBytesToRead, pNumBytesRead, pTimeStampNs);
+		}
+
+		errorCode = handle->pOps->pRead(handle->context, pBuffer, numBytesToRead, pNumBytesRead);
+
+		if (pTimeStampNs)
+		{
+			*pTimeStampNs = sbgGetTimeNs();
+		}
+
+		return errorCode;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Returns the header of the capture replayed by the device
+SbgErrorCode sbgDeviceGetCaptureHeader(SbgDeviceHandle handle, SbgCaptureHeader *pHeader)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) && (pHeader) )
+	{
+		return (handle->pOps->pGetCaptureHeader)?handle->pOps->pGetCaptureHeader(handle->context, pHeader):SBG_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Returns the next output configuration change of the replayed capture once it applies
+SbgErrorCode sbgDeviceNextOutputConfig(SbgDeviceHandle handle, uint32 pendingBytes, SbgCaptureOutputConfig *pConfig)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) && (pConfig) )
+	{
+		return (handle->pOps->pNextOutputConfig)?handle->pOps->pNextOutputConfig(handle->context, pendingBytes, pConfig):SBG_NOT_READY;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Wait until our rx queue holds at least one byte
+SbgErrorCode sbgDeviceWaitReadable(SbgDeviceHandle handle, uint32 timeOutMs)
+{
+	return sbgDeviceWaitReadableUntil(handle, sbgGetTimeNs() + (uint64)timeOutMs * 1000000ull);
+}
+
+/// Wait until our rx queue holds at least one byte or the deadline is reached
+SbgErrorCode sbgDeviceWaitReadableUntil(SbgDeviceHandle handle, uint64 deadlineNs)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return handle->pOps->pWaitReadableUntil(handle->context, deadlineNs);
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Flush our RX and TX buffers (remove all old data)
+SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return (handle->pOps->pFlush)?handle->pOps->pFlush(handle->context):SBG_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Defines the serial DTR and RTS pins states
+SbgErrorCode sbgSetEscapeComm(SbgDeviceHandle handle, SbgEscapeComm function)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		return (handle->pOps->pSetEscapeComm)?handle->pOps->pSetEscapeComm(handle->context, function):SBG_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Set the low latency mode of our device
+SbgErrorCode sbgDeviceSetLowLatency(SbgDeviceHandle handle, uint32 latencyTimerMs, SbgDeviceLatencyInfo *pInfo)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) )
+	{
+		if (handle->pOps->pSetLowLatency)
+		{
+			return handle->pOps->pSetLowLatency(handle->context, latencyTimerMs, pInfo);
+		}
+
+		//
+		// The transport has no driver latency to tune, just report it
+		//
+		if (pInfo)
+		{
+			sbgDeviceGetLatencyInfo(handle, pInfo);
+		}
+
+		return SBG_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/// Returns the effective latency related settings of our device
+SbgErrorCode sbgDeviceGetLatencyInfo(SbgDeviceHandle handle, SbgDeviceLatencyInfo *pInfo)
+{
+	if ( (handle != SBG_INVALID_DEVICE_HANDLE) && (handle) && (pInfo) )
+	{
+		if (handle->pOps->pGetLatencyInfo)
+		{
+			return handle->pOps->pGetLatencyInfo(handle->context, pInfo);
+		}
+
+		pInfo->lowLatency = FALSE;
+		pInfo->latencyTimerMs = -1;
+		pInfo->baudRate = 0;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
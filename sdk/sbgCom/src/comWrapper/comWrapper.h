@@ -12,15 +12,20 @@
 #define __COM_WRAPPER_H__
 
 #include "../sbgCommon.h"
+#include "comCapture.h"
 
 //------------------------------------------------------------------------------//
 //- SBG Device definitions                                                     -//
 //------------------------------------------------------------------------------//
 
-/// The device handle is different on each os
-typedef void* SbgDeviceHandle;
+/// Transport specific state, the serial transport stores its file descriptor directly in it
+typedef void* SbgDeviceContext;
+
+/// The device handle holds the transport selected by the device URI and its state
+typedef struct _SbgDevice* SbgDeviceHandle;
 
 #define SBG_INVALID_DEVICE_HANDLE	((const SbgDeviceHandle)-1)		/*!< Identify an invalid device handle. */
+#define SBG_DEVICE_MAX_TRANSPORTS			(16)					/*!< Maximum number of transports that can be registered. */
 #define SBG_SERIAL_TX_BUFFER_SIZE			(2048)					/*!< Define the transmission buffer size for the serial port. */
 #define SBG_SERIAL_RX_BUFFER_SIZE			(2048)					/*!< Define the reception buffer size for the serial port. */
 
@@ -35,13 +40,98 @@ typedef enum _SbgEscapeComm
 	SBG_CLR_RTS					/*!< Set RTS pin to low. */
 } SbgEscapeComm;
 
+/*!
+ *	Effective latency related settings of an opened device, as reported by the driver.
+ */
+typedef struct _SbgDeviceLatencyInfo
+{
+	bool	lowLatency;				/*!< TRUE if the driver has the ASYNC_LOW_LATENCY flag set. */
+	int32	latencyTimerMs;			/*!< USB-serial adapter latency timer in ms, -1 if the device has none. */
+	uint32	baudRate;				/*!< Baud rate read back from the driver, 0 if unknown. */
+} SbgDeviceLatencyInfo;
+
+/*!
+ *	Faults injected by a fault:// device since it has been opened.
+ */
+typedef struct _SbgFaultStats
+{
+	uint64	bytesRead;				/*!< Bytes read from the wrapped device. */
+	uint64	bytesDelivered;			/*!< Bytes returned to the reader, faults included. */
+	uint64	reads;					/*!< Number of fragments returned to the reader. */
+	uint64	bitsFlipped;			/*!< Number of flipped bits. */
+	uint64	bytesDropped;			/*!< Number of dropped bytes. */
+	uint64	bytesDuplicated;		/*!< Number of duplicated bytes. */
+	uint64	bursts;					/*!< Number of injected bursts. */
+	uint64	burstBytes;				/*!< Number of bytes in the injected bursts. */
+} SbgFaultStats;
+
+/*!
+ *	Operations of a transport, selected by the scheme of the device URI passed to sbgDeviceOpen.<br>
+ *	Optional operations can be left NULL.
+ */
+typedef struct _SbgDeviceOps
+{
+	const char		*pScheme;																						/*!< URI scheme handled by the transport, without "://". */
+	SbgErrorCode	(*pOpen)(const char *pPath, uint32 baudRate, SbgDeviceContext *pContext);						/*!< Open the part of the URI after "://". */
+	SbgErrorCode	(*pClose)(SbgDeviceContext context);															/*!< Close and release the context. */
+	SbgErrorCode	(*pChangeBaud)(SbgDeviceContext context, uint32 baudRate);										/*!< Change the baud rate. */
+	SbgErrorCode	(*pWrite)(SbgDeviceContext context, const void *pBuffer, uint32 numBytesToWrite);				/*!< Write all the bytes. */
+	SbgErrorCode	(*pRead)(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead);	/*!< Non blocking read. */
+	SbgErrorCode	(*pReadStamped)(SbgDeviceContext context, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs);	/*!< Optional, pRead stamped with sbgGetTimeNs if NULL. */
+	SbgErrorCode	(*pWaitReadableUntil)(SbgDeviceContext context, uint64 deadlineNs);								/*!< Block until some bytes can be read. */
+	SbgErrorCode	(*pFlush)(SbgDeviceContext context);															/*!< Drop the pending bytes. */
+	SbgErrorCode	(*pSetEscapeComm)(SbgDeviceContext context, SbgEscapeComm function);							/*!< Optional. */
+	SbgErrorCode	(*pSetLowLatency)(SbgDeviceContext context, uint32 latencyTimerMs, SbgDeviceLatencyInfo *pInfo);	/*!< Optional. */
+	SbgErrorCode	(*pGetLatencyInfo)(SbgDeviceContext context, SbgDeviceLatencyInfo *pInfo);						/*!< Optional. */
+	SbgErrorCode	(*pGetCaptureHeader)(SbgDeviceContext context, SbgCaptureHeader *pHeader);						/*!< Optional, transports that replay a capture. */
+	SbgErrorCode	(*pNextOutputConfig)(SbgDeviceContext context, uint32 pendingBytes, SbgCaptureOutputConfig *pConfig);	/*!< Optional, transports that replay a capture. */
+} SbgDeviceOps;
+
+/*!
+ *	An opened device: its transport and the transport state.
+ */
+typedef struct _SbgDevice
+{
+	const SbgDeviceOps	*pOps;				/*!< Transport operations. */
+	SbgDeviceContext	context;			/*!< Transport state returned by pOpen. */
+} SbgDevice;
+
+//------------------------------------------------------------------------------//
+//- Built-in transports                                                        -//
+//------------------------------------------------------------------------------//
+
+extern const SbgDeviceOps sbgSerialUnixOps;		/*!< serial:///dev/ttyUSB0, also used when the device name has no scheme. */
+extern const SbgDeviceOps sbgPtyUnixOps;		/*!< pty:// or pty:///tmp/link, creates a pseudo terminal and links its slave. */
+extern const SbgDeviceOps sbgDataLogOps;		/*!< file://capture.bin[?speed=x], replays a capture or a raw byte stream. */
+extern const SbgDeviceOps sbgUdpOps;			/*!< udp://host:port[?local=port] or udp://:port, serial-to-Ethernet bridges. */
+extern const SbgDeviceOps sbgTcpOps;			/*!< tcp://host:port, serial-to-Ethernet bridges. */
+extern const SbgDeviceOps sbgFaultOps;			/*!< fault://<uri>#seed=1&frag=16&flip=1e-5&drop=1e-4&dup=1e-4&burst=1e-4&burstlen=32, injects faults in the received bytes. */
+
 //------------------------------------------------------------------------------//
 //- SBG Device operations                                                      -//
 //------------------------------------------------------------------------------//
 
 /*!
- * Open the specified device at a specified baud and create a new device handle
- * \param[in]	deviceName			Device name / address (COM21 , /dev/ttys0, depending on platform)
+ * Registers a transport so its scheme can be used in device URIs.<br>
+ * A transport with the same scheme replaces the previous one. Not thread safe, call it before opening devices.
+ * \param[in]	pOps				Transport operations, must stay valid while the library is used
+ * \return							SBG_NO_ERROR if the transport has been registered
+ */
+SbgErrorCode sbgDeviceRegisterTransport(const SbgDeviceOps *pOps);
+
+/*!
+ * Returns the transport that handles a device URI.
+ * \param[in]	deviceName			Device URI such as serial:///dev/sbg, or a plain device name for the serial transport
+ * \param[out]	ppPath				Part of the URI after "://", may be NULL
+ * \return							The transport operations or NULL if the scheme is unknown
+ */
+const SbgDeviceOps *sbgDeviceFindTransport(const char *deviceName, const char **ppPath);
+
+/*!
+ * Open the specified device at a specified baud and create a new device handle.<br>
+ * The device name is an URI whose scheme selects the transport (serial, pty, file, udp, tcp or a registered one).
+ * A name without scheme such as /dev/sbg opens a serial port.
+ * \param[in]	deviceName			Device URI (serial:///dev/sbg, file://capture.bin, udp://127.0.0.1:5000, /dev/ttyS0)
  * \param[in]	baudRate			Baudrate to be used
  * \param[out]	pHandle				Device handle returned
  * \return							SBG_NO_ERROR if the device could be oppened properly
@@ -82,6 +172,54 @@ SbgErrorCode sbgDeviceWrite(SbgDeviceHandle handle, const void *pBuffer, uint32
  */
 SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead);
 
+/*!
+ * Read some bytes from the rx queue and return when they have been read.<br>
+ * The time stamp is taken as soon as the read returns, so it is an upper bound of the arrival time of the last read byte.
+ * \param[in]	handle				Device handle returned
+ * \param[in]	pBuffer				Buffer to be sent through interface
+ * \param[in]	numBytesToRead		Max number of bytes to be read
+ * \param[out]	pNumBytesRead		Actual number read by the function
+ * \param[out]	pTimeStampNs		sbgGetTimeNs monotonic time at which the bytes have been read
+ * \return							SBG_NO_ERROR if one or more bytes read
+ */
+SbgErrorCode sbgDeviceReadStamped(SbgDeviceHandle handle, void *pBuffer, uint32 numBytesToRead, uint32 *pNumBytesRead, uint64 *pTimeStampNs);
+
+/*!
+ * Returns the header of the capture replayed by the device.
+ * \param[in]	handle				Device handle returned
+ * \param[out]	pHeader				Capture header, fields not stored in the capture are set to SBG_CAPTURE_UNKNOWN
+ * \return							SBG_NO_ERROR if the device replays a capture
+ */
+SbgErrorCode sbgDeviceGetCaptureHeader(SbgDeviceHandle handle, SbgCaptureHeader *pHeader);
+
+/*!
+ * Returns the next output configuration change of the replayed capture once it applies.<br>
+ * A change applies to the stream bytes recorded after its streamOffset.
+ * \param[in]	handle				Device handle returned
+ * \param[in]	pendingBytes		Number of read bytes not parsed yet, the next parsed byte is the first of them
+ * \param[out]	pConfig				Output configuration from the next parsed byte on
+ * \return							SBG_NO_ERROR if a change has been returned and removed, SBG_NOT_READY if none applies yet
+ */
+SbgErrorCode sbgDeviceNextOutputConfig(SbgDeviceHandle handle, uint32 pendingBytes, SbgCaptureOutputConfig *pConfig);
+
+/*!
+ * Block until the rx queue holds at least one byte or the time out expires.<br>
+ * Lets a reader sleep in the kernel instead of polling sbgDeviceRead.
+ * \param[in]	handle				Device handle returned
+ * \param[in]	timeOutMs			Maximum time to wait in ms
+ * \return							SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if none arrived in time
+ */
+SbgErrorCode sbgDeviceWaitReadable(SbgDeviceHandle handle, uint32 timeOutMs);
+
+/*!
+ * Block until the rx queue holds at least one byte or the deadline is reached.<br>
+ * The deadline is an absolute sbgGetTimeNs value so interrupted waits resume with the right remaining time.
+ * \param[in]	handle				Device handle returned
+ * \param[in]	deadlineNs			Absolute monotonic time in ns at which we give up
+ * \return							SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if none arrived in time
+ */
+SbgErrorCode sbgDeviceWaitReadableUntil(SbgDeviceHandle handle, uint64 deadlineNs);
+
 /*!
  * Flush the RX and TX buffers (remove all old data)
  * \param[in]	handle				Device handle returned
@@ -89,6 +227,36 @@ SbgErrorCode sbgDeviceRead(SbgDeviceHandle handle, void *pBuffer, uint32 numByte
  */
 SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle);
 
+/*!
+ * Opt-in low latency mode for USB-serial adapters.<br>
+ * Sets the ASYNC_LOW_LATENCY driver flag and, if the adapter exposes one, its latency timer so received bytes
+ * are handed to the tty layer as soon as possible instead of being batched (up to 16 ms on FTDI chips).<br>
+ * The latency timer is written through sysfs so it needs write access to the latency_timer attribute.
+ * \param[in]	handle				Device handle returned
+ * \param[in]	latencyTimerMs		Latency timer to apply in ms (1 to 255), 0 to leave it unchanged
+ * \param[out]	pInfo				Effective settings after the call, may be NULL
+ * \return							SBG_NO_ERROR if every requested setting has been applied
+ */
+SbgErrorCode sbgDeviceSetLowLatency(SbgDeviceHandle handle, uint32 latencyTimerMs, SbgDeviceLatencyInfo *pInfo);
+
+/*!
+ * Returns the effective latency related settings of the device.
+ * \param[in]	handle				Device handle returned
+ * \param[out]	pInfo				Effective settings
+ * \return							SBG_NO_ERROR if the settings have been returned
+ */
+SbgErrorCode sbgDeviceGetLatencyInfo(SbgDeviceHandle handle, SbgDeviceLatencyInfo *pInfo);
+
+/*!
+ * Returns the faults injected so far by a fault:// device.<br>
+ * The fault transport wraps another device URI and, from a seeded generator, fragments the reads at random sizes,
+ * flips bits, drops and duplicates bytes and injects bursts of SYNC/STX look-alikes in the received bytes.
+ * \param[in]	handle				Device handle returned by sbgDeviceOpen for a fault:// URI
+ * \param[out]	pStats				Injected faults
+ * \return							SBG_NO_ERROR if the stats have been returned, SBG_INVALID_PARAMETER if the device isn't a fault:// one
+ */
+SbgErrorCode sbgDeviceGetFaultStats(SbgDeviceHandle handle, SbgFaultStats *pStats);
+
 /*!
  *	Defines the serial DTR and RTS pins states.
  *	\param[in]	handle				The serial communication handle.
@@ -97,4 +265,16 @@ SbgErrorCode sbgDeviceFlush(SbgDeviceHandle handle);
  */
 SbgErrorCode sbgSetEscapeComm(SbgDeviceHandle handle, SbgEscapeComm function);
 
+//------------------------------------------------------------------------------//
+//- Transport helpers                                                          -//
+//------------------------------------------------------------------------------//
+
+/*!
+ * Block until a file descriptor is readable or the deadline is reached, resuming interrupted waits.
+ * \param[in]	fileId				File descriptor to wait for
+ * \param[in]	deadlineNs			Absolute monotonic time in ns at which we give up
+ * \return							SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if none arrived in time
+ */
+SbgErrorCode sbgDevicePollUntil(int32 fileId, uint64 deadlineNs);
+
 #endif
@@ -459,6 +459,11 @@ SbgErrorCode sbgSetOutputMode(SbgProtocolHandle handle, uint8 outputMode)
 			// The new output mode has been processed so update the protocol instance output mode
 			//
 			handle->targetOutputMode = outputMode;
+
+			//
+			// Frames that follow the ACK use the new output mode, a capture replays them with it
+			//
+			sbgProtocolCaptureOutputConfig(handle);
 		}
 	}
 
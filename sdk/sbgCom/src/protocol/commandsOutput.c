@@ -153,6 +153,11 @@ SbgErrorCode sbgSetDefaultOutputMask(SbgProtocolHandle handle, uint32 defaultOut
 			// The new default output mask has been processed so update the protocol instance default output mask
 			//
 			handle->targetDefaultOutputMask = defaultOutputMask;
+
+			//
+			// Frames that follow the ACK use the new default output mask, a capture replays them with it
+			//
+			sbgProtocolCaptureOutputConfig(handle);
 		}
 	}
 
@@ -466,7 +471,7 @@ SbgErrorCode sbgGetDefaultOutput(SbgProtocolHandle handle, SbgOutput *pOutput)
 				//
 				// Returns the output and fill the output structure
 				//
-				error = sbgFillOutputFromBuffer(handle->targetOutputMode, handle->targetDefaultOutputMask, receivedBuffer, size, pOutput);
+				error = sbgProtocolDecodeOutput(handle, handle->targetDefaultOutputMask, receivedBuffer, size, pOutput);
 			}
 			else
 			{
@@ -518,7 +523,7 @@ SbgErrorCode sbgGetSpecificOutput(SbgProtocolHandle handle, uint32 outputMask, S
 				//
 				// Returns the output and fill the output structure
 				//
-				error = sbgFillOutputFromBuffer(handle->targetOutputMode, outputMask, receivedBuffer, size, pOutput);
+				error = sbgProtocolDecodeOutput(handle, outputMask, receivedBuffer, size, pOutput);
 			}
 			else
 			{
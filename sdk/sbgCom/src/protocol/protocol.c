@@ -5,6 +5,91 @@
 #include "commands.h"
 #include "../time/sbgTime.h"
 #include "protocolOutputMode.h"
+#include "protocolCrc.h"
+
+//----------------------------------------------------------------------//
+//- Command answers                                                    -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Answer frame of a command, besides the SBG_ACK every command can answer with.
+ */
+typedef struct _SbgCommandAnswer
+{
+	uint8	cmd;								/*!< Command sent to the device. */
+	uint8	answer;								/*!< Frame returned by the device on success. */
+} SbgCommandAnswer;
+
+static const SbgCommandAnswer gCommandAnswers[] =
+{
+	{SBG_GET_INFOS,						SBG_RET_INFOS},
+	{SBG_SET_PROTOCOL_MODE,				SBG_RET_PROTOCOL_MODE},
+	{SBG_GET_PROTOCOL_MODE,				SBG_RET_PROTOCOL_MODE},
+	{SBG_GET_OUTPUT_MODE,				SBG_RET_OUTPUT_MODE},
+	{SBG_GET_USER_ID,					SBG_RET_USER_ID},
+	{SBG_GET_LOW_POWER_MODE,			SBG_RET_LOW_POWER_MODE},
+	{SBG_GET_USER_BUFFER,				SBG_RET_USER_BUFFER},
+	{SBG_GET_FILTER_FREQUENCIES,		SBG_RET_FILTER_FREQUENCIES},
+	{SBG_GET_FILTER_ATTITUDE_OPTIONS,	SBG_RET_FILTER_ATTITUDE_OPTIONS},
+	{SBG_GET_ORIENTATION_OFFSET,		SBG_RET_ORIENTATION_OFFSET},
+	{SBG_GET_FILTER_HEADING_SOURCE,		SBG_RET_FILTER_HEADING_SOURCE},
+	{SBG_GET_MAGNETIC_DECLINATION,		SBG_RET_MAGNETIC_DECLINATION},
+	{SBG_GET_DEFAULT_OUTPUT_MASK,		SBG_RET_DEFAULT_OUTPUT_MASK},
+	{SBG_GET_CONTINUOUS_MODE,			SBG_RET_CONTINUOUS_MODE},
+	{SBG_GET_DEFAULT_OUTPUT,			SBG_RET_DEFAULT_OUTPUT},
+	{SBG_GET_SPECIFIC_OUTPUT,			SBG_RET_SPECIFIC_OUTPUT},
+	{SBG_CALIB_MAG_GET_TRANSFORMATIONS,	SBG_CALIB_MAG_RET_TRANSFORMATIONS},
+	{SBG_GET_REFERENCE_PRESSURE,		SBG_RET_REFERENCE_PRESSURE},
+	{SBG_GET_GPS_SVINFO,				SBG_RET_GPS_SVINFO},
+	{SBG_GET_NAV_VELOCITY_SRC,			SBG_RET_NAV_VELOCITY_SRC},
+	{SBG_GET_NAV_POSITION_SRC,			SBG_RET_NAV_POSITION_SRC},
+	{SBG_GET_GPS_LEVER_ARM,				SBG_RET_GPS_LEVER_ARM},
+	{SBG_GET_GRAVITY_MAGNITUDE,			SBG_RET_GRAVITY_MAGNITUDE},
+	{SBG_GET_TRIGGERED_OUTPUT,			SBG_RET_TRIGGERED_OUTPUT},
+	{SBG_GET_EXTERNAL_DEVICE,			SBG_RET_EXTERNAL_DEVICE},
+	{SBG_SET_EXTERNAL_DEVICE_CONF,		SBG_RET_EXTERNAL_DEVICE_CONF},
+	{SBG_GET_SYNC_IN_CONF,				SBG_RET_SYNC_IN_CONF},
+	{SBG_GET_SYNC_OUT_CONF,				SBG_RET_SYNC_OUT_CONF},
+	{SBG_GET_ODO_CONFIG,				SBG_RET_ODO_CONFIG},
+	{SBG_GET_ODO_DIRECTION,				SBG_RET_ODO_DIRECTION},
+	{SBG_GET_ODO_LEVER_ARM,				SBG_RET_ODO_LEVER_ARM},
+	{SBG_GET_MP_INFO,					SBG_RET_MP_INFO},
+	{SBG_GET_ADVANCED_OPTIONS,			SBG_RET_ADVANCED_OPTIONS},
+	{SBG_GET_HEAVE_CONF,				SBG_RET_HEAVE_CONF},
+	{SBG_GET_VIRTUAL_ODO_CONF,			SBG_RET_VIRTUAL_ODO_CONF},
+	{SBG_GET_ASCII_OUTPUT_CONF,			SBG_RET_ASCII_OUTPUT_CONF},
+};
+
+/*!
+ *	Check if a received frame answers a command.<br>
+ *	A SBG_ACK carries no command number: a late ACK of a previous command can't be told apart and is accepted.
+ *	\param[in]	cmd						Command sent, SBG_NO_PENDING_COMMAND if none.
+ *	\param[in]	answer					Command number of the received frame.
+ *	
+eturn								TRUE if the frame is SBG_ACK or the answer of cmd, or if no command is pending.
+ */
+static bool sbgProtocolIsAnswer(uint8 cmd, uint8 answer)
+{
+	uint32 i;
+
+	if ( (cmd == SBG_NO_PENDING_COMMAND) || (answer == SBG_ACK) )
+	{
+		return TRUE;
+	}
+
+	for (i = 0; i < sizeof(gCommandAnswers)/sizeof(gCommandAnswers[0]); i++)
+	{
+		if (gCommandAnswers[i].cmd == cmd)
+		{
+			return (gCommandAnswers[i].answer == answer);
+		}
+	}
+
+	//
+	// The command is only answered by an ACK
+	//
+	return FALSE;
+}
 
 //----------------------------------------------------------------------//
 //- Communication protocol operations                                  -//
@@ -53,8 +138,25 @@ SbgErrorCode sbgProtocolInit(const char *deviceName, uint32 baudRate, SbgProtoco
 			//
 			if (protocolHandle)
 			{
-				protocolHandle->serialBufferSize = 0;
+				protocolHandle->serialBufferRead = 0;
+				protocolHandle->serialBufferWrite = 0;
+				protocolHandle->parserState = SBG_PARSER_WAIT_SYNC;
+				protocolHandle->parserOffset = 0;
+				protocolHandle->parserDataSize = 0;
+				protocolHandle->parserCrc = 0;
+				protocolHandle->parserTimeStamp = 0;
+				memset(&protocolHandle->parserStats, 0, sizeof(protocolHandle->parserStats));
+				protocolHandle->rxChunkCount = 0;
+				protocolHandle->byteTimeNs = (baudRate)?(uint32)(SBG_UART_BITS_PER_BYTE*1000000000ull/baudRate):0;
+				protocolHandle->frameTimeStamp = 0;
+				memset(&protocolHandle->defaultOutputPlan, 0, sizeof(protocolHandle->defaultOutputPlan));
+				memset(protocolHandle->outputPlanCache, 0, sizeof(protocolHandle->outputPlanCache));
+				protocolHandle->outputPlanCacheNext = 0;
 				protocolHandle->serialHandle = deviceHandle;
+				protocolHandle->captureHandle = SBG_INVALID_CAPTURE_HANDLE;
+				protocolHandle->captureOutputMode = 0;
+				protocolHandle->captureDefaultOutputMask = 0;
+				protocolHandle->pendingCmd = SBG_NO_PENDING_COMMAND;
 				protocolHandle->targetOutputMode = 0;
 				protocolHandle->targetDefaultOutputMask = 0;
 				protocolHandle->pUserHandlerContinuousError = NULL;
@@ -63,6 +165,8 @@ SbgErrorCode sbgProtocolInit(const char *deviceName, uint32 baudRate, SbgProtoco
 				protocolHandle->pUserArgDefaultOutput = NULL;
 				protocolHandle->pUserHandlerTriggeredOutput = NULL;
 				protocolHandle->pUserArgTriggeredOutput = NULL;
+				protocolHandle->pUserHandlerContinuousRaw = NULL;
+				protocolHandle->pUserArgContinuousRaw = NULL;
 
 				//
 				// We have a valid protocol handle so return it
@@ -122,28 +226,237 @@ SbgErrorCode sbgProtocolClose(SbgProtocolHandle handle)
  */
 uint16 sbgProtocolCalcCRC(const void *pFrame, uint16 bufferSize)
 {
-	const uint8 *pBuffer = (const uint8*)pFrame;
-	uint16 poly = 0x8408;
-	uint16 crc = 0;
-	uint8 carry;
-	uint8 i_bits;
-	uint16 j;
-	
-	for (j=0 ; j < bufferSize ; j++)
+	return sbgCrcUpdate(0, pFrame, bufferSize);
+}
+
+//----------------------------------------------------------------------//
+//- Reception ring buffer operations                                   -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Returns the number of bytes stored in the reception ring buffer.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\return								Number of unread bytes.
+ */
+static uint32 sbgProtocolRxCount(const SbgProtocolHandleInt *handle)
+{
+	return handle->serialBufferWrite - handle->serialBufferRead;
+}
+
+/*!
+ *	Returns an unread byte of the reception ring buffer.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	offset					Offset of the byte from the read cursor.
+ *	\return								The byte value.
+ */
+static uint8 sbgProtocolRxPeek(const SbgProtocolHandleInt *handle, uint32 offset)
+{
+	return handle->serialBuffer[(handle->serialBufferRead + offset) & SBG_RX_BUFFER_MASK];
+}
+
+/*!
+ *	Returns the length of the contiguous run of bytes starting at an offset from the read cursor.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	offset					Offset of the first byte from the read cursor.
+ *	\param[in]	size					Number of bytes wanted.
+ *	\return								Number of bytes that can be accessed before the end of the storage.
+ */
+static uint32 sbgProtocolRxContiguous(const SbgProtocolHandleInt *handle, uint32 offset, uint32 size)
+{
+	uint32 index = (handle->serialBufferRead + offset) & SBG_RX_BUFFER_MASK;
+
+	return (size < SBG_RX_BUFFER_SIZE - index)?size:(SBG_RX_BUFFER_SIZE - index);
+}
+
+/*!
+ *	Copy unread bytes from the reception ring buffer, across the wrap if needed.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	offset					Offset of the first byte from the read cursor.
+ *	\param[out]	pDest					Destination buffer.
+ *	\param[in]	size					Number of bytes to copy.
+ */
+static void sbgProtocolRxCopy(const SbgProtocolHandleInt *handle, uint32 offset, uint8 *pDest, uint32 size)
+{
+	uint32 firstPart = sbgProtocolRxContiguous(handle, offset, size);
+
+	memcpy(pDest, handle->serialBuffer + ((handle->serialBufferRead + offset) & SBG_RX_BUFFER_MASK), firstPart);
+	memcpy(pDest + firstPart, handle->serialBuffer, size - firstPart);
+}
+
+/*!
+ *	Continue a CRC 16 computation over unread bytes in the reception ring buffer, across the wrap if needed.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	crc						CRC computed so far.
+ *	\param[in]	offset					Offset of the first byte from the read cursor.
+ *	\param[in]	size					Number of bytes to add to the CRC.
+ *	\return								Updated CRC 16.
+ */
+static uint16 sbgProtocolRxCRC(const SbgProtocolHandleInt *handle, uint16 crc, uint32 offset, uint32 size)
+{
+	uint32 firstPart = sbgProtocolRxContiguous(handle, offset, size);
+
+	crc = sbgCrcUpdate(crc, handle->serialBuffer + ((handle->serialBufferRead + offset) & SBG_RX_BUFFER_MASK), firstPart);
+	return sbgCrcUpdate(crc, handle->serialBuffer, size - firstPart);
+}
+
+/*!
+ *	Rebuild the arrival time of the byte at the read cursor.<br>
+ *	The byte is located in the chunk returned by a device read and is assumed to have arrived<br>
+ *	one byte transmission time per following byte of the chunk before the chunk has been read.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\return								Arrival time in ns on the sbgGetTimeNs clock.
+ */
+static uint64 sbgProtocolRxTimeStamp(const SbgProtocolHandleInt *handle)
+{
+	const SbgRxChunk *pChunk;
+	uint32 oldest;
+	uint32 i;
+
+	if (handle->rxChunkCount == 0)
+	{
+		return sbgGetTimeNs();
+	}
+
+	//
+	// Walk back from the newest chunk to the one that contains the read cursor
+	// Cursors are free running so compare distances to the write cursor to handle wraps
+	//
+	oldest = (handle->rxChunkCount > SBG_RX_CHUNK_COUNT)?(handle->rxChunkCount - SBG_RX_CHUNK_COUNT):0;
+	i = handle->rxChunkCount - 1;
+
+	while ( (i > oldest) &&
+			(handle->serialBufferWrite - handle->rxChunks[(i-1) & SBG_RX_CHUNK_MASK].end < handle->serialBufferWrite - handle->serialBufferRead) )
 	{
-		crc = crc ^ pBuffer[j] ;
-		for (i_bits=0 ; i_bits < 8 ; i_bits++)
+		i--;
+	}
+
+	pChunk = &handle->rxChunks[i & SBG_RX_CHUNK_MASK];
+
+	return pChunk->timeStamp - (uint64)(pChunk->end - handle->serialBufferRead - 1) * handle->byteTimeNs;
+}
+
+/*!
+ *	Discard received bytes until the read cursor is on a SYNC and STX pair.<br>
+ *	SYNC chars are located with memchr over the contiguous parts of the ring buffer.<br>
+ *	A SYNC char received as the last byte is kept as it can be followed by a STX char.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\return								TRUE if a start of frame is at the read cursor.
+ */
+static bool sbgProtocolRxFindSync(SbgProtocolHandleInt *handle)
+{
+	const uint8 *pSync;
+	uint32 bufferSize;
+	uint32 contiguousSize;
+	uint32 index;
+
+	while ((bufferSize = sbgProtocolRxCount(handle)) > 0)
+	{
+		index = handle->serialBufferRead & SBG_RX_BUFFER_MASK;
+		contiguousSize = sbgProtocolRxContiguous(handle, 0, bufferSize);
+
+		pSync = (const uint8*)memchr(handle->serialBuffer + index, SBG_SYNC, contiguousSize);
+
+		if (pSync)
 		{
-			carry = crc & 1 ;
-			crc = crc / 2 ;
-			if (carry)
+			//
+			// Skip the bytes before the SYNC char
+			//
+			handle->serialBufferRead += (uint32)(pSync - (handle->serialBuffer + index));
+			handle->parserStats.bytesDiscarded += (uint32)(pSync - (handle->serialBuffer + index));
+
+			//
+			// We need the next byte to know if it's a start of frame
+			//
+			if (sbgProtocolRxCount(handle) < 2)
+			{
+				return FALSE;
+			}
+			else if (sbgProtocolRxPeek(handle, 1) == SBG_STX)
 			{
-				crc = crc ^ poly;
+				return TRUE;
 			}
+
+			//
+			// Not followed by STX, skip this SYNC char
+			//
+			handle->serialBufferRead++;
+			handle->parserStats.bytesDiscarded++;
+		}
+		else
+		{
+			//
+			// No SYNC char in this part of the buffer, discard it and go on with the wrapped part if any
+			//
+			handle->serialBufferRead += contiguousSize;
+			handle->parserStats.bytesDiscarded += contiguousSize;
 		}
 	}
 
-	return crc;	
+	return FALSE;
+}
+
+/*!
+ *	Read all available bytes from the device into the free part of the reception ring buffer.<br>
+ *	The free part can be split in two segments when it wraps around the end of the storage.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ */
+static void sbgProtocolRxFill(SbgProtocolHandleInt *handle)
+{
+	uint32 freeSize;
+	uint32 contiguousSize;
+	uint32 numBytesRead;
+	uint64 timeStamp;
+	uint32 segment;
+
+	for (segment = 0; segment < 2; segment++)
+	{
+		freeSize = SBG_RX_BUFFER_SIZE - sbgProtocolRxCount(handle);
+
+		//
+		// Stop when the buffer is full
+		//
+		if (freeSize == 0)
+		{
+			break;
+		}
+
+		contiguousSize = SBG_RX_BUFFER_SIZE - (handle->serialBufferWrite & SBG_RX_BUFFER_MASK);
+		if (contiguousSize > freeSize)
+		{
+			contiguousSize = freeSize;
+		}
+
+		if ( (sbgDeviceReadStamped(handle->serialHandle, handle->serialBuffer + (handle->serialBufferWrite & SBG_RX_BUFFER_MASK),
+								   contiguousSize, &numBytesRead, &timeStamp) != SBG_NO_ERROR) || (numBytesRead == 0) )
+		{
+			break;
+		}
+
+		//
+		// Record the chunk as it has been read, the recorder never blocks
+		//
+		if (handle->captureHandle != SBG_INVALID_CAPTURE_HANDLE)
+		{
+			sbgCaptureWrite(handle->captureHandle, handle->serialBuffer + (handle->serialBufferWrite & SBG_RX_BUFFER_MASK), numBytesRead, timeStamp);
+		}
+
+		handle->serialBufferWrite += numBytesRead;
+
+		//
+		// Remember when this chunk has been read to time stamp the frames it contains
+		//
+		handle->rxChunks[handle->rxChunkCount & SBG_RX_CHUNK_MASK].end = handle->serialBufferWrite;
+		handle->rxChunks[handle->rxChunkCount & SBG_RX_CHUNK_MASK].timeStamp = timeStamp;
+		handle->rxChunkCount++;
+
+		//
+		// Only go on with the second segment if the device had more bytes than the first one could hold
+		//
+		if (numBytesRead < contiguousSize)
+		{
+			break;
+		}
+	}
 }
 
 
@@ -166,7 +479,8 @@ SbgErrorCode sbgProtocolFlush(SbgProtocolHandle handle)
 		//
 		// Flush the protocol buffer
 		//
-		handle->serialBufferSize = 0;
+		handle->serialBufferRead = handle->serialBufferWrite;
+		handle->parserState = SBG_PARSER_WAIT_SYNC;
 
 		//
 		// No error.
@@ -188,10 +502,161 @@ SbgErrorCode sbgProtocolFlush(SbgProtocolHandle handle)
  *	\return								SBG_NO_ERROR if we have changed the serial baud rate.
  */
 SbgErrorCode sbgProtocolChangeBaud(SbgProtocolHandle handle, uint32 baudRate)
+{
+	SbgErrorCode errorCode;
+
+	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		errorCode = sbgDeviceChangeBaud(handle->serialHandle, baudRate);
+
+		if ( (errorCode == SBG_NO_ERROR) && (baudRate) )
+		{
+			handle->byteTimeNs = (uint32)(SBG_UART_BITS_PER_BYTE*1000000000ull/baudRate);
+		}
+
+		return errorCode;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Defines the output mode and default output mask continuous frames are decoded with.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	outputMode				Output mode of the device (big/little endian and float/fixed).
+ *	\param[in]	defaultOutputMask		Default output mask of the device.
+ *	\return								SBG_NO_ERROR if the settings have been changed.
+ */
+SbgErrorCode sbgProtocolSetTargetOutput(SbgProtocolHandle handle, uint32 outputMode, uint32 defaultOutputMask)
+{
+	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		//
+		// The decode plan is rebuilt on the next frame as it checks both settings
+		//
+		handle->targetOutputMode = (uint8)outputMode;
+		handle->targetDefaultOutputMask = defaultOutputMask;
+
+		return sbgProtocolCaptureOutputConfig(handle);
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Defines the recorder every chunk read from the device is written to.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	captureHandle			Recorder created by sbgCaptureOpen, SBG_INVALID_CAPTURE_HANDLE to stop recording.
+ *	\return								SBG_NO_ERROR if the recorder has been changed.
+ */
+SbgErrorCode sbgProtocolSetCapture(SbgProtocolHandle handle, SbgCaptureHandle captureHandle)
+{
+	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		//
+		// The capture header holds the current settings
+		//
+		handle->captureHandle = captureHandle;
+		handle->captureOutputMode = handle->targetOutputMode;
+		handle->captureDefaultOutputMask = handle->targetDefaultOutputMask;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Records the output mode and default output mask in the capture if they have changed.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\return								SBG_NO_ERROR if nothing had to be recorded or the change has been recorded.
+ */
+SbgErrorCode sbgProtocolCaptureOutputConfig(SbgProtocolHandle handle)
+{
+	SbgErrorCode errorCode = SBG_NO_ERROR;
+
+	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		if ( (handle->captureHandle != SBG_INVALID_CAPTURE_HANDLE) &&
+			 ((handle->captureOutputMode != handle->targetOutputMode) || (handle->captureDefaultOutputMask != handle->targetDefaultOutputMask)) )
+		{
+			//
+			// The device sends the bytes that follow the ACK, not parsed yet, with the new settings
+			//
+			errorCode = sbgCaptureWriteOutputConfig(handle->captureHandle, sbgProtocolRxCount(handle), handle->targetOutputMode, handle->targetDefaultOutputMask, sbgGetTimeNs());
+
+			if (errorCode == SBG_NO_ERROR)
+			{
+				handle->captureOutputMode = handle->targetOutputMode;
+				handle->captureDefaultOutputMask = handle->targetDefaultOutputMask;
+			}
+		}
+
+		return errorCode;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Returns the frame parser statistics since the handle has been created.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[out]	pStats					Parser statistics.
+ *	\return								SBG_NO_ERROR if the statistics have been returned.
+ */
+SbgErrorCode sbgProtocolGetParserStats(SbgProtocolHandle handle, SbgProtocolParserStats *pStats)
+{
+	if ( (handle != SBG_INVALID_PROTOCOL_HANDLE) && (pStats) )
+	{
+		*pStats = handle->parserStats;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Returns the arrival time of the first byte of the last frame received by sbgProtocolReceive.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[out]	pTimeStampNs			Arrival time in ns, on the sbgGetTimeNs monotonic clock.
+ *	\return								SBG_NO_ERROR if the time stamp has been returned.
+ */
+SbgErrorCode sbgProtocolGetFrameTimeStamp(SbgProtocolHandle handle, uint64 *pTimeStampNs)
+{
+	if ( (handle != SBG_INVALID_PROTOCOL_HANDLE) && (pTimeStampNs) )
+	{
+		*pTimeStampNs = handle->frameTimeStamp;
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Block until new bytes are available on the serial port or the time out expires.<br>
+ *	Used by a dedicated reader thread to sleep between frames instead of polling sbgProtocolContinuousModeHandle.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	timeOutMs				Maximum time to wait in ms.
+ *	\return								SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if nothing arrived in time.
+ */
+SbgErrorCode sbgProtocolWaitData(SbgProtocolHandle handle, uint32 timeOutMs)
 {
 	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
 	{
-		return sbgDeviceChangeBaud(handle->serialHandle, baudRate);
+		return sbgDeviceWaitReadable(handle->serialHandle, timeOutMs);
 	}
 	else
 	{
@@ -200,7 +665,9 @@ SbgErrorCode sbgProtocolChangeBaud(SbgProtocolHandle handle, uint32 baudRate)
 }
 
 /*!
- *	Send a frame to the device (size should be less than 504 bytes).
+ *	Send a frame to the device (size should be less than 504 bytes).<br>
+ *	The serial port is not flushed: frames already received are first dispatched using sbgProtocolContinuousModeHandle<br>
+ *	so continuous and triggered outputs keep flowing while commands are exchanged.
  *	\param[in]	handle					A valid sbgCom library handle.
  *	\param[in]	cmd						Command number to send.
  *	\param[in]	pData					Pointer to the data field to send.
@@ -229,9 +696,11 @@ SbgErrorCode sbgProtocolSend(SbgProtocolHandle handle, uint8 cmd, const void *pD
 			if (pFrame)
 			{
 				//
-				// Flush the com to remove old data (re-sync)
+				// Don't flush the com port, it would drop continuous frames in flight.
+				// Deliver pending continuous/triggered frames to their callbacks instead
+				// and discard stale answers so the next received answer matches this command.
 				//
-				sbgDeviceFlush(handle->serialHandle);
+				sbgProtocolContinuousModeHandle(handle);
 
 				//
 				// Create the frame
@@ -277,6 +746,11 @@ SbgErrorCode sbgProtocolSend(SbgProtocolHandle handle, uint8 cmd, const void *pD
 				//
 				errorCode = sbgDeviceWrite(handle->serialHandle, pFrame, realSize+8);
 
+				//
+				// Only the answers of this command are returned from now on
+				//
+				handle->pendingCmd = cmd;
+
 				//
 				// Free the sent frame
 				//
@@ -316,12 +790,10 @@ SbgErrorCode sbgProtocolSend(SbgProtocolHandle handle, uint8 cmd, const void *pD
 SbgErrorCode sbgProtocolReceive(SbgProtocolHandle handle, uint8 *pCmd, void *pData, uint16 *pSize, uint16 maxSize)
 {
 	SbgErrorCode errorCode = SBG_NOT_READY;
-	bool syncFound;
-	uint16 dataSize = 0;
+	SbgCaptureOutputConfig outputConfig;
+	uint32 frameSize;
+	uint32 numBytes;
 	uint16 frameCrc;
-	uint16 computedCrc;
-	uint16 i;
-	uint32 numBytesRead;
 
 	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
 	{
@@ -342,258 +814,215 @@ SbgErrorCode sbgProtocolReceive(SbgProtocolHandle handle, uint8 *pCmd, void *pDa
 		}
 
 		//
-		// Check if we can receive some new data (the receive buffer isn't full)
+		// First try to read some new data in the free part of the ring buffer
+		//
+		sbgProtocolRxFill(handle);
+
 		//
-		if (handle->serialBufferSize < SBG_RX_BUFFER_SIZE)
+		// Go on parsing from where the previous call stopped until we have found a valid frame.
+		// The current frame always starts at the read cursor and bytes are consumed by advancing it.
+		//
+		for (;;)
 		{
-			//
-			// First try to read some new data
-			//
-			if (sbgDeviceRead(handle->serialHandle, handle->serialBuffer+handle->serialBufferSize, 
-				              SBG_RX_BUFFER_SIZE-handle->serialBufferSize, &numBytesRead) == SBG_NO_ERROR)
-			{
-				handle->serialBufferSize += (uint16)numBytesRead;
-			}
-			else
+			switch (handle->parserState)
 			{
+			case SBG_PARSER_WAIT_SYNC:
 				//
-				// Nothing read
+				// Look for a valid start of frame
 				//
-				numBytesRead = 0;
-			}
-		}
+				if (!sbgProtocolRxFindSync(handle))
+				{
+					return SBG_NOT_READY;
+				}
 
-		//
-		// We have read all available data from the serial buffer.
-		// We will try to process all received data until we have found a valid frame.
-		//
-		while (handle->serialBufferSize > 0)
-		{
-			//
-			// For now, we haven't found any start of frame
-			//
-			syncFound = FALSE;
+				//
+				// Time stamp the frame now, while the chunk that holds its first byte is still remembered
+				//
+				handle->parserTimeStamp = sbgProtocolRxTimeStamp(handle);
+				handle->parserOffset = 2;
+				handle->parserState = SBG_PARSER_WAIT_HEADER;
+				break;
+
+			case SBG_PARSER_WAIT_HEADER:
+				//
+				// Wait for the CMD and SIZE fields
+				//
+				if (sbgProtocolRxCount(handle) < 5)
+				{
+					return SBG_NOT_READY;
+				}
 
-			//
-			// To find a valid start of frame we need at least 2 bytes in the reception buffer
-			//
-			if (handle->serialBufferSize >= 2)
-			{
 				//
-				// Try to find a valid start of frame by looking for SYNC and STX chars
+				// Extract the frame size (MSB first)
 				//
-				for (i=0; i<handle->serialBufferSize-1; i++)
+				handle->parserDataSize = ((uint16)sbgProtocolRxPeek(handle, 3)<<8) | sbgProtocolRxPeek(handle, 4);
+
+				if (handle->parserDataSize <= SBG_MAX_DATA_LENGTH)
 				{
 					//
-					// A valid start of frame should begin with SYNC and when STX chars
+					// Start the CRC with the CMD and SIZE fields
 					//
-					if ( (handle->serialBuffer[i] == SBG_SYNC) && (handle->serialBuffer[i+1] == SBG_STX) )
-					{
-						//
-						// We have found the sync char so remove all dumy received bytes before the begining of the frame
-						//
-						if (i>0)
-						{
-							memmove(handle->serialBuffer,handle->serialBuffer+i,handle->serialBufferSize-i);
-							handle->serialBufferSize = handle->serialBufferSize-i;
-						}
+					handle->parserCrc = sbgProtocolRxCRC(handle, 0, 2, 3);
+					handle->parserStats.bytesChecked += 3;
+					handle->parserOffset = 5;
+					handle->parserState = SBG_PARSER_WAIT_DATA;
+				}
+				else
+				{
+					//
+					// Frame size invalid, so we should have incorrectly detected a start of frame.
+					// Remove the SYNC and STX char and retry to read a valid frame
+					//
+					handle->serialBufferRead += 2;
+					handle->parserStats.bytesDiscarded += 2;
+					handle->parserStats.invalidSizes++;
+					handle->parserState = SBG_PARSER_WAIT_SYNC;
+				}
+				break;
 
-						//
-						// The sync has been found
-						//
-						syncFound = TRUE;
-						break;
-					}
+			case SBG_PARSER_WAIT_DATA:
+				//
+				// Add the newly received data bytes to the running CRC
+				//
+				numBytes = sbgProtocolRxCount(handle) - handle->parserOffset;
+				if (numBytes > 5u + handle->parserDataSize - handle->parserOffset)
+				{
+					numBytes = 5u + handle->parserDataSize - handle->parserOffset;
 				}
-			}
 
-			//
-			// Check if a valid start of frame has been found
-			//
-			if (syncFound)
-			{
+				handle->parserCrc = sbgProtocolRxCRC(handle, handle->parserCrc, handle->parserOffset, numBytes);
+				handle->parserOffset += numBytes;
+				handle->parserStats.bytesChecked += numBytes;
+
 				//
-				// A valid start of frame found, try to extract the frame if we have at least a whole frame.
+				// Check if we have received the whole data field
 				//
-				if (handle->serialBufferSize < 8)
+				if (handle->parserOffset < 5u + handle->parserDataSize)
 				{
-					//
-					// Don't have enough data for a valid frame
-					//
 					return SBG_NOT_READY;
 				}
 
+				handle->parserState = SBG_PARSER_WAIT_END;
+				break;
+
+			case SBG_PARSER_WAIT_END:
+			default:
 				//
-				// Extract the frame size (MSB first)
+				// Wait for the CRC and ETX fields
 				//
-				dataSize = ((uint16)handle->serialBuffer[3]<<8) | handle->serialBuffer[4];
+				frameSize = handle->parserDataSize + 8u;
+
+				if (sbgProtocolRxCount(handle) < frameSize)
+				{
+					return SBG_NOT_READY;
+				}
 
 				//
-				// Check if the frame size is valid
+				// Whatever happens, the next call will look for a new start of frame
 				//
-				if (dataSize <= SBG_MAX_DATA_LENGTH)
+				handle->parserState = SBG_PARSER_WAIT_SYNC;
+
+				//
+				// Check the ETC char (end of frame)
+				//
+				if (sbgProtocolRxPeek(handle, frameSize-1) != SBG_ETC)
 				{
 					//
-					// Check if we have received the whole frame
+					// End of frame not found so the frame is invalid, we should have incorrectly detected a start of frame.
+					// Remove the SYNC and STX char because we should have an invalid sync
 					//
-					if (handle->serialBufferSize < dataSize+8)
-					{
-						//
-						// Don't have received the whole frame
-						//
-						return SBG_NOT_READY;
-					}
+					handle->serialBufferRead += 2;
+					handle->parserStats.bytesDiscarded += 2;
+					handle->parserStats.invalidEnds++;
+					break;
+				}
+
+				//
+				// Read the CRC from the received frame (MSB first)
+				// 
+				frameCrc = ((uint16)sbgProtocolRxPeek(handle, frameSize-3)<<8) | sbgProtocolRxPeek(handle, frameSize-2);
 
+				//
+				// Check if the received frame has a valid CRC
+				//
+				if (frameCrc != handle->parserCrc)
+				{
 					//
-					// We have the whole frame so check the ETC char (end of frame)
+					// We have an invalid frame CRC but we have also read the whole frame so remove it from the buffer
 					//
-					if (handle->serialBuffer[dataSize+7] == SBG_ETC)
-					{
-						//
-						// Read the CRC from the received frame (MSB first)
-						// 
-						frameCrc = ((uint16)handle->serialBuffer[dataSize+5]<<8) | handle->serialBuffer[dataSize+6];
+					handle->serialBufferRead += frameSize;
+					handle->parserStats.bytesDiscarded += frameSize;
+					handle->parserStats.invalidCrcs++;
+					break;
+				}
 
-						//
-						// Compute the CRC of the received frame
-						//
-						computedCrc = sbgProtocolCalcCRC(handle->serialBuffer+2, dataSize+3);
+				//
+				// We have a valid frame so return the received command
+				//
+				handle->frameTimeStamp = handle->parserTimeStamp;
+				handle->parserStats.validFrames++;
 
+				//
+				// A replayed capture switches the output settings at the first frame sent with the new ones
+				//
+				while (sbgDeviceNextOutputConfig(handle->serialHandle, sbgProtocolRxCount(handle), &outputConfig) == SBG_NO_ERROR)
+				{
+					handle->targetOutputMode = (uint8)outputConfig.outputMode;
+					handle->targetDefaultOutputMask = outputConfig.defaultOutputMask;
+				}
+
+				if (pCmd)
+				{
+					*pCmd = sbgProtocolRxPeek(handle, 2);
+				}
+
+				//
+				// Extract the data field if needed
+				//
+				if (handle->parserDataSize > 0)
+				{
+					//
+					// Check if input parameters are valid
+					//
+					if ( (pData) && (pSize) )
+					{
 						//
-						// Check if the received frame has a valid CRC
+						// Check if we have enough space to store the data field
 						//
-						if (frameCrc == computedCrc)
+						if (handle->parserDataSize > maxSize)
 						{
-							//
-							// We have a valid frame so return the received command
-							//
-							if (pCmd)
-							{
-								*pCmd = handle->serialBuffer[2];
-							}
-
-							//
-							// Extract the data field if needed
-							//
-							if (dataSize > 0)
-							{
-								//
-								// Check if input parameters are valid
-								//
-								if ( (pData) && (pSize) )
-								{
-									//
-									// Check if we have enough space to store the data field
-									//
-									if (dataSize > maxSize)
-									{
-										*pSize = maxSize;
-										memcpy(pData, handle->serialBuffer+5, maxSize);
-										errorCode = SBG_BUFFER_OVERFLOW;
-									}
-									else
-									{
-										*pSize = dataSize;
-										memcpy(pData, handle->serialBuffer+5, dataSize);
-										errorCode = SBG_NO_ERROR;
-									}
-								}
-								else
-								{
-									errorCode = SBG_NULL_POINTER;
-								}
-							}
-							else
-							{
-								errorCode = SBG_NO_ERROR;
-							}
-
-							//
-							// We have read a whole valid frame so remove it from the buffer
-							//
-							if (handle->serialBufferSize>dataSize+8)
-							{
-								memmove(handle->serialBuffer, handle->serialBuffer+dataSize+8, handle->serialBufferSize-(dataSize+8));
-								handle->serialBufferSize = handle->serialBufferSize-(dataSize+8);
-							}
-							else
-							{
-								handle->serialBufferSize = 0;
-							}
-
-							//
-							// A valid frame has been received
-							//
-							return errorCode;
+							*pSize = maxSize;
+							sbgProtocolRxCopy(handle, 5, (uint8*)pData, maxSize);
+							errorCode = SBG_BUFFER_OVERFLOW;
 						}
 						else
 						{
-							//
-							// We have an invalid frame CRC but we have also read the whole frame so remove it from the buffer
-							//
-							if (handle->serialBufferSize>dataSize+8)
-							{
-								memmove(handle->serialBuffer, handle->serialBuffer+dataSize+8, handle->serialBufferSize-(dataSize+8));
-								handle->serialBufferSize = handle->serialBufferSize-(dataSize+8);
-							}
-							else
-							{
-								handle->serialBufferSize = 0;
-							}
+							*pSize = handle->parserDataSize;
+							sbgProtocolRxCopy(handle, 5, (uint8*)pData, handle->parserDataSize);
+							errorCode = SBG_NO_ERROR;
 						}
 					}
 					else
 					{
-						//
-						// End of frame not found so the frame is invalid, we should have incorrectly detected a start of frame.
-						// Remove the SYNC and STX char because we should have an invalid sync
-						//
-						memmove(handle->serialBuffer, handle->serialBuffer+2, handle->serialBufferSize-2);
-						handle->serialBufferSize = handle->serialBufferSize-2;
+						errorCode = SBG_NULL_POINTER;
 					}
 				}
 				else
-				{						
-					//
-					// Frame size invalid, so we should have incorrectly detected a start of frame.
-					// Remove the SYNC and STX char and retry to read a valid frame
-					//
-					memmove(handle->serialBuffer, handle->serialBuffer+2, handle->serialBufferSize-2);
-					handle->serialBufferSize = handle->serialBufferSize-2;
+				{
+					errorCode = SBG_NO_ERROR;
 				}
-			}
-			else
-			{
+
 				//
-				// Unable to find a valid start of frame so check if the last byte is a SYNC char in order to keep it for next time
+				// We have read a whole valid frame so remove it from the buffer
 				//
-				if (handle->serialBuffer[handle->serialBufferSize-1] == SBG_SYNC)
-				{
-					//
-					// Report the SYNC char and discard all other bytes in the buffer
-					//
-					handle->serialBuffer[0] = SBG_SYNC;
-					handle->serialBufferSize = 1;
-				}
-				else
-				{
-					//
-					// Discard the whole buffer
-					//
-					handle->serialBufferSize = 0;
-				}
+				handle->serialBufferRead += frameSize;
 
 				//
-				// Unable to find a start of frame
+				// A valid frame has been received
 				//
-				return SBG_NOT_READY;
+				return errorCode;
 			}
 		}
-
-		//
-		// The whole buffer has been paresed and no valid frame has been found
-		//
-		return SBG_NOT_READY;
 	}
 	else
 	{
@@ -620,7 +1049,10 @@ SbgErrorCode sbgProtocolReceiveTimeOut(SbgProtocolHandle handle, uint8 *pCmd, vo
 
 /*!
  *	Try to receive a frame during a time out.
- *	This function also handle continuous frame present in the serial buffer.
+ *	This function also handle continuous frame present in the serial buffer:<br>
+ *	continuous and triggered frames received while waiting are delivered to their callbacks and the wait goes on.
+ *	Answers of another command than the last one sent by sbgProtocolSend, late after a time out, are discarded.
+ *	Between frames the function sleeps on the serial port until bytes arrive, the time out uses the monotonic clock.
  *	\param[in]	handle					A valid sbgCom library handle.
  *	\param[out]	pCmd					Pointer to hold the returned command.
  *	\param[out]	pData					Allocated buffer used to hold received data field.
@@ -631,7 +1063,7 @@ SbgErrorCode sbgProtocolReceiveTimeOut(SbgProtocolHandle handle, uint8 *pCmd, vo
  */
 SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd, void *pData, uint16 *pSize, uint16 maxSize, uint32 timeOutMs)
 {
-	uint32 endReceiveTime = sbgGetTime() + timeOutMs;
+	uint64 deadline = sbgGetTimeNs() + (uint64)timeOutMs * 1000000ull;
 	SbgErrorCode errorCode;
 	uint8 fullFrame[512];
 	uint16 sizeTmp;
@@ -645,7 +1077,7 @@ SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd,
 		//
 		// Try to read the frame until the time out has elapsed
 		//
-		while (sbgGetTime() < endReceiveTime)
+		while (sbgGetTimeNs() < deadline)
 		{
 			//
 			// Max size is here set to 512 because continuous information can occur before the
@@ -679,7 +1111,15 @@ SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd,
 
 				default:
 					//
-					// Not a continuous frame, so we return its parameters
+					// Not a continuous frame: a late answer of a previous command is discarded and the wait goes on
+					//
+					if (!sbgProtocolIsAnswer(handle->pendingCmd, cmdTmp))
+					{
+						break;
+					}
+
+					//
+					// Return the answer parameters
 					// Check if the Data buffer has enough space to contain the received answer
 					//
 					if (sizeTmp <= maxSize)
@@ -717,9 +1157,14 @@ SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd,
 			else if (errorCode == SBG_NOT_READY)
 			{
 				//
-				// We only sleep if nothing was received
+				// Nothing complete in the buffer, sleep until new bytes land on the serial port or the time out expires
 				//
-				sbgSleep(1);
+				errorCode = sbgDeviceWaitReadableUntil(handle->serialHandle, deadline);
+
+				if ( (errorCode != SBG_NO_ERROR) && (errorCode != SBG_TIME_OUT) )
+				{
+					return errorCode;
+				}
 			}
 			else
 			{
@@ -738,6 +1183,77 @@ SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd,
 	}
 }
 
+/*!
+ *	Fill the SbgOutput struct from a raw output buffer using a cached decode plan.<br>
+ *	Plans are built on first use and rebuilt automatically when the output mode or mask changes.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	outputMask				Mask combinaison that defines which outputs are contained in the pBuffer.
+ *	\param[in]	pBuffer					Raw buffer that contains the data to extract into SbgOutput.
+ *	\param[in]	bufferSize				The size of the pBuffer.
+ *	\param[out]	pOutput					Pointer to a SbgOutut struct used to hold extracted data.
+ *	\return								SBG_NO_ERROR if we have sucessfully extracted data from pBuffer and filled the pOutput struct.
+ */
+SbgErrorCode sbgProtocolDecodeOutput(SbgProtocolHandle handle, uint32 outputMask, const void *pBuffer, uint16 bufferSize, SbgOutput *pOutput)
+{
+	SbgOutputDecodePlan *pPlan = NULL;
+	SbgErrorCode errorCode;
+	uint32 i;
+
+	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
+	{
+		if (outputMask == handle->targetDefaultOutputMask)
+		{
+			//
+			// Most frames use the default output mask
+			//
+			pPlan = &handle->defaultOutputPlan;
+		}
+		else
+		{
+			//
+			// Look for a plan already built for this mask
+			//
+			for (i=0; i<SBG_OUTPUT_PLAN_CACHE_SIZE; i++)
+			{
+				if ( (handle->outputPlanCache[i].valid) && (handle->outputPlanCache[i].outputMask == outputMask) )
+				{
+					pPlan = &handle->outputPlanCache[i];
+					break;
+				}
+			}
+
+			//
+			// Not found so replace the oldest entry
+			//
+			if (!pPlan)
+			{
+				pPlan = &handle->outputPlanCache[handle->outputPlanCacheNext];
+				pPlan->valid = FALSE;
+				handle->outputPlanCacheNext = (handle->outputPlanCacheNext + 1) % SBG_OUTPUT_PLAN_CACHE_SIZE;
+			}
+		}
+
+		//
+		// Build the plan again if the output mode or mask has changed since it was built
+		//
+		if ( (!pPlan->valid) || (pPlan->targetOutputMode != handle->targetOutputMode) || (pPlan->outputMask != outputMask) )
+		{
+			errorCode = sbgBuildOutputDecodePlan(handle->targetOutputMode, outputMask, pPlan);
+
+			if (errorCode != SBG_NO_ERROR)
+			{
+				return sbgFillOutputFromBuffer(handle->targetOutputMode, outputMask, (void*)pBuffer, bufferSize, pOutput);
+			}
+		}
+
+		return sbgExecuteOutputDecodePlan(pPlan, pBuffer, bufferSize, pOutput);
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
 /*!
  *	Handles a received continuous frame and call the user continuous mode callback if the received frame is valid.
  *	\param[in]	handle					A valid sbgCom library handle.
@@ -753,14 +1269,19 @@ SbgErrorCode sbgProtocolManageContinuousFrame(SbgProtocolHandle handle, uint8 *p
 	if (handle != SBG_INVALID_PROTOCOL_HANDLE)
 	{
 		//
-		// Check if we have a user handler
+		// Give the raw frame to the user decoder first, the frame is decoded only if it has not been handled
 		//
-		if (handle->pUserHandlerDefaultOutput)
+		if ( (handle->pUserHandlerContinuousRaw) &&
+			 (handle->pUserHandlerContinuousRaw(handle, handle->targetDefaultOutputMask, pFullFrame, size, handle->pUserArgContinuousRaw)) )
+		{
+			errorCode = SBG_NO_ERROR;
+		}
+		else if (handle->pUserHandlerDefaultOutput)
 		{
 			//
 			// First, compute the SbgOutput structure
 			//
-			errorCode = sbgFillOutputFromBuffer(handle->targetOutputMode, handle->targetDefaultOutputMask, pFullFrame, size, &output);
+			errorCode = sbgProtocolDecodeOutput(handle, handle->targetDefaultOutputMask, pFullFrame, size, &output);
 
 			if (errorCode == SBG_NO_ERROR)
 			{
@@ -819,7 +1340,7 @@ SbgErrorCode sbgProtocolManageTriggeredFrame(SbgProtocolHandle handle, uint8 *pF
 				//
 				// Then compute the SbgOutput structure
 				//
-				errorCode = sbgFillOutputFromBuffer(handle->targetOutputMode, outputMask, pFullFrame+2*sizeof(uint32), size-2*sizeof(uint32), &output);
+				errorCode = sbgProtocolDecodeOutput(handle, outputMask, pFullFrame+2*sizeof(uint32), size-2*sizeof(uint32), &output);
 
 				if (errorCode == SBG_NO_ERROR)
 				{
@@ -1013,3 +1534,27 @@ SbgErrorCode sbgSetContinuousModeCallback(SbgProtocolHandle handle, ContinuousMo
 		return SBG_NULL_POINTER;
 	}
 }
+
+/*!
+ *	Defines the handle function to call with the raw data of each continuous frame.
+ *	\param[in]	handle						A valid sbgCom library handle.
+ *	\param[in]	callback					Pointer to the continuous raw frame handler function.
+ *	\param[in]	pUserArg					User argument to pass to the continuous raw frame handler function.
+ *	\return									SBG_NO_ERROR if the callback function has been defined. 
+ */
+SbgErrorCode sbgSetContinuousRawCallback(SbgProtocolHandle handle, ContinuousRawCallback callback, void *pUserArg)
+{
+	//
+	// Check if we have both a valid handle and a valid callback function
+	//
+	if ( (handle != NULL) && (callback != NULL) )
+	{
+		handle->pUserHandlerContinuousRaw = callback;
+		handle->pUserArgContinuousRaw = pUserArg;
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
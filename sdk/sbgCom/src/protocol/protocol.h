@@ -32,7 +32,8 @@
 //----------------------------------------------------------------------//
 //- Global definitions                                                 -//
 //----------------------------------------------------------------------//
-#define SBG_RX_BUFFER_SIZE					(SBG_SERIAL_RX_BUFFER_SIZE)		/*!< Reception buffer size. */
+#define SBG_RX_BUFFER_SIZE					(SBG_SERIAL_RX_BUFFER_SIZE)		/*!< Reception ring buffer size, must be a power of two. */
+#define SBG_RX_BUFFER_MASK					(SBG_RX_BUFFER_SIZE-1)			/*!< Mask used to convert a ring buffer cursor into an index. */
 #define SBG_FRAME_RECEPTION_TIME_OUT		(450)							/*!< Default time out for new frame reception. */
 #define SBG_MAX_DATA_LENGTH					(1016)							/*!< Maximum size of the data part of the frame. */
 
@@ -42,29 +43,95 @@
 
 #define SBG_INVALID_PROTOCOL_HANDLE			(NULL)							/*!< Identify an invalid protocol handle. */
 
+#define SBG_OUTPUT_PLAN_CACHE_SIZE			(4)								/*!< Number of decode plans cached for triggered and specific outputs. */
+
+#define SBG_RX_CHUNK_COUNT					(32)							/*!< Number of read chunks remembered to time stamp frames, must be a power of two. */
+#define SBG_RX_CHUNK_MASK					(SBG_RX_CHUNK_COUNT-1)			/*!< Mask used to convert a chunk counter into an index. */
+#define SBG_UART_BITS_PER_BYTE				(10)							/*!< Start bit, 8 data bits and stop bit. */
+
+#define SBG_NO_PENDING_COMMAND				(0x00)							/*!< No command sent, every received answer is accepted. */
+
 //----------------------------------------------------------------------//
 //- Communication protocol structs and definitions                     -//
 //----------------------------------------------------------------------//
 
+/*!
+ *	States of the incremental frame parser.<br>
+ *	The parser keeps its position between calls so each received byte is only examined once.
+ */
+typedef enum _SbgProtocolParserState
+{
+	SBG_PARSER_WAIT_SYNC,								/*!< Looking for the SYNC and STX chars. */
+	SBG_PARSER_WAIT_HEADER,								/*!< Waiting for the CMD and SIZE fields. */
+	SBG_PARSER_WAIT_DATA,								/*!< Accumulating the CRC over the data field as it arrives. */
+	SBG_PARSER_WAIT_END									/*!< Waiting for the CRC and ETX fields. */
+} SbgProtocolParserState;
+
+/*!
+ *	Time stamp of a chunk of bytes returned by one device read.
+ */
+typedef struct _SbgRxChunk
+{
+	uint32 end;											/*!< Write cursor just after the last byte of the chunk */
+	uint64 timeStamp;									/*!< sbgGetTimeNs time at which the chunk has been read */
+} SbgRxChunk;
+
+/*!
+ *	Frame parser statistics, they measure how much work noisy links cost to the parser.
+ */
+typedef struct _SbgProtocolParserStats
+{
+	uint64 validFrames;									/*!< Number of frames with a valid CRC */
+	uint64 invalidSizes;								/*!< Number of start of frames rejected because of their size field */
+	uint64 invalidEnds;									/*!< Number of frames rejected because of a missing ETX char */
+	uint64 invalidCrcs;									/*!< Number of frames rejected because of their CRC */
+	uint64 bytesDiscarded;								/*!< Bytes consumed outside of valid frames */
+	uint64 bytesChecked;								/*!< Bytes added to a running CRC, bytes of rejected frames are checked again */
+} SbgProtocolParserStats;
+
 /*!
  *	Struct containing all protocol related data.
  */
 typedef struct _SbgProtocolHandleInt
 {
-	uint8 serialBuffer[SBG_RX_BUFFER_SIZE];				/*!< The reception buffer */
-	uint16 serialBufferSize;							/*!< Size of the reception buffer */
+	uint8 serialBuffer[SBG_RX_BUFFER_SIZE];				/*!< The reception ring buffer */
+	uint32 serialBufferRead;							/*!< Free running read cursor, bytes are consumed by advancing it */
+	uint32 serialBufferWrite;							/*!< Free running write cursor, the number of stored bytes is serialBufferWrite-serialBufferRead */
+
+	SbgProtocolParserState parserState;					/*!< State of the frame parser, the current frame starts at the read cursor */
+	uint32 parserOffset;								/*!< Number of bytes of the current frame already examined */
+	uint16 parserDataSize;								/*!< Data field size of the current frame */
+	uint16 parserCrc;									/*!< CRC accumulated over the bytes of the current frame examined so far */
+	uint64 parserTimeStamp;								/*!< Arrival time of the first byte of the current frame */
+	SbgProtocolParserStats parserStats;					/*!< Frame parser statistics */
+
+	SbgRxChunk rxChunks[SBG_RX_CHUNK_COUNT];			/*!< Time stamps of the last read chunks */
+	uint32 rxChunkCount;								/*!< Free running number of read chunks */
+	uint32 byteTimeNs;									/*!< Time needed to transmit one byte at the current baud rate */
+	uint64 frameTimeStamp;								/*!< Arrival time of the first byte of the last received frame */
 	SbgDeviceHandle serialHandle;						/*!< Handle to the device */
+	SbgCaptureHandle captureHandle;						/*!< Recorder every read chunk is written to, SBG_INVALID_CAPTURE_HANDLE if none */
+	uint8 captureOutputMode;							/*!< Output mode last written to the capture */
+	uint32 captureDefaultOutputMask;					/*!< Default output mask last written to the capture */
+
+	uint8 pendingCmd;									/*!< Last command sent by sbgProtocolSend, only its answers are returned by sbgProtocolReceiveTimeOutMs */
 
 	uint8 targetOutputMode;								/*!< Define target settings (big/little endian and float/fixed) */
 	uint32 targetDefaultOutputMask;						/*!< Define default output mask for SBG_GET_DEFAULT_OUTPUT_MASK command */
 
+	SbgOutputDecodePlan defaultOutputPlan;								/*!< Decode plan for the default output mask, rebuilt when the mode or mask changes */
+	SbgOutputDecodePlan outputPlanCache[SBG_OUTPUT_PLAN_CACHE_SIZE];	/*!< Decode plans for the other output masks seen in triggered or specific outputs */
+	uint8 outputPlanCacheNext;											/*!< Next cache entry to replace */
+
 	void (*pUserHandlerContinuousError)(struct _SbgProtocolHandleInt *pHandler, SbgErrorCode errorCode, void *pUsrArg);					/*!< Function pointer that should be called when we have an error on a continuous/triggered operation */
 	void (*pUserHandlerTriggeredOutput)(struct _SbgProtocolHandleInt *pHandler, uint32 triggerMask, SbgOutput *pOutput, void *pUsrArg);	/*!< Function pointer that should be called when we receive a new triggered frame */
 	void (*pUserHandlerDefaultOutput)(struct _SbgProtocolHandleInt *pHandler, SbgOutput *pOutput, void *pUsrArg);						/*!< Function pointer that should be called when we receive a new continous frame */
+	bool (*pUserHandlerContinuousRaw)(struct _SbgProtocolHandleInt *pHandler, uint32 outputMask, const uint8 *pBuffer, uint16 size, void *pUsrArg);	/*!< Function pointer called with the raw data of a continuous frame, before decoding it */
 	
 	void *pUserArgContinuousError;						/*!< User defined data passed to the continuous error callback function. */
 	void *pUserArgDefaultOutput;						/*!< User defined data passed to the continuous callback function */
 	void *pUserArgTriggeredOutput;						/*!< User defined data passed to the Triggered output callback function */
+	void *pUserArgContinuousRaw;						/*!< User defined data passed to the continuous raw callback function */
 
 } SbgProtocolHandleInt;
 
@@ -98,6 +165,20 @@ typedef void (*ContinuousModeCallback)(SbgProtocolHandleInt *pHandler, SbgOutput
  */
 typedef void (*TriggeredModeCallback)(SbgProtocolHandleInt *pHandler,uint32 triggerMask, SbgOutput *pOutput, void *pUsrArg);
 
+/*!
+ *	Function pointer definition for continuous raw callback.<br>
+ *	This callback is called with the data field of each valid continuous frame, before it is decoded.<br>
+ *	It lets a user decoder specialized for a known output mask and mode handle the frame directly.
+ *	\param[in]	pHandler								The associated protocol handle, targetOutputMode gives the output mode.
+ *	\param[in]	outputMask								Output mask the frame has been produced with (targetDefaultOutputMask).
+ *	\param[in]	pBuffer									Data field of the frame, only valid during the call.
+ *	\param[in]	size									Size of the data field.
+ *	\param[in]	pUsrArg									Pointer to the user defined argument.
+ *	\return												TRUE if the frame has been handled.<br>
+ *														FALSE to decode it into a SbgOutput and call the continuous callback.
+ */
+typedef bool (*ContinuousRawCallback)(SbgProtocolHandleInt *pHandler, uint32 outputMask, const uint8 *pBuffer, uint16 size, void *pUsrArg);
+
 /*!
  *	Handle type used by the protocol system.
  */
@@ -147,7 +228,65 @@ SbgErrorCode sbgProtocolFlush(SbgProtocolHandle handle);
 SbgErrorCode sbgProtocolChangeBaud(SbgProtocolHandle handle, uint32 baudRate);
 
 /*!
- *	Send a frame to the device (size should be less than 504 bytes).
+ *	Defines the output mode and default output mask continuous frames are decoded with.<br>
+ *	sbgComInit reads them from the device; without a device to ask (replay of a capture) they have to be given.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	outputMode				Output mode of the device (big/little endian and float/fixed).
+ *	\param[in]	defaultOutputMask		Default output mask of the device.
+ *	\return								SBG_NO_ERROR if the settings have been changed.
+ */
+SbgErrorCode sbgProtocolSetTargetOutput(SbgProtocolHandle handle, uint32 outputMode, uint32 defaultOutputMask);
+
+/*!
+ *	Defines the recorder every chunk read from the device is written to, with its arrival time stamp.<br>
+ *	The capture header holds the current output mode and default output mask, their later changes are recorded.<br>
+ *	The recorder isn't owned by the protocol handle: detach it before closing either of them.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	captureHandle			Recorder created by sbgCaptureOpen, SBG_INVALID_CAPTURE_HANDLE to stop recording.
+ *	\return								SBG_NO_ERROR if the recorder has been changed.
+ */
+SbgErrorCode sbgProtocolSetCapture(SbgProtocolHandle handle, SbgCaptureHandle captureHandle);
+
+/*!
+ *	Records the output mode and default output mask in the capture if they have changed.<br>
+ *	Called by the commands that change them, once the device has acknowledged the change.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\return								SBG_NO_ERROR if nothing had to be recorded or the change has been recorded.
+ */
+SbgErrorCode sbgProtocolCaptureOutputConfig(SbgProtocolHandle handle);
+
+/*!
+ *	Returns the frame parser statistics since the handle has been created.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[out]	pStats					Parser statistics.
+ *	\return								SBG_NO_ERROR if the statistics have been returned.
+ */
+SbgErrorCode sbgProtocolGetParserStats(SbgProtocolHandle handle, SbgProtocolParserStats *pStats);
+
+/*!
+ *	Returns the arrival time of the first byte of the last frame received by sbgProtocolReceive.<br>
+ *	It is rebuilt from the time stamp of the read that returned the byte, its position in that read<br>
+ *	and the baud rate, so it doesn't depend on when the frame has been parsed.<br>
+ *	Inside a continuous, triggered or raw callback it is the time stamp of the frame being handled.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[out]	pTimeStampNs			Arrival time in ns, on the sbgGetTimeNs monotonic clock.
+ *	\return								SBG_NO_ERROR if the time stamp has been returned.
+ */
+SbgErrorCode sbgProtocolGetFrameTimeStamp(SbgProtocolHandle handle, uint64 *pTimeStampNs);
+
+/*!
+ *	Block until new bytes are available on the serial port or the time out expires.<br>
+ *	Used by a dedicated reader thread to sleep between frames instead of polling sbgProtocolContinuousModeHandle.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	timeOutMs				Maximum time to wait in ms.
+ *	\return								SBG_NO_ERROR if some bytes can be read, SBG_TIME_OUT if nothing arrived in time.
+ */
+SbgErrorCode sbgProtocolWaitData(SbgProtocolHandle handle, uint32 timeOutMs);
+
+/*!
+ *	Send a frame to the device (size should be less than 504 bytes).<br>
+ *	The serial port is not flushed: frames already received are first dispatched using sbgProtocolContinuousModeHandle<br>
+ *	so continuous and triggered outputs keep flowing while commands are exchanged.
  *	\param[in]	handle					A valid sbgCom library handle.
  *	\param[in]	cmd						Command number to send.
  *	\param[in]	pData					Pointer to the data field to send.
@@ -185,7 +324,8 @@ SbgErrorCode sbgProtocolReceiveTimeOut(SbgProtocolHandle handle, uint8 *pCmd, vo
 
 /*!
  *	Try to receive a frame during a time out.
- *	This function also handle continuous frame present in the serial buffer.
+ *	This function also handle continuous frame present in the serial buffer.<br>
+ *	Only SBG_ACK and the answer of the last command sent by sbgProtocolSend are returned, other answers are discarded.
  *	\param[in]	handle					A valid sbgCom library handle.
  *	\param[out]	pCmd					Pointer to hold the returned command.
  *	\param[out]	pData					Allocated buffer used to hold received data field.
@@ -196,6 +336,18 @@ SbgErrorCode sbgProtocolReceiveTimeOut(SbgProtocolHandle handle, uint8 *pCmd, vo
  */
 SbgErrorCode sbgProtocolReceiveTimeOutMs(SbgProtocolHandle handle, uint8 *pCmd, void *pData, uint16 *pSize, uint16 maxSize, uint32 timeOutMs);
 
+/*!
+ *	Fill the SbgOutput struct from a raw output buffer using a cached decode plan.<br>
+ *	Plans are built on first use and rebuilt automatically when the output mode or mask changes.
+ *	\param[in]	handle					A valid sbgCom library handle.
+ *	\param[in]	outputMask				Mask combinaison that defines which outputs are contained in the pBuffer.
+ *	\param[in]	pBuffer					Raw buffer that contains the data to extract into SbgOutput.
+ *	\param[in]	bufferSize				The size of the pBuffer.
+ *	\param[out]	pOutput					Pointer to a SbgOutut struct used to hold extracted data.
+ *	\return								SBG_NO_ERROR if we have sucessfully extracted data from pBuffer and filled the pOutput struct.
+ */
+SbgErrorCode sbgProtocolDecodeOutput(SbgProtocolHandle handle, uint32 outputMask, const void *pBuffer, uint16 bufferSize, SbgOutput *pOutput);
+
 /*!
  *	Handles a received continuous frame and call the user continuous mode callback if the received frame is valid.
  *	\param[in]	handle					A valid sbgCom library handle.
@@ -251,4 +403,14 @@ SbgErrorCode sbgSetContinuousErrorCallback(SbgProtocolHandle handle, ContinuousE
  */
 SbgErrorCode sbgSetContinuousModeCallback(SbgProtocolHandle handle, ContinuousModeCallback callback, void *pUserArg);
 
+/*!
+ *	Defines the handle function to call with the raw data of each continuous frame.<br>
+ *	Frames the raw handler doesn't handle are still decoded and passed to the continuous callback.
+ *	\param[in]	handle						A valid sbgCom library handle.
+ *	\param[in]	callback					Pointer to the continuous raw frame handler function.
+ *	\param[in]	pUserArg					User argument to pass to the continuous raw frame handler function.
+ *	\return									SBG_NO_ERROR if the callback function has been defined. 
+ */
+SbgErrorCode sbgSetContinuousRawCallback(SbgProtocolHandle handle, ContinuousRawCallback callback, void *pUserArg);
+
 #endif
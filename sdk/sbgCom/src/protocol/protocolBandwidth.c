@@ -0,0 +1,240 @@
+#include "protocolBandwidth.h"
+#include "protocolOutput.h"
+#include "commands.h"
+#include <string.h>
+
+//----------------------------------------------------------------------//
+//- Internal definitions                                               -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Baud rates accepted by the device, in increasing order.
+ */
+static const uint32 gSbgBandwidthBaudRates[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600};
+
+/*!
+ *	Events per second that fire a triggered condition, at most one per main loop iteration.
+ *	\param[in]	pConfig						Configuration with the sensor rates.
+ *	\param[in]	triggerMask					Triggers of the condition.
+ *	\param[in]	divider						Main loop divider.
+ *	\return									Frames per second sent by the condition.
+ */
+static float sbgBandwidthTriggerRate(const SbgBandwidthConfig *pConfig, uint32 triggerMask, uint8 divider)
+{
+	uint32 otherTriggers;
+	float rate = 0.0f;
+
+	if (triggerMask & SBG_TRIGGER_MAIN_LOOP_DIVIDER)
+	{
+		rate += pConfig->mainLoopRate/(float)divider;
+	}
+	if (triggerMask & SBG_TRIGGER_MAGNETOMETERS)
+	{
+		rate += pConfig->magRate;
+	}
+	if (triggerMask & SBG_TRIGGER_BAROMETER)
+	{
+		rate += pConfig->baroRate;
+	}
+	if (triggerMask & SBG_TRIGGER_GPS_VELOCITY)
+	{
+		rate += pConfig->gpsRate;
+	}
+	if (triggerMask & SBG_TRIGGER_GPS_POSITION)
+	{
+		rate += pConfig->gpsRate;
+	}
+	if (triggerMask & SBG_TRIGGER_GPS_COURSE)
+	{
+		rate += pConfig->gpsRate;
+	}
+
+	//
+	// Nothing tells how often the external events occur, assume the worst case
+	//
+	otherTriggers = triggerMask & ~(SBG_TRIGGER_MAIN_LOOP_DIVIDER | SBG_TRIGGER_MAGNETOMETERS | SBG_TRIGGER_BAROMETER |
+									SBG_TRIGGER_GPS_VELOCITY | SBG_TRIGGER_GPS_POSITION | SBG_TRIGGER_GPS_COURSE);
+	if (otherTriggers)
+	{
+		rate = pConfig->mainLoopRate;
+	}
+
+	return (rate < pConfig->mainLoopRate)?rate:pConfig->mainLoopRate;
+}
+
+/*!
+ *	Compute the line usage with a given divider and baud rate.
+ *	\param[in]	pConfig						Configuration to evaluate.
+ *	\param[in]	divider						Main loop divider to use instead of the configured one.
+ *	\param[in]	baudRate					Baud rate to use instead of the configured one.
+ *	\param[out]	pReport						Line usage.
+ *	\return									SBG_NO_ERROR, SBG_INVALID_PARAMETER if a parameter is invalid.
+ */
+static SbgErrorCode sbgBandwidthEvaluate(const SbgBandwidthConfig *pConfig, uint8 divider, uint32 baudRate, SbgBandwidthReport *pReport)
+{
+	float frameRate;
+	uint16 frameSize;
+	uint32 i;
+
+	if ( (!pConfig) || (!pReport) || (pConfig->mainLoopRate <= 0.0f) || (divider == 0) || (baudRate == 0) )
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+
+	memset(pReport, 0, sizeof(SbgBandwidthReport));
+	pReport->lineBytesPerSecond = (float)baudRate/(float)SBG_UART_BITS_PER_BYTE;
+
+	if (pConfig->contMode == SBG_CONTINUOUS_MODE_ENABLE)
+	{
+		frameRate = pConfig->mainLoopRate/(float)divider;
+		frameSize = sbgBandwidthFrameSize(pConfig->outputMode, pConfig->defaultOutputMask, FALSE);
+
+		pReport->frameRate = frameRate;
+		pReport->bytesPerSecond = frameRate*(float)frameSize;
+		pReport->largestFrame = frameSize;
+	}
+	else if (pConfig->contMode == SBG_TRIGGERED_MODE_ENABLE)
+	{
+		for (i = 0; i < SBG_BANDWIDTH_NUM_TRIGGERS; i++)
+		{
+			if (pConfig->triggerMasks[i] != SBG_TRIGGER_DISABLED)
+			{
+				frameRate = sbgBandwidthTriggerRate(pConfig, pConfig->triggerMasks[i], divider);
+				frameSize = sbgBandwidthFrameSize(pConfig->outputMode, pConfig->triggerOutputMasks[i], TRUE);
+
+				pReport->conditionBytesPerSecond[i] = frameRate*(float)frameSize;
+				pReport->frameRate += frameRate;
+				pReport->bytesPerSecond += pReport->conditionBytesPerSecond[i];
+
+				if (frameSize > pReport->largestFrame)
+				{
+					pReport->largestFrame = frameSize;
+				}
+			}
+		}
+	}
+
+	pReport->load = pReport->bytesPerSecond/pReport->lineBytesPerSecond;
+
+	return SBG_NO_ERROR;
+}
+
+//----------------------------------------------------------------------//
+//- Bandwidth operations                                               -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Fill a configuration with the IG-500N defaults: little endian float outputs, continuous mode with divider 1,
+ *	no outputs, 100 Hz main loop and magnetometers, 25 Hz barometer, 4 Hz GPS and 921600 bauds.
+ *	\param[out]	pConfig						Configuration to initialize.
+ */
+void sbgBandwidthInitConfig(SbgBandwidthConfig *pConfig)
+{
+	memset(pConfig, 0, sizeof(SbgBandwidthConfig));
+
+	pConfig->outputMode = SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT;
+	pConfig->contMode = SBG_CONTINUOUS_MODE_ENABLE;
+	pConfig->divider = 1;
+	pConfig->mainLoopRate = 100.0f;
+	pConfig->magRate = 100.0f;
+	pConfig->baroRate = 25.0f;
+	pConfig->gpsRate = 4.0f;
+	pConfig->baudRate = 921600;
+}
+
+/*!
+ *	Size on the line of an output frame.
+ *	\param[in]	outputMode					Output mode, endianness and float/fixed.
+ *	\param[in]	outputMask					Outputs contained in the frame.
+ *	\param[in]	triggered					TRUE for a triggered frame, that starts with the trigger and output masks.
+ *	\return									Frame size in bytes, framing included.
+ */
+uint16 sbgBandwidthFrameSize(uint8 outputMode, uint32 outputMask, bool triggered)
+{
+	uint16 size;
+
+	size = SBG_FRAME_OVERHEAD + sbgCalculateOutputBufferSize(outputMode, outputMask);
+
+	if (triggered)
+	{
+		size += SBG_TRIGGERED_FRAME_HEADER_SIZE;
+	}
+
+	return size;
+}
+
+/*!
+ *	Compute the line usage of a configuration.<br>
+ *	A triggered condition is counted at the sum of the rates of its triggers, at most one frame per main loop
+ *	iteration. Triggers without a configured rate (time pulse, events, odometers, true heading) count at the
+ *	main loop rate, the worst case. The command answers aren't included.
+ *	\param[in]	pConfig						Configuration to evaluate.
+ *	\param[out]	pReport						Line usage.
+ *	\return									SBG_NO_ERROR, SBG_INVALID_PARAMETER if the rates, divider or baud rate are invalid.
+ */
+SbgErrorCode sbgBandwidthCompute(const SbgBandwidthConfig *pConfig, SbgBandwidthReport *pReport)
+{
+	if (!pConfig)
+	{
+		return SBG_NULL_POINTER;
+	}
+
+	return sbgBandwidthEvaluate(pConfig, pConfig->divider, pConfig->baudRate, pReport);
+}
+
+/*!
+ *	Find the smallest main loop divider, thus the highest output rate, whose load stays under maxLoad.
+ *	\param[in]	pConfig						Configuration to evaluate, its divider is ignored.
+ *	\param[in]	maxLoad						Highest accepted load, SBG_BANDWIDTH_DEFAULT_MAX_LOAD for example.
+ *	\return									Divider between 1 and 255, 0 if no divider fits (the other triggers alone overrun the line).
+ */
+uint8 sbgBandwidthFindDivider(const SbgBandwidthConfig *pConfig, float maxLoad)
+{
+	SbgBandwidthReport report;
+	uint32 divider;
+
+	if (!pConfig)
+	{
+		return 0;
+	}
+
+	//
+	// The load only decreases with the divider
+	//
+	for (divider = 1; divider <= 255; divider++)
+	{
+		if ( (sbgBandwidthEvaluate(pConfig, (uint8)divider, pConfig->baudRate, &report) == SBG_NO_ERROR) && (report.load <= maxLoad) )
+		{
+			return (uint8)divider;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ *	Find the lowest standard baud rate, from 9600 to 921600, whose load stays under maxLoad.
+ *	\param[in]	pConfig						Configuration to evaluate, its baud rate is ignored.
+ *	\param[in]	maxLoad						Highest accepted load, SBG_BANDWIDTH_DEFAULT_MAX_LOAD for example.
+ *	\return									Baud rate, 0 if the outputs don't fit at 921600 bauds.
+ */
+uint32 sbgBandwidthFindBaudRate(const SbgBandwidthConfig *pConfig, float maxLoad)
+{
+	SbgBandwidthReport report;
+	uint32 i;
+
+	if (!pConfig)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < sizeof(gSbgBandwidthBaudRates)/sizeof(gSbgBandwidthBaudRates[0]); i++)
+	{
+		if ( (sbgBandwidthEvaluate(pConfig, pConfig->divider, gSbgBandwidthBaudRates[i], &report) == SBG_NO_ERROR) && (report.load <= maxLoad) )
+		{
+			return gSbgBandwidthBaudRates[i];
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*!
+ *	\file		protocolBandwidth.h
+ *
+ *	\brief		Serial bandwidth budget of the continuous and triggered outputs.<br>
+ *				Computes the bytes per second a device configuration puts on the line, framing included,
+ *				and finds the highest output rate or the lowest standard baud rate that fits a link.
+ */
+
+#ifndef __PROTOCOL_BANDWIDTH_H__
+#define __PROTOCOL_BANDWIDTH_H__
+
+#include "../sbgCommon.h"
+#include "commandsOutput.h"
+
+//----------------------------------------------------------------------//
+//- Bandwidth definitions                                              -//
+//----------------------------------------------------------------------//
+
+#define SBG_FRAME_OVERHEAD					(8)						/*!< SYNC, STX, CMD, SIZE, CRC and ETX bytes of every frame. */
+#define SBG_TRIGGERED_FRAME_HEADER_SIZE		(2*sizeof(uint32))		/*!< Trigger mask and output mask before the outputs of a triggered frame. */
+#define SBG_BANDWIDTH_NUM_TRIGGERS			(4)						/*!< Number of triggered output conditions. */
+#define SBG_BANDWIDTH_DEFAULT_MAX_LOAD		(0.9f)					/*!< Line load kept by default, leaves room for the command answers. */
+
+/*!
+ *	Output configuration of a device and rates of the events that fire the triggers.
+ */
+typedef struct _SbgBandwidthConfig
+{
+	uint8				outputMode;									/*!< Output mode, endianness and float/fixed. */
+	SbgContOutputTypes	contMode;									/*!< Continuous, triggered or question/answer mode. */
+	uint8				divider;									/*!< Main loop divider of the continuous output and of SBG_TRIGGER_MAIN_LOOP_DIVIDER. */
+	uint32				defaultOutputMask;							/*!< Output mask of the continuous frames. */
+	uint32				triggerMasks[SBG_BANDWIDTH_NUM_TRIGGERS];	/*!< Trigger mask of each condition, SBG_TRIGGER_DISABLED if unused. */
+	uint32				triggerOutputMasks[SBG_BANDWIDTH_NUM_TRIGGERS];	/*!< Output mask of each condition. */
+	float				mainLoopRate;								/*!< Device main loop frequency in Hz. */
+	float				magRate;									/*!< Rate of SBG_TRIGGER_MAGNETOMETERS in Hz. */
+	float				baroRate;									/*!< Rate of SBG_TRIGGER_BAROMETER in Hz. */
+	float				gpsRate;									/*!< Rate of each GPS trigger (position, velocity, course) in Hz. */
+	uint32				baudRate;									/*!< Baud rate of the link. */
+} SbgBandwidthConfig;
+
+/*!
+ *	Line usage of a configuration.
+ */
+typedef struct _SbgBandwidthReport
+{
+	float	frameRate;							/*!< Output frames sent per second. */
+	float	bytesPerSecond;						/*!< Bytes sent per second, framing included. */
+	float	lineBytesPerSecond;					/*!< Bytes per second the line carries at the baud rate. */
+	float	load;								/*!< bytesPerSecond / lineBytesPerSecond. */
+	uint16	largestFrame;						/*!< Size of the largest output frame, framing included. */
+	float	conditionBytesPerSecond[SBG_BANDWIDTH_NUM_TRIGGERS];	/*!< Share of each triggered condition. */
+} SbgBandwidthReport;
+
+//----------------------------------------------------------------------//
+//- Bandwidth operations                                               -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Fill a configuration with the IG-500N defaults: little endian float outputs, continuous mode with divider 1,
+ *	no outputs, 100 Hz main loop and magnetometers, 25 Hz barometer, 4 Hz GPS and 921600 bauds.
+ *	\param[out]	pConfig						Configuration to initialize.
+ */
+void sbgBandwidthInitConfig(SbgBandwidthConfig *pConfig);
+
+/*!
+ *	Size on the line of an output frame.
+ *	\param[in]	outputMode					Output mode, endianness and float/fixed.
+ *	\param[in]	outputMask					Outputs contained in the frame.
+ *	\param[in]	triggered					TRUE for a triggered frame, that starts with the trigger and output masks.
+ *	\return									Frame size in bytes, framing included.
+ */
+uint16 sbgBandwidthFrameSize(uint8 outputMode, uint32 outputMask, bool triggered);
+
+/*!
+ *	Compute the line usage of a configuration.<br>
+ *	A triggered condition is counted at the sum of the rates of its triggers, at most one frame per main loop
+ *	iteration. Triggers without a configured rate (time pulse, events, odometers, true heading) count at the
+ *	main loop rate, the worst case. The command answers aren't included.
+ *	\param[in]	pConfig						Configuration to evaluate.
+ *	\param[out]	pReport						Line usage.
+ *	\return									SBG_NO_ERROR, SBG_INVALID_PARAMETER if the rates, divider or baud rate are invalid.
+ */
+SbgErrorCode sbgBandwidthCompute(const SbgBandwidthConfig *pConfig, SbgBandwidthReport *pReport);
+
+/*!
+ *	Find the smallest main loop divider, thus the highest output rate, whose load stays under maxLoad.
+ *	\param[in]	pConfig						Configuration to evaluate, its divider is ignored.
+ *	\param[in]	maxLoad						Highest accepted load, SBG_BANDWIDTH_DEFAULT_MAX_LOAD for example.
+ *	\return									Divider between 1 and 255, 0 if no divider fits (the other triggers alone overrun the line).
+ */
+uint8 sbgBandwidthFindDivider(const SbgBandwidthConfig *pConfig, float maxLoad);
+
+/*!
+ *	Find the lowest standard baud rate, from 9600 to 921600, whose load stays under maxLoad.
+ *	\param[in]	pConfig						Configuration to evaluate, its baud rate is ignored.
+ *	\param[in]	maxLoad						Highest accepted load, SBG_BANDWIDTH_DEFAULT_MAX_LOAD for example.
+ *	\return									Baud rate, 0 if the outputs don't fit at 921600 bauds.
+ */
+uint32 sbgBandwidthFindBaudRate(const SbgBandwidthConfig *pConfig, float maxLoad);
+
+#endif
@@ -0,0 +1,67 @@
+/*!
+ *	\file		protocolCrc.h
+ *
+ *	\brief		CRC 16 engines used to validate protocol frames.<br>
+ *				The protocol CRC uses the reflected polynomial 0x8408, an initial value of 0 and no final xor.<br>
+ *				Several engines compute the exact same value: a bitwise reference, a byte table,<br>
+ *				a slicing by 8 tables and a carry-less multiply folding version for x86 CPUs with PCLMULQDQ.<br>
+ *				The fastest engine available on the running CPU is selected automatically.
+ */
+#ifndef __PROTOCOL_CRC_H__
+#define __PROTOCOL_CRC_H__
+
+#include "../sbgCommon.h"
+
+//----------------------------------------------------------------------//
+//- CRC engines definitions                                            -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	List of available CRC 16 engines.
+ */
+typedef enum _SbgCrcEngine
+{
+	SBG_CRC_ENGINE_BITWISE,					/*!< Reference implementation, one bit at a time. */
+	SBG_CRC_ENGINE_TABLE,					/*!< One 256 entries table lookup per byte. */
+	SBG_CRC_ENGINE_SLICING_8,				/*!< Eight table lookups for eight bytes at a time. */
+	SBG_CRC_ENGINE_PCLMUL					/*!< 64 bytes folded per iteration using carry-less multiplications (x86 only). */
+} SbgCrcEngine;
+
+//----------------------------------------------------------------------//
+//- CRC operations                                                     -//
+//----------------------------------------------------------------------//
+
+/*!
+ *	Continue a CRC 16 computation over a new chunk of data using the fastest available engine.
+ *	\param[in]	crc							CRC computed so far, 0 for the first chunk.
+ *	\param[in]	pBuffer						Chunk to add to the CRC.
+ *	\param[in]	bufferSize					Chunk size in bytes.
+ *	\return									Updated CRC 16.
+ */
+uint16 sbgCrcUpdate(uint16 crc, const void *pBuffer, uint32 bufferSize);
+
+/*!
+ *	Continue a CRC 16 computation using a specific engine.<br>
+ *	Mainly used to validate and benchmark the engines against each other.
+ *	\param[in]	engine						Engine to use, the slicing by 8 engine is used if it isn't available.
+ *	\param[in]	crc							CRC computed so far, 0 for the first chunk.
+ *	\param[in]	pBuffer						Chunk to add to the CRC.
+ *	\param[in]	bufferSize					Chunk size in bytes.
+ *	\return									Updated CRC 16.
+ */
+uint16 sbgCrcUpdateWithEngine(SbgCrcEngine engine, uint16 crc, const void *pBuffer, uint32 bufferSize);
+
+/*!
+ *	Check if a CRC engine can be used on the running CPU.
+ *	\param[in]	engine						Engine to check.
+ *	\return									TRUE if the engine is available.
+ */
+bool sbgCrcEngineIsAvailable(SbgCrcEngine engine);
+
+/*!
+ *	Returns the engine used by sbgCrcUpdate.
+ *	\return									The selected CRC engine.
+ */
+SbgCrcEngine sbgCrcGetEngine(void);
+
+#endif
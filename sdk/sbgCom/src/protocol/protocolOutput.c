@@ -1,6 +1,8 @@
 #include "protocolOutput.h"
 #include "protocolOutputMode.h"
+#include "commands.h"
 #include <string.h>
+#include <stddef.h>
 
 //----------------------------------------------------------------------//
 //- Opertaions                                                         -//
@@ -1194,7 +1196,7 @@ uint16 sbgCalculateOutputBufferSize(uint8 targetOutputMode, uint32 outputMask)
 
 	if (outputMask & SBG_OUTPUT_TEMPERATURES_RAW)
 	{
-		bufferSize += sizeof(uint16);
+		bufferSize += sizeof(uint16)*2;
 	}
 
 	if (outputMask & SBG_OUTPUT_TIME_SINCE_RESET)
@@ -1297,3 +1299,510 @@ uint16 sbgCalculateOutputBufferSize(uint8 targetOutputMode, uint32 outputMask)
 
 	return bufferSize;
 }
+
+//----------------------------------------------------------------------//
+//- Decode plans                                                       -//
+//----------------------------------------------------------------------//
+
+#define SBG_OUTPUT_DECODE_REAL32			(0xFE)			/*!< Descriptor only: float or fixed32 depending on the output mode. */
+#define SBG_OUTPUT_DECODE_REAL64			(0xFF)			/*!< Descriptor only: double or fixed64 depending on the output mode. */
+
+/*!
+ *	Describes where a part of an output is stored in the SbgOutput struct.
+ */
+typedef struct _SbgOutputFieldDesc
+{
+	uint32	mask;					/*!< Output mask bit the part belongs to */
+	uint16	dstOffset;				/*!< Offset of the part in the SbgOutput struct */
+	uint8	kind;					/*!< SbgOutputDecodeKind or one of the REAL descriptors */
+	uint8	count;					/*!< Number of elements */
+} SbgOutputFieldDesc;
+
+/*!
+ *	All output parts in the order they are stored in a frame.<br>
+ *	Must be kept in sync with sbgFillOutputFromBuffer.
+ */
+static const SbgOutputFieldDesc sbgOutputFields[] =
+{
+	{SBG_OUTPUT_QUATERNION,				offsetof(SbgOutput, stateQuat),					SBG_OUTPUT_DECODE_REAL32,	4},
+	{SBG_OUTPUT_EULER,					offsetof(SbgOutput, stateEuler),				SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_MATRIX,					offsetof(SbgOutput, stateMatrix),				SBG_OUTPUT_DECODE_REAL32,	9},
+	{SBG_OUTPUT_GYROSCOPES,				offsetof(SbgOutput, gyroscopes),				SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_ACCELEROMETERS,			offsetof(SbgOutput, accelerometers),			SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_MAGNETOMETERS,			offsetof(SbgOutput, magnetometers),				SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_TEMPERATURES,			offsetof(SbgOutput, temperatures),				SBG_OUTPUT_DECODE_REAL32,	2},
+	{SBG_OUTPUT_GYROSCOPES_RAW,			offsetof(SbgOutput, gyroscopesRaw),				SBG_OUTPUT_DECODE_WORD16,	3},
+	{SBG_OUTPUT_ACCELEROMETERS_RAW,		offsetof(SbgOutput, accelerometersRaw),			SBG_OUTPUT_DECODE_WORD16,	3},
+	{SBG_OUTPUT_MAGNETOMETERS_RAW,		offsetof(SbgOutput, magnetometersRaw),			SBG_OUTPUT_DECODE_WORD16,	3},
+	{SBG_OUTPUT_TEMPERATURES_RAW,		offsetof(SbgOutput, temperaturesRaw),			SBG_OUTPUT_DECODE_WORD16,	2},
+	{SBG_OUTPUT_TIME_SINCE_RESET,		offsetof(SbgOutput, timeSinceReset),			SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_DEVICE_STATUS,			offsetof(SbgOutput, deviceStatus),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_POSITION,			offsetof(SbgOutput, gpsLatitude),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_POSITION,			offsetof(SbgOutput, gpsLongitude),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_POSITION,			offsetof(SbgOutput, gpsAltitude),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_NAVIGATION,			offsetof(SbgOutput, gpsVelocity),				SBG_OUTPUT_DECODE_WORD32,	3},
+	{SBG_OUTPUT_GPS_NAVIGATION,			offsetof(SbgOutput, gpsHeading),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_ACCURACY,			offsetof(SbgOutput, gpsHorAccuracy),			SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_ACCURACY,			offsetof(SbgOutput, gpsVertAccuracy),			SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_ACCURACY,			offsetof(SbgOutput, gpsSpeedAccuracy),			SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_ACCURACY,			offsetof(SbgOutput, gpsHeadingAccuracy),		SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_INFO,				offsetof(SbgOutput, gpsTimeMs),					SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_INFO,				offsetof(SbgOutput, gpsFlags),					SBG_OUTPUT_DECODE_BYTES,	1},
+	{SBG_OUTPUT_GPS_INFO,				offsetof(SbgOutput, gpsNbSats),					SBG_OUTPUT_DECODE_BYTES,	1},
+	{SBG_OUTPUT_BARO_ALTITUDE,			offsetof(SbgOutput, baroAltitude),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_BARO_PRESSURE,			offsetof(SbgOutput, baroPressure),				SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_POSITION,				offsetof(SbgOutput, position),					SBG_OUTPUT_DECODE_REAL64,	3},
+	{SBG_OUTPUT_VELOCITY,				offsetof(SbgOutput, velocity),					SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_ATTITUDE_ACCURACY,		offsetof(SbgOutput, attitudeAccuracy),			SBG_OUTPUT_DECODE_REAL32,	1},
+	{SBG_OUTPUT_NAV_ACCURACY,			offsetof(SbgOutput, positionAccuracy),			SBG_OUTPUT_DECODE_REAL32,	1},
+	{SBG_OUTPUT_NAV_ACCURACY,			offsetof(SbgOutput, velocityAccuracy),			SBG_OUTPUT_DECODE_REAL32,	1},
+	{SBG_OUTPUT_GYRO_TEMPERATURES,		offsetof(SbgOutput, gyroTemperatures),			SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_GYRO_TEMPERATURES_RAW,	offsetof(SbgOutput, gyroTemperaturesRaw),		SBG_OUTPUT_DECODE_WORD16,	3},
+	{SBG_OUTPUT_UTC_TIME_REFERENCE,		offsetof(SbgOutput, utcYear),					SBG_OUTPUT_DECODE_BYTES,	6},
+	{SBG_OUTPUT_UTC_TIME_REFERENCE,		offsetof(SbgOutput, utcNano),					SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_MAG_CALIB_DATA,			offsetof(SbgOutput, magCalibData),				SBG_OUTPUT_DECODE_BYTES,	12},
+	{SBG_OUTPUT_GPS_TRUE_HEADING,		offsetof(SbgOutput, gpsTrueHeading),			SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_GPS_TRUE_HEADING,		offsetof(SbgOutput, gpsTrueHeadingAccuracy),	SBG_OUTPUT_DECODE_WORD32,	1},
+	{SBG_OUTPUT_ODO_VELOCITIES,			offsetof(SbgOutput, odoRawVelocity),			SBG_OUTPUT_DECODE_REAL32,	2},
+	{SBG_OUTPUT_DELTA_ANGLES,			offsetof(SbgOutput, deltaAngles),				SBG_OUTPUT_DECODE_REAL32,	3},
+	{SBG_OUTPUT_HEAVE,					offsetof(SbgOutput, heave),						SBG_OUTPUT_DECODE_REAL32,	1}
+};
+
+/*!
+ *	Returns the size in bytes of one element of a decode kind.
+ *	\param[in]	kind					One of SbgOutputDecodeKind.
+ *	\return								Element size in bytes.
+ */
+static uint16 sbgOutputDecodeKindSize(uint8 kind)
+{
+	switch (kind)
+	{
+	case SBG_OUTPUT_DECODE_WORD16:
+		return sizeof(uint16);
+	case SBG_OUTPUT_DECODE_WORD32:
+	case SBG_OUTPUT_DECODE_FIXED32:
+		return sizeof(uint32);
+	case SBG_OUTPUT_DECODE_WORD64:
+	case SBG_OUTPUT_DECODE_FIXED64:
+		return sizeof(uint64);
+	default:
+		return sizeof(uint8);
+	}
+}
+
+//
+// Byte swap used by the decode plans, the compiler builtins let the copy loops below be vectorized
+//
+#if defined(__GNUC__)
+	#define SBG_OUTPUT_BSWAP16(x)	__builtin_bswap16(x)
+	#define SBG_OUTPUT_BSWAP32(x)	__builtin_bswap32(x)
+	#define SBG_OUTPUT_BSWAP64(x)	__builtin_bswap64(x)
+#else
+	#define SBG_OUTPUT_BSWAP16(x)	swap16(x)
+	#define SBG_OUTPUT_BSWAP32(x)	swap32(x)
+	#define SBG_OUTPUT_BSWAP64(x)	swap64(x)
+#endif
+
+/*!
+ *	Copy an array of 16 bits words, swapping each of them.<br>
+ *	The raw buffer has no alignment guarantee so values are read and written with memcpy.
+ *	\param[out]	pDst					Destination array.
+ *	\param[in]	pSrc					Source array.
+ *	\param[in]	count					Number of words to copy.
+ */
+static void sbgOutputSwapCopy16(uint8 *pDst, const uint8 *pSrc, uint32 count)
+{
+	uint16 value;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(uint16), sizeof(uint16));
+		value = SBG_OUTPUT_BSWAP16(value);
+		memcpy(pDst + i*sizeof(uint16), &value, sizeof(uint16));
+	}
+}
+
+/*!
+ *	Copy an array of 32 bits words, swapping each of them.
+ *	\param[out]	pDst					Destination array.
+ *	\param[in]	pSrc					Source array.
+ *	\param[in]	count					Number of words to copy.
+ */
+static void sbgOutputSwapCopy32(uint8 *pDst, const uint8 *pSrc, uint32 count)
+{
+	uint32 value;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(uint32), sizeof(uint32));
+		value = SBG_OUTPUT_BSWAP32(value);
+		memcpy(pDst + i*sizeof(uint32), &value, sizeof(uint32));
+	}
+}
+
+/*!
+ *	Copy an array of 64 bits words, swapping each of them.
+ *	\param[out]	pDst					Destination array.
+ *	\param[in]	pSrc					Source array.
+ *	\param[in]	count					Number of words to copy.
+ */
+static void sbgOutputSwapCopy64(uint8 *pDst, const uint8 *pSrc, uint32 count)
+{
+	uint64 value;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(uint64), sizeof(uint64));
+		value = SBG_OUTPUT_BSWAP64(value);
+		memcpy(pDst + i*sizeof(uint64), &value, sizeof(uint64));
+	}
+}
+
+/*!
+ *	Convert an array of fixed32 values into floats.<br>
+ *	Same conversion as sbgTargetToHostFloat but with the endianness test hoisted out of the loop.
+ *	\param[out]	pDst					Destination float array.
+ *	\param[in]	pSrc					Source fixed32 array.
+ *	\param[in]	count					Number of values to convert.
+ *	\param[in]	swap					TRUE if the values have to be swapped first.
+ */
+static void sbgOutputFixedToFloat(uint8 *pDst, const uint8 *pSrc, uint32 count, bool swap)
+{
+	uint32 value;
+	float result;
+	uint32 i;
+
+	if (swap)
+	{
+		for (i=0; i<count; i++)
+		{
+			memcpy(&value, pSrc + i*sizeof(uint32), sizeof(uint32));
+			result = ((float)(int32)SBG_OUTPUT_BSWAP32(value))/1048576.0f;
+			memcpy(pDst + i*sizeof(float), &result, sizeof(float));
+		}
+	}
+	else
+	{
+		for (i=0; i<count; i++)
+		{
+			memcpy(&value, pSrc + i*sizeof(uint32), sizeof(uint32));
+			result = ((float)(int32)value)/1048576.0f;
+			memcpy(pDst + i*sizeof(float), &result, sizeof(float));
+		}
+	}
+}
+
+/*!
+ *	Convert an array of fixed64 values into doubles.
+ *	\param[out]	pDst					Destination double array.
+ *	\param[in]	pSrc					Source fixed64 array.
+ *	\param[in]	count					Number of values to convert.
+ *	\param[in]	swap					TRUE if the values have to be swapped first.
+ */
+static void sbgOutputFixedToDouble(uint8 *pDst, const uint8 *pSrc, uint32 count, bool swap)
+{
+	uint64 value;
+	double result;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(uint64), sizeof(uint64));
+		value = swap?SBG_OUTPUT_BSWAP64(value):value;
+		result = ((double)(int64)value)/4294967296.0;
+		memcpy(pDst + i*sizeof(double), &result, sizeof(double));
+	}
+}
+
+/*!
+ *	Convert an array of floats into fixed32 values.
+ *	\param[out]	pDst					Destination fixed32 array.
+ *	\param[in]	pSrc					Source float array.
+ *	\param[in]	count					Number of values to convert.
+ *	\param[in]	swap					TRUE if the values have to be swapped after the conversion.
+ */
+static void sbgOutputFloatToFixed(uint8 *pDst, const uint8 *pSrc, uint32 count, bool swap)
+{
+	float value;
+	uint32 result;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(float), sizeof(float));
+		result = (uint32)(int32)(value*1048576.0f);
+		result = swap?SBG_OUTPUT_BSWAP32(result):result;
+		memcpy(pDst + i*sizeof(uint32), &result, sizeof(uint32));
+	}
+}
+
+/*!
+ *	Convert an array of doubles into fixed64 values.
+ *	\param[out]	pDst					Destination fixed64 array.
+ *	\param[in]	pSrc					Source double array.
+ *	\param[in]	count					Number of values to convert.
+ *	\param[in]	swap					TRUE if the values have to be swapped after the conversion.
+ */
+static void sbgOutputDoubleToFixed(uint8 *pDst, const uint8 *pSrc, uint32 count, bool swap)
+{
+	double value;
+	uint64 result;
+	uint32 i;
+
+	for (i=0; i<count; i++)
+	{
+		memcpy(&value, pSrc + i*sizeof(double), sizeof(double));
+		result = (uint64)(int64)(value*4294967296.0);
+		result = swap?SBG_OUTPUT_BSWAP64(result):result;
+		memcpy(pDst + i*sizeof(uint64), &result, sizeof(uint64));
+	}
+}
+
+/*!
+ *	Build the decode plan for a given output mode and output mask.<br>
+ *	Should be called once each time the output mode or mask changes, not for each frame.
+ *	\param[in]	targetOutputMode		The output mode used by the target.
+ *	\param[in]	outputMask				Mask combinaison that defines which outputs are contained in the buffers.
+ *	\param[out]	pPlan					Pointer to the plan to build.
+ *	\return								SBG_NO_ERROR if the plan has been built.
+ */
+SbgErrorCode sbgBuildOutputDecodePlan(uint8 targetOutputMode, uint32 outputMask, SbgOutputDecodePlan *pPlan)
+{
+	SbgOutputDecodeStep *pLastStep = NULL;
+	uint16 srcOffset = 0;
+	uint16 elementSize;
+	uint16 count;
+	uint8 kind;
+	uint32 i;
+
+	if (pPlan)
+	{
+		pPlan->valid = FALSE;
+		pPlan->targetOutputMode = targetOutputMode;
+		pPlan->outputMask = 0;
+		pPlan->numSteps = 0;
+
+		//
+		// Resolve the endianness conversion once for the whole plan
+		//
+#if defined SBG_PLATFORM_BIG_ENDIAN
+		pPlan->swap = (targetOutputMode&SBG_OUTPUT_MODE_LITTLE_ENDIAN)?TRUE:FALSE;
+#elif defined SBG_PLATFORM_LITTLE_ENDIAN
+		pPlan->swap = (targetOutputMode&SBG_OUTPUT_MODE_LITTLE_ENDIAN)?FALSE:TRUE;
+#else
+	#error	sbgBuildOutputDecodePlan: You have to define your platform endianness!
+#endif
+
+		for (i=0; i<sizeof(sbgOutputFields)/sizeof(sbgOutputFields[0]); i++)
+		{
+			if (outputMask & sbgOutputFields[i].mask)
+			{
+				//
+				// Resolve float or fixed point real values according to the output mode
+				//
+				kind = sbgOutputFields[i].kind;
+
+				if (kind == SBG_OUTPUT_DECODE_REAL32)
+				{
+					kind = (targetOutputMode&SBG_OUTPUT_MODE_FIXED)?SBG_OUTPUT_DECODE_FIXED32:SBG_OUTPUT_DECODE_WORD32;
+				}
+				else if (kind == SBG_OUTPUT_DECODE_REAL64)
+				{
+					kind = (targetOutputMode&SBG_OUTPUT_MODE_FIXED)?SBG_OUTPUT_DECODE_FIXED64:SBG_OUTPUT_DECODE_WORD64;
+				}
+
+				elementSize = sbgOutputDecodeKindSize(kind);
+				count = sbgOutputFields[i].count;
+
+				//
+				// Without any swap, integers and floats are already in host format: copy them as raw bytes
+				// so that consecutive parts of any type collapse into a single memcpy
+				//
+				if ( (!pPlan->swap) && (kind != SBG_OUTPUT_DECODE_FIXED32) && (kind != SBG_OUTPUT_DECODE_FIXED64) )
+				{
+					count = count*elementSize;
+					elementSize = sizeof(uint8);
+					kind = SBG_OUTPUT_DECODE_BYTES;
+				}
+
+				//
+				// Extend the previous step if this part directly follows it both in the buffer and in SbgOutput
+				//
+				if ( (pLastStep) && (pLastStep->kind == kind) &&
+					 (pLastStep->srcOffset + pLastStep->count*elementSize == srcOffset) &&
+					 (pLastStep->dstOffset + pLastStep->count*elementSize == sbgOutputFields[i].dstOffset) )
+				{
+					pLastStep->count += count;
+				}
+				else if (pPlan->numSteps < SBG_OUTPUT_DECODE_PLAN_MAX_STEPS)
+				{
+					pLastStep = &pPlan->steps[pPlan->numSteps++];
+					pLastStep->srcOffset = srcOffset;
+					pLastStep->dstOffset = sbgOutputFields[i].dstOffset;
+					pLastStep->kind = kind;
+					pLastStep->count = count;
+				}
+				else
+				{
+					return SBG_BUFFER_OVERFLOW;
+				}
+
+				srcOffset += count*elementSize;
+				pPlan->outputMask |= sbgOutputFields[i].mask;
+			}
+		}
+
+		//
+		// The plan and the size helper should always agree
+		//
+		pPlan->bufferSize = sbgCalculateOutputBufferSize(targetOutputMode, outputMask);
+
+		if (pPlan->bufferSize != srcOffset)
+		{
+			return SBG_ERROR;
+		}
+
+		pPlan->valid = TRUE;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Fill the SbgOutput struct from a raw buffer using a prebuilt decode plan.
+ *	\param[in]	pPlan					Plan built by sbgBuildOutputDecodePlan.
+ *	\param[in]	pBuffer					Raw buffer that contains the data to extract into SbgOutput.
+ *	\param[in]	bufferSize				The size of the pBuffer.
+ *	\param[out]	pOutput					Pointer to a SbgOutut struct used to hold extracted data.
+ *	\return								SBG_NO_ERROR if we have sucessfully extracted data from pBuffer and filled the pOutput struct.
+ */
+SbgErrorCode sbgExecuteOutputDecodePlan(const SbgOutputDecodePlan *pPlan, const void *pBuffer, uint16 bufferSize, SbgOutput *pOutput)
+{
+	const SbgOutputDecodeStep *pStep;
+	const SbgOutputDecodeStep *pLastStep;
+	const uint8 *pSrc;
+	uint8 *pDst;
+
+	if ( (pPlan) && (pPlan->valid) && (pBuffer) && (pOutput) )
+	{
+		//
+		// Single size check for the whole frame, let the generic decoder extract what it can from a truncated one
+		//
+		if (bufferSize < pPlan->bufferSize)
+		{
+			return sbgFillOutputFromBuffer(pPlan->targetOutputMode, pPlan->outputMask, (void*)pBuffer, bufferSize, pOutput);
+		}
+
+		pLastStep = pPlan->steps + pPlan->numSteps;
+
+		for (pStep = pPlan->steps; pStep < pLastStep; pStep++)
+		{
+			pSrc = (const uint8*)pBuffer + pStep->srcOffset;
+			pDst = (uint8*)pOutput + pStep->dstOffset;
+
+			//
+			// Word steps only exist when a swap is needed, plans built for a native endian target
+			// are made of byte copies and fixed point conversions
+			//
+			switch (pStep->kind)
+			{
+			case SBG_OUTPUT_DECODE_WORD16:
+				sbgOutputSwapCopy16(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_WORD32:
+				sbgOutputSwapCopy32(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_WORD64:
+				sbgOutputSwapCopy64(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_FIXED32:
+				sbgOutputFixedToFloat(pDst, pSrc, pStep->count, pPlan->swap);
+				break;
+			case SBG_OUTPUT_DECODE_FIXED64:
+				sbgOutputFixedToDouble(pDst, pSrc, pStep->count, pPlan->swap);
+				break;
+			default:
+				memcpy(pDst, pSrc, pStep->count);
+				break;
+			}
+		}
+
+		pOutput->outputMask = pPlan->outputMask;
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
+
+/*!
+ *	Write the fields of a SbgOutput struct into a raw buffer using a prebuilt decode plan.
+ *	\param[in]	pPlan					Plan built by sbgBuildOutputDecodePlan.
+ *	\param[in]	pOutput					Pointer to the SbgOutput struct holding the data to write.
+ *	\param[out]	pBuffer					Raw buffer, in the target output mode.
+ *	\param[in]	bufferSize				The size of the pBuffer, at least pPlan->bufferSize.
+ *	\return								SBG_NO_ERROR if the buffer has been filled.
+ */
+SbgErrorCode sbgExecuteOutputEncodePlan(const SbgOutputDecodePlan *pPlan, const SbgOutput *pOutput, void *pBuffer, uint16 bufferSize)
+{
+	const SbgOutputDecodeStep *pStep;
+	const SbgOutputDecodeStep *pLastStep;
+	const uint8 *pSrc;
+	uint8 *pDst;
+
+	if ( (pPlan) && (pPlan->valid) && (pBuffer) && (pOutput) )
+	{
+		if (bufferSize < pPlan->bufferSize)
+		{
+			return SBG_BUFFER_OVERFLOW;
+		}
+
+		pLastStep = pPlan->steps + pPlan->numSteps;
+
+		//
+		// Same steps as the decoder with source and destination exchanged, swaps are their own inverse
+		//
+		for (pStep = pPlan->steps; pStep < pLastStep; pStep++)
+		{
+			pSrc = (const uint8*)pOutput + pStep->dstOffset;
+			pDst = (uint8*)pBuffer + pStep->srcOffset;
+
+			switch (pStep->kind)
+			{
+			case SBG_OUTPUT_DECODE_WORD16:
+				sbgOutputSwapCopy16(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_WORD32:
+				sbgOutputSwapCopy32(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_WORD64:
+				sbgOutputSwapCopy64(pDst, pSrc, pStep->count);
+				break;
+			case SBG_OUTPUT_DECODE_FIXED32:
+				sbgOutputFloatToFixed(pDst, pSrc, pStep->count, pPlan->swap);
+				break;
+			case SBG_OUTPUT_DECODE_FIXED64:
+				sbgOutputDoubleToFixed(pDst, pSrc, pStep->count, pPlan->swap);
+				break;
+			default:
+				memcpy(pDst, pSrc, pStep->count);
+				break;
+			}
+		}
+
+		return SBG_NO_ERROR;
+	}
+	else
+	{
+		return SBG_NULL_POINTER;
+	}
+}
@@ -225,6 +225,53 @@ typedef struct _SbgOutput
 	float	heave;					/*!< Heave output in meters */
 } SbgOutput;
 
+//----------------------------------------------------------------------//
+//- Decode plan definitions                                            -//
+//----------------------------------------------------------------------//
+
+#define SBG_OUTPUT_DECODE_PLAN_MAX_STEPS		(40)					/*!< Maximum number of steps in a decode plan, enough for all outputs. */
+
+/*!
+ *	Kind of conversion applied by a decode step.<br>
+ *	Float or fixed point real values are resolved according to the output mode when the plan is built.<br>
+ *	When the target already uses the host endianness, integer and float parts become plain byte copies.
+ */
+typedef enum _SbgOutputDecodeKind
+{
+	SBG_OUTPUT_DECODE_BYTES,										/*!< Raw bytes copied as is. */
+	SBG_OUTPUT_DECODE_WORD16,										/*!< 16 bits integers. */
+	SBG_OUTPUT_DECODE_WORD32,										/*!< 32 bits integers or floats. */
+	SBG_OUTPUT_DECODE_WORD64,										/*!< 64 bits doubles. */
+	SBG_OUTPUT_DECODE_FIXED32,										/*!< fixed32 values converted to float. */
+	SBG_OUTPUT_DECODE_FIXED64										/*!< fixed64 values converted to double. */
+} SbgOutputDecodeKind;
+
+/*!
+ *	One step of a decode plan: a run of elements of the same kind, contiguous in both the buffer and SbgOutput.
+ */
+typedef struct _SbgOutputDecodeStep
+{
+	uint16	srcOffset;				/*!< Offset of the first element in the raw buffer */
+	uint16	dstOffset;				/*!< Offset of the first element in the SbgOutput struct */
+	uint16	kind;					/*!< One of SbgOutputDecodeKind */
+	uint16	count;					/*!< Number of elements to convert, in bytes for SBG_OUTPUT_DECODE_BYTES */
+} SbgOutputDecodeStep;
+
+/*!
+ *	Flat decode table built once for an output mode and an output mask.<br>
+ *	Executing a plan only costs the enabled fields, the mask is never tested again.
+ */
+typedef struct _SbgOutputDecodePlan
+{
+	bool	valid;					/*!< TRUE once the plan has been built */
+	uint8	targetOutputMode;		/*!< Output mode the plan has been built for */
+	uint32	outputMask;				/*!< Output mask the plan has been built for */
+	bool	swap;					/*!< TRUE if the target and host endianness differ */
+	uint16	bufferSize;				/*!< Size of the raw buffer expected by the plan */
+	uint16	numSteps;				/*!< Number of used steps */
+	SbgOutputDecodeStep steps[SBG_OUTPUT_DECODE_PLAN_MAX_STEPS];	/*!< Steps executed in order */
+} SbgOutputDecodePlan;
+
 //----------------------------------------------------------------------//
 //- Operations                                                         -//
 //----------------------------------------------------------------------//
@@ -252,5 +299,38 @@ SbgErrorCode sbgFillOutputFromBuffer(uint8 targetOutputMode, uint32 outputMask,
  */
 uint16 sbgCalculateOutputBufferSize(uint8 targetOutputMode, uint32 outputMask);
 
+/*!
+ *	Build the decode plan for a given output mode and output mask.<br>
+ *	Should be called once each time the output mode or mask changes, not for each frame.
+ *	\param[in]	targetOutputMode		The output mode used by the target.
+ *	\param[in]	outputMask				Mask combinaison that defines which outputs are contained in the buffers.
+ *	\param[out]	pPlan					Pointer to the plan to build.
+ *	\return								SBG_NO_ERROR if the plan has been built.
+ */
+SbgErrorCode sbgBuildOutputDecodePlan(uint8 targetOutputMode, uint32 outputMask, SbgOutputDecodePlan *pPlan);
+
+/*!
+ *	Fill the SbgOutput struct from a raw buffer using a prebuilt decode plan.<br>
+ *	The buffer size is checked once against the plan. A too short buffer is handed to sbgFillOutputFromBuffer<br>
+ *	so the fields it contains are still extracted and SBG_BUFFER_OVERFLOW is returned.
+ *	\param[in]	pPlan					Plan built by sbgBuildOutputDecodePlan.
+ *	\param[in]	pBuffer					Raw buffer that contains the data to extract into SbgOutput.
+ *	\param[in]	bufferSize				The size of the pBuffer.
+ *	\param[out]	pOutput					Pointer to a SbgOutut struct used to hold extracted data.
+ *	\return								SBG_NO_ERROR if we have sucessfully extracted data from pBuffer and filled the pOutput struct.
+ */
+SbgErrorCode sbgExecuteOutputDecodePlan(const SbgOutputDecodePlan *pPlan, const void *pBuffer, uint16 bufferSize, SbgOutput *pOutput);
+
+/*!
+ *	Write the fields of a SbgOutput struct into a raw buffer, the way the device does, using a prebuilt decode plan.<br>
+ *	Inverse of sbgExecuteOutputDecodePlan, used to emulate a device.
+ *	\param[in]	pPlan					Plan built by sbgBuildOutputDecodePlan.
+ *	\param[in]	pOutput					Pointer to the SbgOutput struct holding the data to write.
+ *	\param[out]	pBuffer					Raw buffer, in the target output mode.
+ *	\param[in]	bufferSize				The size of the pBuffer, at least pPlan->bufferSize.
+ *	\return								SBG_NO_ERROR if the buffer has been filled.
+ */
+SbgErrorCode sbgExecuteOutputEncodePlan(const SbgOutputDecodePlan *pPlan, const SbgOutput *pOutput, void *pBuffer, uint16 bufferSize);
+
 #endif	// __PROTOCOL_OUTPUT_H__
 
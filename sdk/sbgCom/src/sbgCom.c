@@ -10,6 +10,8 @@
 /*!
  *	Initialize the sbgCom library.<br>
  *	Open the COM port and try to get the default output mask and output mode from the device.<br>
+ *	On little endian hosts, the device is then switched to little endian float output so that outputs<br>
+ *	can be decoded with plain memory copies. This setting is not saved in the device flash memory.<br>
  *	\param[in]	deviceName						Communication port to open ("COM1" on Windows, "/dev/ttysX" on UNIX platforms).
  *	\param[in]	baudRate						Baud rate used to communicate with the device.<br>
  *												Possible values are:<br>
@@ -55,6 +57,28 @@ SbgErrorCode sbgComInit(const char *deviceName, uint32 baudRate, SbgProtocolHand
 			sbgProtocolFlush(*pHandle);
 		}
 
+#if defined SBG_PLATFORM_LITTLE_ENDIAN
+		//
+		// Ask the device to output data in the host format, if it refuses keep its current output mode
+		//
+		if ( (errorCode == SBG_NO_ERROR) && ((*pHandle)->targetOutputMode != (SBG_OUTPUT_MODE_LITTLE_ENDIAN|SBG_OUTPUT_MODE_FLOAT)) )
+		{
+			for (i=0; i<5; i++)
+			{
+				if (sbgSetOutputMode(*pHandle, SBG_OUTPUT_MODE_LITTLE_ENDIAN|SBG_OUTPUT_MODE_FLOAT) == SBG_NO_ERROR)
+				{
+					break;
+				}
+
+				//
+				// Wait 100 ms before retrying
+				//
+				sbgSleep(100);
+				sbgProtocolFlush(*pHandle);
+			}
+		}
+#endif
+
 		//
 		// Check if we were able to get output mode
 		//
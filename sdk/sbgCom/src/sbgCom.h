@@ -25,6 +25,8 @@ extern "C" {
 #include "protocol/protocol.h"
 #include "protocol/protocolOutputMode.h"
 #include "protocol/protocolOutput.h"
+#include "protocol/protocolBandwidth.h"
+#include "protocol/protocolCrc.h"
 #include "protocol/commands.h"
 #include "protocol/commandsCalib.h"
 #include "protocol/commandsFilter.h"
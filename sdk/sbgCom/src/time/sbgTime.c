@@ -16,6 +16,22 @@ uint32 sbgGetTime(void)
 	return GetTickCount();
 }
 
+/*!
+ *	Returns the current time in ns from a monotonic clock.
+ *	\return				The current time in ns.
+ */
+uint64 sbgGetTimeNs(void)
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+
+	return (uint64)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+		   (uint64)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64)frequency.QuadPart;
+}
+
 /*!
  *	Sleep for the specified number of ms.
  *	\param[in]	ms		Number of millisecondes to wait.
@@ -25,6 +41,20 @@ void sbgSleep(uint32 ms)
 	Sleep(ms);
 }
 
+/*!
+ *	Sleep until the sbgGetTimeNs monotonic clock reaches a deadline.
+ *	\param[in]	deadlineNs	Absolute monotonic time in ns.
+ */
+void sbgSleepUntilNs(uint64 deadlineNs)
+{
+	uint64 currentTime = sbgGetTimeNs();
+
+	if (deadlineNs > currentTime)
+	{
+		Sleep((DWORD)((deadlineNs - currentTime + 999999ull) / 1000000ull));
+	}
+}
+
 #else
 
 #ifdef __APPLE__
@@ -32,6 +62,7 @@ void sbgSleep(uint32 ms)
 #include <unistd.h>
 #else
 #include <time.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/time.h>
 #endif
@@ -46,13 +77,29 @@ void sbgSleep(uint32 ms)
  */
 uint32 sbgGetTime(void)
 {
-	clock_t clk;
+	//
+	// Use the monotonic clock so a wall clock jump can't break time outs
+	//
+	return (uint32)(sbgGetTimeNs() / 1000000ull);
+}
+
+/*!
+ *	Returns the current time in ns from a monotonic clock.
+ *	\return				The current time in ns.
+ */
+uint64 sbgGetTimeNs(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000ull + (uint64)ts.tv_nsec;
+#else
 	struct timeval tv;
-	struct timezone tz;
 	
-	gettimeofday(&tv, &tz);
-	clk = tv.tv_sec * 1000 + (tv.tv_usec / 1000);
-	return clk;
+	gettimeofday(&tv, NULL);
+	return (uint64)tv.tv_sec * 1000000000ull + (uint64)tv.tv_usec * 1000ull;
+#endif
 }
 
 /*!
@@ -63,4 +110,32 @@ void sbgSleep(uint32 ms)
 {
 	usleep(ms*1000);
 }
+
+/*!
+ *	Sleep until the sbgGetTimeNs monotonic clock reaches a deadline.
+ *	\param[in]	deadlineNs	Absolute monotonic time in ns.
+ */
+void sbgSleepUntilNs(uint64 deadlineNs)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadlineNs / 1000000000ull);
+	ts.tv_nsec = (long)(deadlineNs % 1000000000ull);
+
+	//
+	// Resume the sleep if a signal interrupts it, the deadline doesn't move
+	//
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+#else
+	uint64 currentTime = sbgGetTimeNs();
+
+	if (deadlineNs > currentTime)
+	{
+		usleep((useconds_t)((deadlineNs - currentTime) / 1000ull));
+	}
+#endif
+}
 #endif
@@ -16,15 +16,30 @@
 //----------------------------------------------------------------------//
 
 /*!
- *	Returns the current time in ms.
+ *	Returns the current time in ms.<br>
+ *	The time comes from a monotonic clock and wraps every 49 days, only compare differences.
  *	\return				The current time in ms.
  */
 uint32 sbgGetTime(void);
 
+/*!
+ *	Returns the current time in ns from a monotonic clock.<br>
+ *	Not affected by wall clock adjustments, used to compute time out deadlines.
+ *	\return				The current time in ns.
+ */
+uint64 sbgGetTimeNs(void);
+
 /*!
  *	Sleep for the specified number of ms.
  *	\param[in]	ms		Number of millisecondes to wait.
  */
 void sbgSleep(uint32 ms);
 
+/*!
+ *	Sleep until the sbgGetTimeNs monotonic clock reaches a deadline.<br>
+ *	Absolute deadlines don't accumulate the wake up latency of successive sleeps.
+ *	\param[in]	deadlineNs	Absolute monotonic time in ns.
+ */
+void sbgSleepUntilNs(uint64 deadlineNs);
+
 #endif
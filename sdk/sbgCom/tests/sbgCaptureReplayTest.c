@@ -0,0 +1,246 @@
+/*!
+ *	\file		sbgCaptureReplayTest.c
+ *
+ *	\brief		Records the stream of the emulator while the default output mask changes, then replays
+ *				the capture and checks every continuous frame is decoded with the mask it has been sent with.<br>
+ *				Usage: sbgCaptureReplayTest <path to sbgEmulator>
+ */
+
+#include "../src/sbgCom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+//------------------------------------------------------------------------------//
+//- Test definitions                                                           -//
+//------------------------------------------------------------------------------//
+
+#define SBG_TEST_BAUD_RATE					(921600)
+#define SBG_TEST_MASK_BEFORE				(SBG_OUTPUT_QUATERNION | SBG_OUTPUT_TIME_SINCE_RESET)
+#define SBG_TEST_MASK_AFTER					(SBG_OUTPUT_QUATERNION | SBG_OUTPUT_GYROSCOPES | SBG_OUTPUT_ACCELEROMETERS | SBG_OUTPUT_TIME_SINCE_RESET)
+#define SBG_TEST_PHASE_NS					(500000000ull)			/*!< Time spent streaming with each mask. */
+
+/*!
+ *	Continuous frames seen by the raw callback.
+ */
+typedef struct _SbgTestCounts
+{
+	uint32	framesBefore;					/*!< Frames decoded with SBG_TEST_MASK_BEFORE. */
+	uint32	framesAfter;					/*!< Frames decoded with SBG_TEST_MASK_AFTER. */
+	uint32	mismatches;						/*!< Frames whose size doesn't match the mask they are decoded with. */
+} SbgTestCounts;
+
+//------------------------------------------------------------------------------//
+//- Test helpers                                                               -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Counts a continuous frame, a frame of the wrong size has been decoded with the wrong mask.
+ *	\param[in]	pHandler	Protocol handle, targetOutputMode gives the output mode.
+ *	\param[in]	outputMask	Mask the frame is decoded with.
+ *	\param[in]	pBuffer		Frame data field.
+ *	\param[in]	size		Size of the data field.
+ *	\param[in]	pUsrArg		Our SbgTestCounts.
+ *	\return					TRUE, the frame doesn't need to be decoded.
+ */
+static bool sbgTestCountFrame(SbgProtocolHandleInt *pHandler, uint32 outputMask, const uint8 *pBuffer, uint16 size, void *pUsrArg)
+{
+	SbgTestCounts *pCounts = (SbgTestCounts*)pUsrArg;
+
+	// Avoid warnings
+	(void)pBuffer;
+
+	if (size != sbgCalculateOutputBufferSize(pHandler->targetOutputMode, outputMask))
+	{
+		pCounts->mismatches++;
+	}
+	else if (outputMask == SBG_TEST_MASK_BEFORE)
+	{
+		pCounts->framesBefore++;
+	}
+	else if (outputMask == SBG_TEST_MASK_AFTER)
+	{
+		pCounts->framesAfter++;
+	}
+
+	return TRUE;
+}
+
+/*!
+ *	Handles the continuous frames for a while.
+ *	\param[in]	handle		A valid sbgCom library handle.
+ *	\param[in]	durationNs	Time to spend.
+ */
+static void sbgTestStream(SbgProtocolHandle handle, uint64 durationNs)
+{
+	uint64 stopTime = sbgGetTimeNs() + durationNs;
+
+	while (sbgGetTimeNs() < stopTime)
+	{
+		sbgProtocolContinuousModeHandle(handle);
+		sbgProtocolWaitData(handle, 10);
+	}
+}
+
+/*!
+ *	Starts the emulator on a pseudo terminal linked to pLink.
+ *	\param[in]	pEmulator	Path to sbgEmulator.
+ *	\param[in]	pLink		Link to the slave side of the pseudo terminal.
+ *	\return					Emulator process, -1 if it couldn't be started.
+ */
+static pid_t sbgTestStartEmulator(const char *pEmulator, const char *pLink)
+{
+	char port[256];
+	pid_t emulatorId;
+	uint32 i;
+
+	snprintf(port, sizeof(port), "pty://%s", pLink);
+	unlink(pLink);
+
+	emulatorId = fork();
+
+	if (emulatorId == 0)
+	{
+		execl(pEmulator, pEmulator, "-p", port, "-c", "-t", "30", (char*)NULL);
+		_exit(127);
+	}
+
+	//
+	// Wait for the emulator to create its pseudo terminal
+	//
+	for (i = 0; (emulatorId > 0) && (i < 200); i++)
+	{
+		if (access(pLink, F_OK) == 0)
+		{
+			return emulatorId;
+		}
+		sbgSleep(10);
+	}
+
+	return -1;
+}
+
+//------------------------------------------------------------------------------//
+//- Main                                                                       -//
+//------------------------------------------------------------------------------//
+
+int main(int argc, char **argv)
+{
+	char link[64];
+	char capture[64];
+	char replay[80];
+	SbgProtocolHandle handle;
+	SbgCaptureHandle captureHandle;
+	SbgCaptureHeader header;
+	SbgCaptureStats stats;
+	SbgTestCounts live;
+	SbgTestCounts replayed;
+	pid_t emulatorId;
+	bool passed;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <path to sbgEmulator>\n", argv[0]);
+		return 2;
+	}
+
+	snprintf(link, sizeof(link), "/tmp/sbgCaptureReplayTest.%d", (int)getpid());
+	snprintf(capture, sizeof(capture), "/tmp/sbgCaptureReplayTest.%d.cap", (int)getpid());
+	snprintf(replay, sizeof(replay), "file://%s?speed=0", capture);
+	memset(&live, 0, sizeof(live));
+	memset(&replayed, 0, sizeof(replayed));
+
+	//
+	// Record the emulator stream, changing the default output mask halfway
+	//
+	emulatorId = sbgTestStartEmulator(argv[1], link);
+
+	if (emulatorId == -1)
+	{
+		fprintf(stderr, "Unable to start %s\n", argv[1]);
+		return 1;
+	}
+
+	if ( (sbgComInit(link, SBG_TEST_BAUD_RATE, &handle) != SBG_NO_ERROR) ||
+		 (sbgSetDefaultOutputMask(handle, SBG_TEST_MASK_BEFORE) != SBG_NO_ERROR) )
+	{
+		fprintf(stderr, "Unable to configure the emulator\n");
+		kill(emulatorId, SIGTERM);
+		waitpid(emulatorId, NULL, 0);
+		return 1;
+	}
+
+	sbgSetContinuousRawCallback(handle, sbgTestCountFrame, &live);
+
+	memset(&header, 0, sizeof(header));
+	header.baudRate = SBG_TEST_BAUD_RATE;
+	header.outputMode = handle->targetOutputMode;
+	header.defaultOutputMask = handle->targetDefaultOutputMask;
+
+	if (sbgCaptureOpen(capture, &header, 0, FALSE, &captureHandle) != SBG_NO_ERROR)
+	{
+		fprintf(stderr, "Unable to create %s\n", capture);
+		sbgComClose(handle);
+		kill(emulatorId, SIGTERM);
+		waitpid(emulatorId, NULL, 0);
+		return 1;
+	}
+
+	sbgProtocolSetCapture(handle, captureHandle);
+	sbgTestStream(handle, SBG_TEST_PHASE_NS);
+
+	if (sbgSetDefaultOutputMask(handle, SBG_TEST_MASK_AFTER) != SBG_NO_ERROR)
+	{
+		fprintf(stderr, "Unable to change the default output mask\n");
+	}
+
+	sbgTestStream(handle, SBG_TEST_PHASE_NS);
+
+	sbgProtocolSetCapture(handle, SBG_INVALID_CAPTURE_HANDLE);
+	sbgCaptureGetStats(captureHandle, &stats);
+	sbgCaptureClose(captureHandle);
+	sbgComClose(handle);
+	kill(emulatorId, SIGTERM);
+	waitpid(emulatorId, NULL, 0);
+
+	//
+	// Replay the capture as fast as possible with the settings of its header
+	//
+	if (sbgProtocolInit(replay, 0, &handle) != SBG_NO_ERROR)
+	{
+		fprintf(stderr, "Unable to replay %s\n", capture);
+		unlink(capture);
+		return 1;
+	}
+
+	sbgDeviceGetCaptureHeader(handle->serialHandle, &header);
+	sbgProtocolSetTargetOutput(handle, header.outputMode, header.defaultOutputMask);
+	sbgSetContinuousRawCallback(handle, sbgTestCountFrame, &replayed);
+
+	//
+	// Once the whole file has been read the replay times out like a silent link
+	//
+	while (sbgDeviceWaitReadableUntil(handle->serialHandle, sbgGetTimeNs()) == SBG_NO_ERROR)
+	{
+		sbgProtocolContinuousModeHandle(handle);
+	}
+	sbgProtocolContinuousModeHandle(handle);
+
+	sbgProtocolClose(handle);
+	unlink(capture);
+
+	printf("live:     %u frames before, %u after, %u mismatches\n", live.framesBefore, live.framesAfter, live.mismatches);
+	printf("replayed: %u frames before, %u after, %u mismatches, %u dropped records\n", replayed.framesBefore, replayed.framesAfter, replayed.mismatches, stats.droppedRecords);
+
+	//
+	// The replay sees every recorded frame with the mask it has been sent with
+	//
+	passed = (replayed.framesBefore > 0) && (replayed.framesAfter > 0) && (replayed.mismatches == 0) && (stats.droppedRecords == 0);
+
+	printf("%s\n", passed?"PASSED":"FAILED");
+
+	return passed?0:1;
+}
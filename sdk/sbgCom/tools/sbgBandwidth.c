@@ -0,0 +1,330 @@
+/*!
+ *	\file		sbgBandwidth.c
+ *
+ *	\brief		Serial bandwidth planner for an output configuration.<br>
+ *				Prints the bytes per second sent by a continuous mask or a set of triggered conditions,
+ *				the line load at the baud rate, and the highest output rate and the lowest baud rate that fit.<br>
+ *				Exits with 2 when the configuration doesn't fit the line, so scripts can check it.
+ */
+
+#include "../src/sbgCom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <getopt.h>
+
+//------------------------------------------------------------------------------//
+//- Planner definitions                                                        -//
+//------------------------------------------------------------------------------//
+
+#define SBG_PLAN_EXIT_OVERLOADED			(2)						/*!< Exit code when the load exceeds the maximum. */
+
+/*!
+ *	Name of a mask bit, as written on the command line.
+ */
+typedef struct _SbgPlanName
+{
+	const char	*pName;						/*!< Name without the SBG_OUTPUT_ or SBG_TRIGGER_ prefix. */
+	uint32		bit;						/*!< Mask bit. */
+} SbgPlanName;
+
+static const SbgPlanName gOutputNames[] =
+{
+	{"QUATERNION",				SBG_OUTPUT_QUATERNION},
+	{"EULER",					SBG_OUTPUT_EULER},
+	{"MATRIX",					SBG_OUTPUT_MATRIX},
+	{"GYROSCOPES",				SBG_OUTPUT_GYROSCOPES},
+	{"ACCELEROMETERS",			SBG_OUTPUT_ACCELEROMETERS},
+	{"MAGNETOMETERS",			SBG_OUTPUT_MAGNETOMETERS},
+	{"TEMPERATURES",			SBG_OUTPUT_TEMPERATURES},
+	{"GYROSCOPES_RAW",			SBG_OUTPUT_GYROSCOPES_RAW},
+	{"ACCELEROMETERS_RAW",		SBG_OUTPUT_ACCELEROMETERS_RAW},
+	{"MAGNETOMETERS_RAW",		SBG_OUTPUT_MAGNETOMETERS_RAW},
+	{"TEMPERATURES_RAW",		SBG_OUTPUT_TEMPERATURES_RAW},
+	{"TIME_SINCE_RESET",		SBG_OUTPUT_TIME_SINCE_RESET},
+	{"DEVICE_STATUS",			SBG_OUTPUT_DEVICE_STATUS},
+	{"GPS_POSITION",			SBG_OUTPUT_GPS_POSITION},
+	{"GPS_NAVIGATION",			SBG_OUTPUT_GPS_NAVIGATION},
+	{"GPS_ACCURACY",			SBG_OUTPUT_GPS_ACCURACY},
+	{"GPS_INFO",				SBG_OUTPUT_GPS_INFO},
+	{"BARO_ALTITUDE",			SBG_OUTPUT_BARO_ALTITUDE},
+	{"BARO_PRESSURE",			SBG_OUTPUT_BARO_PRESSURE},
+	{"POSITION",				SBG_OUTPUT_POSITION},
+	{"VELOCITY",				SBG_OUTPUT_VELOCITY},
+	{"ATTITUDE_ACCURACY",		SBG_OUTPUT_ATTITUDE_ACCURACY},
+	{"NAV_ACCURACY",			SBG_OUTPUT_NAV_ACCURACY},
+	{"GYRO_TEMPERATURES",		SBG_OUTPUT_GYRO_TEMPERATURES},
+	{"GYRO_TEMPERATURES_RAW",	SBG_OUTPUT_GYRO_TEMPERATURES_RAW},
+	{"UTC_TIME_REFERENCE",		SBG_OUTPUT_UTC_TIME_REFERENCE},
+	{"MAG_CALIB_DATA",			SBG_OUTPUT_MAG_CALIB_DATA},
+	{"GPS_TRUE_HEADING",		SBG_OUTPUT_GPS_TRUE_HEADING},
+	{"ODO_VELOCITIES",			SBG_OUTPUT_ODO_VELOCITIES},
+	{"DELTA_ANGLES",			SBG_OUTPUT_DELTA_ANGLES},
+	{"HEAVE",					SBG_OUTPUT_HEAVE},
+	{NULL,						0}
+};
+
+static const SbgPlanName gTriggerNames[] =
+{
+	{"MAIN_LOOP_DIVIDER",		SBG_TRIGGER_MAIN_LOOP_DIVIDER},
+	{"MAGNETOMETERS",			SBG_TRIGGER_MAGNETOMETERS},
+	{"BAROMETER",				SBG_TRIGGER_BAROMETER},
+	{"GPS_VELOCITY",			SBG_TRIGGER_GPS_VELOCITY},
+	{"GPS_POSITION",			SBG_TRIGGER_GPS_POSITION},
+	{"GPS_COURSE",				SBG_TRIGGER_GPS_COURSE},
+	{"TIME_PULSE",				SBG_TRIGGER_TIME_PULSE},
+	{"EXT_EVENT",				SBG_TRIGGER_EXT_EVENT},
+	{"ODO_VELOCITY_0",			SBG_TRIGGER_ODO_VELOCITY_0},
+	{"ODO_VELOCITY_1",			SBG_TRIGGER_ODO_VELOCITY_1},
+	{"EXT_TRUE_HEADING",		SBG_TRIGGER_EXT_TRUE_HEADING},
+	{"VIRTUAL_ODOMETER",		SBG_TRIGGER_VIRTUAL_ODOMETER},
+	{NULL,						0}
+};
+
+//------------------------------------------------------------------------------//
+//- Command line                                                               -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Parse a mask written as a number or as names joined by '|' or ','.
+ *	\param[in]	pText		Mask text, for example "0x80C1C" or "MATRIX|GYROSCOPES|TIME_SINCE_RESET".
+ *	\param[in]	pNames		Names of the mask bits.
+ *	\param[out]	pMask		Parsed mask.
+ *	\return					SBG_NO_ERROR, SBG_INVALID_PARAMETER if a name is unknown.
+ */
+static SbgErrorCode sbgPlanParseMask(const char *pText, const SbgPlanName *pNames, uint32 *pMask)
+{
+	char token[64];
+	const char *pEnd;
+	char *pNumberEnd;
+	size_t length;
+	uint32 i;
+
+	*pMask = 0;
+
+	while (*pText)
+	{
+		pEnd = pText + strcspn(pText, "|,");
+		length = (size_t)(pEnd - pText);
+
+		if ( (length == 0) || (length >= sizeof(token)) )
+		{
+			return SBG_INVALID_PARAMETER;
+		}
+
+		memcpy(token, pText, length);
+		token[length] = '\0';
+
+		*pMask |= (uint32)strtoul(token, &pNumberEnd, 0);
+
+		if (*pNumberEnd != '\0')
+		{
+			for (i = 0; pNames[i].pName; i++)
+			{
+				if (strcasecmp(token, pNames[i].pName) == 0)
+				{
+					*pMask |= pNames[i].bit;
+					break;
+				}
+			}
+
+			if (!pNames[i].pName)
+			{
+				fprintf(stderr, "sbgBandwidth: unknown name %s\n", token);
+				return SBG_INVALID_PARAMETER;
+			}
+		}
+
+		pText = (*pEnd)?pEnd + 1:pEnd;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Parse a triggered condition written COND=TRIGGERS:MASK and store it in the configuration.
+ *	\param[in]	pText		Condition text, for example "1=GPS_POSITION|GPS_VELOCITY:POSITION|TIME_SINCE_RESET".
+ *	\param[out]	pConfig		Configuration to update.
+ *	\return					SBG_NO_ERROR, SBG_INVALID_PARAMETER if the condition is malformed.
+ */
+static SbgErrorCode sbgPlanParseTrigger(const char *pText, SbgBandwidthConfig *pConfig)
+{
+	char triggers[256];
+	const char *pColon;
+	char *pEnd;
+	unsigned long condId;
+	size_t length;
+
+	condId = strtoul(pText, &pEnd, 10);
+	pColon = strchr(pText, ':');
+
+	if ( (pEnd == pText) || (*pEnd != '=') || (condId >= SBG_BANDWIDTH_NUM_TRIGGERS) || (!pColon) || (pColon < pEnd) )
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+
+	length = (size_t)(pColon - (pEnd + 1));
+
+	if (length >= sizeof(triggers))
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+
+	memcpy(triggers, pEnd + 1, length);
+	triggers[length] = '\0';
+
+	if ( (sbgPlanParseMask(triggers, gTriggerNames, &pConfig->triggerMasks[condId]) != SBG_NO_ERROR) ||
+		 (sbgPlanParseMask(pColon + 1, gOutputNames, &pConfig->triggerOutputMasks[condId]) != SBG_NO_ERROR) )
+	{
+		return SBG_INVALID_PARAMETER;
+	}
+
+	return SBG_NO_ERROR;
+}
+
+/*!
+ *	Print the command line options.
+ *	\param[in]	pName		Program name.
+ */
+static void sbgPlanUsage(const char *pName)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -m, --mask MASK             continuous output mask, a number or names such as MATRIX|GYROSCOPES\n"
+		"  -t, --trigger C=TRIG:MASK   triggered condition C (0-3), switches to triggered mode; repeat for each condition\n"
+		"  -r, --rate HZ               device main loop frequency (default 100)\n"
+		"  -d, --divider N             main loop divider of the continuous output and MAIN_LOOP_DIVIDER (default 1)\n"
+		"  -b, --baud N                baud rate of the link (default 921600)\n"
+		"  -l, --max-load X            highest accepted line load (default %.2f)\n"
+		"  -f, --fixed                 fixed point output mode (default float)\n"
+		"      --mag-rate HZ           magnetometers trigger rate (default 100)\n"
+		"      --baro-rate HZ          barometer trigger rate (default 25)\n"
+		"      --gps-rate HZ           rate of each GPS trigger (default 4)\n"
+		"Example: %s -r 500 -m 'MATRIX|GYROSCOPES|ACCELEROMETERS|POSITION|NAV_ACCURACY|GPS_INFO|TIME_SINCE_RESET'\n",
+		pName, SBG_BANDWIDTH_DEFAULT_MAX_LOAD, pName);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] =
+	{
+		{"mask",		required_argument,	NULL, 'm'},
+		{"trigger",		required_argument,	NULL, 't'},
+		{"rate",		required_argument,	NULL, 'r'},
+		{"divider",		required_argument,	NULL, 'd'},
+		{"baud",		required_argument,	NULL, 'b'},
+		{"max-load",	required_argument,	NULL, 'l'},
+		{"fixed",		no_argument,		NULL, 'f'},
+		{"mag-rate",	required_argument,	NULL, 'M'},
+		{"baro-rate",	required_argument,	NULL, 'P'},
+		{"gps-rate",	required_argument,	NULL, 'G'},
+		{"help",		no_argument,		NULL, 'h'},
+		{NULL,			0,					NULL, 0}
+	};
+	SbgBandwidthConfig config;
+	SbgBandwidthReport report;
+	float maxLoad = SBG_BANDWIDTH_DEFAULT_MAX_LOAD;
+	uint32 baudRate;
+	uint8 divider;
+	uint32 i;
+	int option;
+
+	sbgBandwidthInitConfig(&config);
+
+	while ((option = getopt_long(argc, argv, "m:t:r:d:b:l:fh", options, NULL)) != -1)
+	{
+		switch (option)
+		{
+		case 'm':
+			if (sbgPlanParseMask(optarg, gOutputNames, &config.defaultOutputMask) != SBG_NO_ERROR)
+			{
+				sbgPlanUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 't':
+			if (sbgPlanParseTrigger(optarg, &config) != SBG_NO_ERROR)
+			{
+				fprintf(stderr, "sbgBandwidth: invalid condition %s\n", optarg);
+				sbgPlanUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			config.contMode = SBG_TRIGGERED_MODE_ENABLE;
+			break;
+		case 'r': config.mainLoopRate = strtof(optarg, NULL); break;
+		case 'd': config.divider = (uint8)strtoul(optarg, NULL, 0); break;
+		case 'b': config.baudRate = (uint32)strtoul(optarg, NULL, 0); break;
+		case 'l': maxLoad = strtof(optarg, NULL); break;
+		case 'f': config.outputMode |= SBG_OUTPUT_MODE_FIXED; break;
+		case 'M': config.magRate = strtof(optarg, NULL); break;
+		case 'P': config.baroRate = strtof(optarg, NULL); break;
+		case 'G': config.gpsRate = strtof(optarg, NULL); break;
+		default:
+			sbgPlanUsage(argv[0]);
+			return (option == 'h')?EXIT_SUCCESS:EXIT_FAILURE;
+		}
+	}
+
+	if (sbgBandwidthCompute(&config, &report) != SBG_NO_ERROR)
+	{
+		sbgPlanUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//
+	// Frames of the configuration
+	//
+	if (config.contMode == SBG_TRIGGERED_MODE_ENABLE)
+	{
+		printf("triggered mode, main loop %.1f Hz, divider %u\n", config.mainLoopRate, config.divider);
+		printf("%-4s %-10s %-10s %11s %10s %12s\n", "cond", "triggers", "outputs", "frame bytes", "frames/s", "bytes/s");
+
+		for (i = 0; i < SBG_BANDWIDTH_NUM_TRIGGERS; i++)
+		{
+			if (config.triggerMasks[i] != SBG_TRIGGER_DISABLED)
+			{
+				uint16 frameSize = sbgBandwidthFrameSize(config.outputMode, config.triggerOutputMasks[i], TRUE);
+
+				printf("%-4u 0x%08X 0x%08X %11u %10.1f %12.0f\n", i, config.triggerMasks[i], config.triggerOutputMasks[i],
+					   frameSize, report.conditionBytesPerSecond[i]/(float)frameSize, report.conditionBytesPerSecond[i]);
+			}
+		}
+	}
+	else
+	{
+		printf("continuous mode, main loop %.1f Hz, divider %u\n", config.mainLoopRate, config.divider);
+		printf("mask 0x%08X: %u bytes per frame, %.1f frames/s\n", config.defaultOutputMask, report.largestFrame, report.frameRate);
+	}
+
+	printf("line: %.0f of %.0f bytes/s at %u bauds, load %.1f %% (max %.1f %%): %s\n", report.bytesPerSecond,
+		   report.lineBytesPerSecond, config.baudRate, 100.0f*report.load, 100.0f*maxLoad,
+		   (report.load <= maxLoad)?"OK":"OVERLOADED");
+
+	//
+	// What would fit
+	//
+	divider = sbgBandwidthFindDivider(&config, maxLoad);
+
+	if (divider)
+	{
+		printf("highest rate at %u bauds: divider %u, %.1f Hz\n", config.baudRate, divider, config.mainLoopRate/(float)divider);
+	}
+	else
+	{
+		printf("highest rate at %u bauds: none, the outputs don't fit with any divider\n", config.baudRate);
+	}
+
+	baudRate = sbgBandwidthFindBaudRate(&config, maxLoad);
+
+	if (baudRate)
+	{
+		printf("lowest baud rate with divider %u: %u\n", config.divider, baudRate);
+	}
+	else
+	{
+		printf("lowest baud rate with divider %u: none, the outputs don't fit at 921600 bauds\n", config.divider);
+	}
+
+	return (report.load <= maxLoad)?EXIT_SUCCESS:SBG_PLAN_EXIT_OVERLOADED;
+}
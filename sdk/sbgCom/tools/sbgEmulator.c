@@ -0,0 +1,838 @@
+/*!
+ *	\file		sbgEmulator.c
+ *
+ *	\brief		IG-500N emulator speaking the sbgCom protocol on a pseudo terminal.<br>
+ *				Answers the commands used by sbgComInit and the node, streams continuous and triggered
+ *				frames with a synthetic motion and paces its output at the emulated baud rate.
+ */
+
+#include "../src/sbgCom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <getopt.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------//
+//- Emulator definitions                                                       -//
+//------------------------------------------------------------------------------//
+
+#define SBG_EMU_DEFAULT_PORT				"pty:///tmp/sbg_emu"	/*!< Default device, a pseudo terminal linked to /tmp/sbg_emu. */
+#define SBG_EMU_DEFAULT_MASK				(SBG_OUTPUT_QUATERNION | SBG_OUTPUT_GYROSCOPES | SBG_OUTPUT_ACCELEROMETERS | SBG_OUTPUT_TIME_SINCE_RESET)
+#define SBG_EMU_NUM_TRIGGERS				(4)						/*!< Number of triggered output conditions. */
+#define SBG_EMU_FRAME_OVERHEAD				(8)						/*!< SYNC, STX, CMD, SIZE, CRC and ETX bytes. */
+#define SBG_EMU_DEVICE_STATUS_OK			(0x001FFFFF)			/*!< Every device status bit in normal operation. */
+#define SBG_EMU_SATURATION_HOLD_NS			(1000000000ull)			/*!< The saturation status stays set this long after the last dropped output. */
+#define SBG_EMU_GRAVITY						(9.80665)				/*!< Gravity magnitude in m/s^2. */
+#define SBG_EMU_PI							(3.14159265358979323846)
+
+/*!
+ *	State of the emulated device.<br>
+ *	The output mode and default output mask live in the protocol handle, like for a real device.
+ */
+typedef struct _SbgEmulator
+{
+	SbgProtocolHandle	protocolHandle;							/*!< Parses the commands sent by the host. */
+	uint64				byteTimeNs;								/*!< Transmission time of one byte, 0 to disable the pacing. */
+	uint64				lineFreeTime;							/*!< Time at which the emulated line has sent the last frame. */
+	uint64				loopPeriodNs;							/*!< Period of the main loop. */
+	uint64				startTime;								/*!< sbgGetTimeNs time at start, origin of timeSinceReset. */
+	uint64				loopCount;								/*!< Number of main loop iterations. */
+	SbgContOutputTypes	continuousMode;							/*!< Continuous, triggered or question/answer mode. */
+	uint8				divider;								/*!< Main loop divider of the continuous output and the main loop trigger. */
+	uint32				magDivider;								/*!< Main loop divider of the magnetometers trigger. */
+	uint32				baroDivider;							/*!< Main loop divider of the barometer trigger. */
+	uint32				gpsDivider;								/*!< Main loop divider of the GPS triggers. */
+	uint32				triggerMasks[SBG_EMU_NUM_TRIGGERS];		/*!< Trigger mask of each condition. */
+	uint32				triggerOutputMasks[SBG_EMU_NUM_TRIGGERS];	/*!< Output mask of each condition. */
+	SbgOutputDecodePlan	defaultPlan;							/*!< Layout of the default output, rebuilt when the mode or mask changes. */
+	bool				saturated;								/*!< TRUE while the line can't keep up with the outputs. */
+	uint64				lastDropTime;							/*!< sbgGetTimeNs time of the last dropped output, 0 if none. */
+	uint32				rngState;								/*!< Sensor noise generator state. */
+	bool				verbose;								/*!< Print each received command. */
+	bool				probe;									/*!< Embed the sample time of each output for latency measurements. */
+	uint64				sampleTime;								/*!< sbgGetTimeNs time of the last main loop iteration, when the outputs were computed. */
+	uint64				framesSent;								/*!< Number of continuous and triggered frames sent. */
+	uint64				framesDropped;							/*!< Number of outputs skipped because the line was saturated. */
+	uint64				commandsReceived;						/*!< Number of commands answered. */
+} SbgEmulator;
+
+static volatile sig_atomic_t gStopRequested = 0;
+
+//------------------------------------------------------------------------------//
+//- Frames                                                                     -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Handle SIGINT and SIGTERM.
+ *	\param[in]	signalId	Received signal.
+ */
+static void sbgEmulatorStop(int signalId)
+{
+	// Avoid warnings
+	(void)signalId;
+
+	gStopRequested = 1;
+}
+
+/*!
+ *	Write a 32 bits value in the device output mode.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[out]	pBuffer		Unaligned destination.
+ *	\param[in]	value		Host value.
+ */
+static void sbgEmulatorPut32(const SbgEmulator *pEmu, uint8 *pBuffer, uint32 value)
+{
+	value = sbgHostToTarget32(pEmu->protocolHandle->targetOutputMode, value);
+	memcpy(pBuffer, &value, sizeof(uint32));
+}
+
+/*!
+ *	Read a 32 bits value sent in the device output mode.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	pBuffer		Unaligned source.
+ *	\return					Host value.
+ */
+static uint32 sbgEmulatorGet32(const SbgEmulator *pEmu, const uint8 *pBuffer)
+{
+	uint32 value;
+
+	memcpy(&value, pBuffer, sizeof(uint32));
+
+	return sbgTargetToHost32(pEmu->protocolHandle->targetOutputMode, value);
+}
+
+/*!
+ *	Send a frame as the device would, no faster than the emulated baud rate.<br>
+ *	The frame is written when its last byte would have been received, on a line that sends the frames back to back.<br>
+ *	sbgProtocolSend isn't used: it drains the received frames first and would drop the host commands.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	cmd			Frame command.
+ *	\param[in]	pData		Frame data.
+ *	\param[in]	size		Size of the frame data.
+ *	\return					SBG_NO_ERROR if the frame has been written.
+ */
+static SbgErrorCode sbgEmulatorSend(SbgEmulator *pEmu, uint8 cmd, const void *pData, uint16 size)
+{
+	uint8 frame[SBG_MAX_DATA_LENGTH + SBG_EMU_FRAME_OVERHEAD];
+	uint64 currentTime;
+	uint16 crc;
+
+	if (size > SBG_MAX_DATA_LENGTH)
+	{
+		return SBG_BUFFER_OVERFLOW;
+	}
+
+	frame[0] = SBG_SYNC;
+	frame[1] = SBG_STX;
+	frame[2] = cmd;
+	frame[3] = (uint8)(size>>8);
+	frame[4] = (uint8)(size);
+	memcpy(frame + 5, pData, size);
+	crc = sbgProtocolCalcCRC(frame + 2, size + 3);
+	frame[size + 5] = (uint8)(crc>>8);
+	frame[size + 6] = (uint8)(crc);
+	frame[size + 7] = SBG_ETC;
+
+	if (pEmu->byteTimeNs)
+	{
+		currentTime = sbgGetTimeNs();
+
+		if (pEmu->lineFreeTime < currentTime)
+		{
+			pEmu->lineFreeTime = currentTime;
+		}
+
+		pEmu->lineFreeTime += (size + SBG_EMU_FRAME_OVERHEAD) * pEmu->byteTimeNs;
+		sbgSleepUntilNs(pEmu->lineFreeTime);
+	}
+
+	return sbgDeviceWrite(pEmu->protocolHandle->serialHandle, frame, size + SBG_EMU_FRAME_OVERHEAD);
+}
+
+/*!
+ *	Send an acknowledge frame.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	errorCode	Error code returned to the host.
+ */
+static void sbgEmulatorSendAck(SbgEmulator *pEmu, SbgErrorCode errorCode)
+{
+	uint8 value = (uint8)errorCode;
+
+	sbgEmulatorSend(pEmu, SBG_ACK, &value, sizeof(uint8));
+}
+
+//------------------------------------------------------------------------------//
+//- Synthetic motion                                                           -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Returns a small centered noise.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	amplitude	Peak amplitude.
+ *	\return					Noise in [-amplitude, amplitude].
+ */
+static double sbgEmulatorNoise(SbgEmulator *pEmu, double amplitude)
+{
+	pEmu->rngState = pEmu->rngState*1664525u + 1013904223u;
+
+	return amplitude*(((double)(pEmu->rngState>>8)/8388608.0) - 1.0);
+}
+
+/*!
+ *	Fill every output of the device for a given time.<br>
+ *	The device slowly rolls, pitches and turns while driving on a circle, the sensors are consistent with this motion.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	timeNs		Time since the device start.
+ *	\param[out]	pOutput		Filled outputs.
+ */
+static void sbgEmulatorFillOutput(SbgEmulator *pEmu, uint64 timeNs, SbgOutput *pOutput)
+{
+	const double t = (double)timeNs/1e9;
+	const double magNed[3] = {0.45, 0.0, 0.89};
+	double roll, pitch, yaw, rollRate, pitchRate, yawRate;
+	double cr, sr, cp, sp, cy, sy;
+	double matrix[9];
+	double heading, northM, eastM;
+	time_t utcTime;
+	struct tm utc;
+	uint32 i;
+
+	memset(pOutput, 0, sizeof(SbgOutput));
+
+	//
+	// Attitude and its derivatives
+	//
+	roll = 0.2*sin(2.0*SBG_EMU_PI*0.2*t);
+	pitch = 0.1*sin(2.0*SBG_EMU_PI*0.13*t);
+	yaw = fmod(0.3*t + SBG_EMU_PI, 2.0*SBG_EMU_PI) - SBG_EMU_PI;
+	rollRate = 0.2*2.0*SBG_EMU_PI*0.2*cos(2.0*SBG_EMU_PI*0.2*t);
+	pitchRate = 0.1*2.0*SBG_EMU_PI*0.13*cos(2.0*SBG_EMU_PI*0.13*t);
+	yawRate = 0.3;
+
+	cr = cos(roll); sr = sin(roll);
+	cp = cos(pitch); sp = sin(pitch);
+	cy = cos(yaw); sy = sin(yaw);
+
+	pOutput->stateEuler[0] = (float)roll;
+	pOutput->stateEuler[1] = (float)pitch;
+	pOutput->stateEuler[2] = (float)yaw;
+
+	pOutput->stateQuat[0] = (float)(cos(roll/2)*cos(pitch/2)*cos(yaw/2) + sin(roll/2)*sin(pitch/2)*sin(yaw/2));
+	pOutput->stateQuat[1] = (float)(sin(roll/2)*cos(pitch/2)*cos(yaw/2) - cos(roll/2)*sin(pitch/2)*sin(yaw/2));
+	pOutput->stateQuat[2] = (float)(cos(roll/2)*sin(pitch/2)*cos(yaw/2) + sin(roll/2)*cos(pitch/2)*sin(yaw/2));
+	pOutput->stateQuat[3] = (float)(cos(roll/2)*cos(pitch/2)*sin(yaw/2) - sin(roll/2)*sin(pitch/2)*cos(yaw/2));
+
+	//
+	// Body to NED rotation, row major
+	//
+	matrix[0] = cp*cy;	matrix[1] = sr*sp*cy - cr*sy;	matrix[2] = cr*sp*cy + sr*sy;
+	matrix[3] = cp*sy;	matrix[4] = sr*sp*sy + cr*cy;	matrix[5] = cr*sp*sy - sr*cy;
+	matrix[6] = -sp;	matrix[7] = sr*cp;				matrix[8] = cr*cp;
+
+	for (i = 0; i < 9; i++)
+	{
+		pOutput->stateMatrix[i] = (float)matrix[i];
+	}
+
+	//
+	// Sensors in the body frame
+	//
+	pOutput->gyroscopes[0] = (float)(rollRate - sp*yawRate + sbgEmulatorNoise(pEmu, 0.002));
+	pOutput->gyroscopes[1] = (float)(cr*pitchRate + sr*cp*yawRate + sbgEmulatorNoise(pEmu, 0.002));
+	pOutput->gyroscopes[2] = (float)(-sr*pitchRate + cr*cp*yawRate + sbgEmulatorNoise(pEmu, 0.002));
+
+	pOutput->accelerometers[0] = (float)(SBG_EMU_GRAVITY*sp + sbgEmulatorNoise(pEmu, 0.02));
+	pOutput->accelerometers[1] = (float)(-SBG_EMU_GRAVITY*sr*cp + sbgEmulatorNoise(pEmu, 0.02));
+	pOutput->accelerometers[2] = (float)(-SBG_EMU_GRAVITY*cr*cp + sbgEmulatorNoise(pEmu, 0.02));
+
+	for (i = 0; i < 3; i++)
+	{
+		pOutput->magnetometers[i] = (float)(matrix[i]*magNed[0] + matrix[3+i]*magNed[1] + matrix[6+i]*magNed[2] + sbgEmulatorNoise(pEmu, 0.005));
+		pOutput->gyroscopesRaw[i] = (uint16)(32768 + (int32)(pOutput->gyroscopes[i]*1000.0f));
+		pOutput->accelerometersRaw[i] = (uint16)(32768 + (int32)(pOutput->accelerometers[i]*1000.0f));
+		pOutput->magnetometersRaw[i] = (uint16)(32768 + (int32)(pOutput->magnetometers[i]*10000.0f));
+		pOutput->gyroTemperatures[i] = 31.5f;
+		pOutput->gyroTemperaturesRaw[i] = 2150;
+		pOutput->deltaAngles[i] = pOutput->gyroscopes[i];
+	}
+
+	pOutput->temperatures[0] = 30.0f;
+	pOutput->temperatures[1] = 30.5f;
+	pOutput->temperaturesRaw[0] = 2100;
+	pOutput->temperaturesRaw[1] = 2110;
+
+	pOutput->timeSinceReset = (uint32)(timeNs/1000000ull);
+	pOutput->deviceStatus = SBG_EMU_DEVICE_STATUS_OK;
+
+	if (pEmu->saturated)
+	{
+		pOutput->deviceStatus &= ~SBG_PROTOCOL_OUTPUT_STATUS_MASK;
+	}
+
+	//
+	// 5 m/s on a circle around the start point, heading follows the yaw
+	//
+	heading = yaw;
+	northM = 5.0/0.3*sin(0.3*t);
+	eastM = 5.0/0.3*(1.0 - cos(0.3*t));
+
+	pOutput->position[0] = 43.6045 + northM/111320.0;
+	pOutput->position[1] = 1.4440 + eastM/(111320.0*cos(43.6045*SBG_EMU_PI/180.0));
+	pOutput->position[2] = 150.0 + 0.5*sin(0.05*t);
+	pOutput->velocity[0] = (float)(5.0*cp);
+	pOutput->velocity[1] = 0.0f;
+	pOutput->velocity[2] = (float)(5.0*sp);
+
+	pOutput->gpsLatitude = (int32)(pOutput->position[0]*1e7);
+	pOutput->gpsLongitude = (int32)(pOutput->position[1]*1e7);
+	pOutput->gpsAltitude = (int32)(pOutput->position[2]*1000.0);
+	pOutput->gpsVelocity[0] = (int32)(500.0*cos(heading));
+	pOutput->gpsVelocity[1] = (int32)(500.0*sin(heading));
+	pOutput->gpsVelocity[2] = 0;
+	pOutput->gpsHeading = (int32)(heading*180.0/SBG_EMU_PI*1e5);
+	pOutput->gpsHorAccuracy = 1500;
+	pOutput->gpsVertAccuracy = 2500;
+	pOutput->gpsSpeedAccuracy = 20;
+	pOutput->gpsHeadingAccuracy = 50000;
+	pOutput->gpsTimeMs = (uint32)((timeNs/1000000ull) % 604800000ull);
+	pOutput->gpsFlags = SBG_GPS_3D_FIX | SBG_GPS_VALID_TOW | SBG_GPS_VALID_WKN | SBG_GPS_VALID_UTC;
+	pOutput->gpsNbSats = 9;
+	pOutput->gpsTrueHeading = pOutput->gpsHeading;
+	pOutput->gpsTrueHeadingAccuracy = 20000;
+
+	pOutput->baroAltitude = (int32)((pOutput->position[2] - 150.0)*100.0 + sbgEmulatorNoise(pEmu, 10.0));
+	pOutput->baroPressure = (uint32)(99525.0 - (pOutput->position[2] - 150.0)*12.0 + sbgEmulatorNoise(pEmu, 2.0));
+
+	pOutput->attitudeAccuracy = 0.01f;
+	pOutput->positionAccuracy = 1.5f;
+	pOutput->velocityAccuracy = 0.1f;
+
+	utcTime = time(NULL);
+	if (gmtime_r(&utcTime, &utc))
+	{
+		pOutput->utcYear = (uint8)(utc.tm_year - 100);
+		pOutput->utcMonth = (uint8)(utc.tm_mon + 1);
+		pOutput->utcDay = (uint8)utc.tm_mday;
+		pOutput->utcHour = (uint8)utc.tm_hour;
+		pOutput->utcMin = (uint8)utc.tm_min;
+		pOutput->utcSec = (uint8)utc.tm_sec;
+	}
+	pOutput->utcNano = (uint32)(timeNs % 1000000000ull);
+
+	pOutput->odoRawVelocity[0] = 5.0f;
+	pOutput->odoRawVelocity[1] = 5.0f;
+	pOutput->heave = (float)(0.05*sin(2.0*SBG_EMU_PI*0.1*t));
+}
+
+/*!
+ *	Replace some outputs by the time of the main loop iteration that computed them.<br>
+ *	Continuous and triggered frames leave at that time or once the line has sent the previous frames,
+ *	answers to output requests carry the latest sample, so the host measures the age of the data it receives.<br>
+ *	The sbgGetTimeNs value, a CLOCK_MONOTONIC time, is stored exactly in float outputs:
+ *	24 bits in each gyroscope, lowest bits first, and the whole value in the first position double.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[out]	pOutput		Outputs to mark.
+ */
+static void sbgEmulatorEmbedProbe(const SbgEmulator *pEmu, SbgOutput *pOutput)
+{
+	uint32 i;
+
+	for (i = 0; i < 3; i++)
+	{
+		pOutput->gyroscopes[i] = (float)((pEmu->sampleTime >> (24*i)) & 0xFFFFFF);
+	}
+	pOutput->position[0] = (double)pEmu->sampleTime;
+}
+
+/*!
+ *	Encode the outputs of a mask after an optional prefix, in the device output mode.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	outputMask	Outputs to encode.
+ *	\param[out]	pBuffer		Frame data, the outputs are written after prefixSize bytes.
+ *	\param[in]	prefixSize	Number of bytes already in the frame data.
+ *	\param[out]	pSize		Total frame data size.
+ *	\return					SBG_NO_ERROR if the outputs fit in a frame.
+ */
+static SbgErrorCode sbgEmulatorEncodeOutput(SbgEmulator *pEmu, uint32 outputMask, uint8 *pBuffer, uint16 prefixSize, uint16 *pSize)
+{
+	SbgOutputDecodePlan plan;
+	const SbgOutputDecodePlan *pPlan;
+	SbgOutput output;
+	SbgErrorCode errorCode;
+
+	//
+	// Continuous frames reuse the default plan, the others are rare enough to be built each time
+	//
+	if ( (outputMask == pEmu->protocolHandle->targetDefaultOutputMask) && (pEmu->defaultPlan.valid) &&
+		 (pEmu->defaultPlan.outputMask == outputMask) && (pEmu->defaultPlan.targetOutputMode == pEmu->protocolHandle->targetOutputMode) )
+	{
+		pPlan = &pEmu->defaultPlan;
+	}
+	else
+	{
+		errorCode = sbgBuildOutputDecodePlan(pEmu->protocolHandle->targetOutputMode, outputMask, &plan);
+
+		if (errorCode != SBG_NO_ERROR)
+		{
+			return errorCode;
+		}
+
+		if (outputMask == pEmu->protocolHandle->targetDefaultOutputMask)
+		{
+			pEmu->defaultPlan = plan;
+		}
+		pPlan = &plan;
+	}
+
+	if (prefixSize + pPlan->bufferSize > SBG_MAX_DATA_LENGTH)
+	{
+		return SBG_BUFFER_OVERFLOW;
+	}
+
+	sbgEmulatorFillOutput(pEmu, sbgGetTimeNs() - pEmu->startTime, &output);
+
+	if (pEmu->probe)
+	{
+		sbgEmulatorEmbedProbe(pEmu, &output);
+	}
+
+	*pSize = prefixSize + pPlan->bufferSize;
+
+	return sbgExecuteOutputEncodePlan(pPlan, &output, pBuffer + prefixSize, SBG_MAX_DATA_LENGTH - prefixSize);
+}
+
+//------------------------------------------------------------------------------//
+//- Commands                                                                   -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Answer one command received from the host.<br>
+ *	Commands that aren't emulated are acknowledged without any effect.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	cmd			Received command.
+ *	\param[in]	pData		Command data.
+ *	\param[in]	size		Size of the command data.
+ */
+static void sbgEmulatorHandleCommand(SbgEmulator *pEmu, uint8 cmd, const uint8 *pData, uint16 size)
+{
+	SbgProtocolHandle handle = pEmu->protocolHandle;
+	uint8 answer[SBG_MAX_DATA_LENGTH];
+	uint16 answerSize;
+	uint8 condId;
+
+	pEmu->commandsReceived++;
+
+	if (pEmu->verbose)
+	{
+		fprintf(stderr, "sbgEmulator: command 0x%02X, %u bytes\n", cmd, size);
+	}
+
+	switch (cmd)
+	{
+	case SBG_GET_INFOS:
+		memset(answer, 0, 32 + 5*sizeof(uint32));
+		strncpy((char*)answer, "IG-500N-G4A2P1-S", 31);
+		sbgEmulatorPut32(pEmu, answer + 32, 0x12345678);						// Device id
+		sbgEmulatorPut32(pEmu, answer + 32 + 4, SBG_VERSION(4, 0, 0, 0));		// Firmware
+		sbgEmulatorPut32(pEmu, answer + 32 + 8, SBG_VERSION(1, 0, 0, 0));		// Calibration data
+		sbgEmulatorPut32(pEmu, answer + 32 + 12, SBG_VERSION(2, 1, 0, 0));		// Main board
+		sbgEmulatorPut32(pEmu, answer + 32 + 16, SBG_VERSION(1, 0, 0, 0));		// GPS board
+		sbgEmulatorSend(pEmu, SBG_RET_INFOS, answer, 32 + 5*sizeof(uint32));
+		break;
+
+	case SBG_GET_OUTPUT_MODE:
+		answer[0] = handle->targetOutputMode;
+		sbgEmulatorSend(pEmu, SBG_RET_OUTPUT_MODE, answer, sizeof(uint8));
+		break;
+
+	case SBG_SET_OUTPUT_MODE:
+		if (size >= 2*sizeof(uint8))
+		{
+			//
+			// The acknowledge still goes out in the previous mode
+			//
+			sbgEmulatorSendAck(pEmu, SBG_NO_ERROR);
+			handle->targetOutputMode = pData[1];
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	case SBG_GET_DEFAULT_OUTPUT_MASK:
+		sbgEmulatorPut32(pEmu, answer, handle->targetDefaultOutputMask);
+		sbgEmulatorSend(pEmu, SBG_RET_DEFAULT_OUTPUT_MASK, answer, sizeof(uint32));
+		break;
+
+	case SBG_SET_DEFAULT_OUTPUT_MASK:
+		if (size >= sizeof(uint8) + sizeof(uint32))
+		{
+			handle->targetDefaultOutputMask = sbgEmulatorGet32(pEmu, pData + 1);
+			sbgEmulatorSendAck(pEmu, SBG_NO_ERROR);
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	case SBG_SET_CONTINUOUS_MODE:
+		if (size >= 3*sizeof(uint8))
+		{
+			pEmu->continuousMode = (SbgContOutputTypes)pData[1];
+			pEmu->divider = (pData[2] > 0)?pData[2]:1;
+			sbgEmulatorSendAck(pEmu, SBG_NO_ERROR);
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	case SBG_GET_CONTINUOUS_MODE:
+		answer[0] = (uint8)pEmu->continuousMode;
+		answer[1] = pEmu->divider;
+		sbgEmulatorSend(pEmu, SBG_RET_CONTINUOUS_MODE, answer, 2*sizeof(uint8));
+		break;
+
+	case SBG_SET_TRIGGERED_OUTPUT:
+		if ( (size >= 2*sizeof(uint8) + 2*sizeof(uint32)) && (pData[1] < SBG_EMU_NUM_TRIGGERS) )
+		{
+			condId = pData[1];
+			pEmu->triggerMasks[condId] = sbgEmulatorGet32(pEmu, pData + 2);
+			pEmu->triggerOutputMasks[condId] = sbgEmulatorGet32(pEmu, pData + 2 + sizeof(uint32));
+			sbgEmulatorSendAck(pEmu, SBG_NO_ERROR);
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	case SBG_GET_TRIGGERED_OUTPUT:
+		if ( (size >= sizeof(uint8)) && (pData[0] < SBG_EMU_NUM_TRIGGERS) )
+		{
+			condId = pData[0];
+			answer[0] = condId;
+			sbgEmulatorPut32(pEmu, answer + 1, pEmu->triggerMasks[condId]);
+			sbgEmulatorPut32(pEmu, answer + 1 + sizeof(uint32), pEmu->triggerOutputMasks[condId]);
+			sbgEmulatorSend(pEmu, SBG_RET_TRIGGERED_OUTPUT, answer, sizeof(uint8) + 2*sizeof(uint32));
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	case SBG_GET_DEFAULT_OUTPUT:
+		if (sbgEmulatorEncodeOutput(pEmu, handle->targetDefaultOutputMask, answer, 0, &answerSize) == SBG_NO_ERROR)
+		{
+			sbgEmulatorSend(pEmu, SBG_RET_DEFAULT_OUTPUT, answer, answerSize);
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_BUFFER_OVERFLOW);
+		}
+		break;
+
+	case SBG_GET_SPECIFIC_OUTPUT:
+		if ( (size >= sizeof(uint32)) && (sbgEmulatorEncodeOutput(pEmu, sbgEmulatorGet32(pEmu, pData), answer, 0, &answerSize) == SBG_NO_ERROR) )
+		{
+			sbgEmulatorSend(pEmu, SBG_RET_SPECIFIC_OUTPUT, answer, answerSize);
+		}
+		else
+		{
+			sbgEmulatorSendAck(pEmu, SBG_INVALID_PARAMETER);
+		}
+		break;
+
+	default:
+		sbgEmulatorSendAck(pEmu, SBG_NO_ERROR);
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------//
+//- Main loop                                                                  -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Run one main loop iteration: send the continuous or triggered frames due at this iteration.
+ *	\param[in]	pEmu		Our emulator.
+ *	\param[in]	skipOutput	TRUE if the line is late and the outputs of this iteration are dropped.
+ */
+static void sbgEmulatorLoop(SbgEmulator *pEmu, bool skipOutput)
+{
+	uint8 frame[SBG_MAX_DATA_LENGTH];
+	uint16 frameSize;
+	uint32 triggers = 0;
+	uint32 i;
+
+	if (pEmu->continuousMode == SBG_CONTINUOUS_MODE_ENABLE)
+	{
+		if ((pEmu->loopCount % pEmu->divider) == 0)
+		{
+			if (skipOutput)
+			{
+				pEmu->framesDropped++;
+			}
+			else if (sbgEmulatorEncodeOutput(pEmu, pEmu->protocolHandle->targetDefaultOutputMask, frame, 0, &frameSize) == SBG_NO_ERROR)
+			{
+				sbgEmulatorSend(pEmu, SBG_CONTINUOUS_DEFAULT_OUTPUT, frame, frameSize);
+				pEmu->framesSent++;
+			}
+		}
+	}
+	else if (pEmu->continuousMode == SBG_TRIGGERED_MODE_ENABLE)
+	{
+		//
+		// Events of this iteration, each sensor runs at its own rate
+		//
+		if ((pEmu->loopCount % pEmu->divider) == 0)
+		{
+			triggers |= SBG_TRIGGER_MAIN_LOOP_DIVIDER;
+		}
+		if ((pEmu->loopCount % pEmu->magDivider) == 0)
+		{
+			triggers |= SBG_TRIGGER_MAGNETOMETERS;
+		}
+		if ((pEmu->loopCount % pEmu->baroDivider) == 0)
+		{
+			triggers |= SBG_TRIGGER_BAROMETER;
+		}
+		if ((pEmu->loopCount % pEmu->gpsDivider) == 0)
+		{
+			triggers |= SBG_TRIGGER_GPS_VELOCITY | SBG_TRIGGER_GPS_POSITION | SBG_TRIGGER_GPS_COURSE;
+		}
+
+		for (i = 0; i < SBG_EMU_NUM_TRIGGERS; i++)
+		{
+			if (pEmu->triggerMasks[i] & triggers)
+			{
+				if (skipOutput)
+				{
+					pEmu->framesDropped++;
+				}
+				else
+				{
+					sbgEmulatorPut32(pEmu, frame, pEmu->triggerMasks[i] & triggers);
+					sbgEmulatorPut32(pEmu, frame + sizeof(uint32), pEmu->triggerOutputMasks[i]);
+
+					if (sbgEmulatorEncodeOutput(pEmu, pEmu->triggerOutputMasks[i], frame, 2*sizeof(uint32), &frameSize) == SBG_NO_ERROR)
+					{
+						sbgEmulatorSend(pEmu, SBG_TRIGGERED_OUTPUT, frame, frameSize);
+						pEmu->framesSent++;
+					}
+				}
+			}
+		}
+	}
+}
+
+/*!
+ *	Returns a main loop divider that gives a sensor rate.
+ *	\param[in]	loopFrequency	Main loop frequency in Hz.
+ *	\param[in]	rate			Sensor rate in Hz.
+ *	\return						Divider, at least 1.
+ */
+static uint32 sbgEmulatorDivider(double loopFrequency, double rate)
+{
+	return (rate > 0.0) && (loopFrequency/rate > 1.0)?(uint32)(loopFrequency/rate + 0.5):1;
+}
+
+/*!
+ *	Print the command line options.
+ *	\param[in]	pName		Program name.
+ */
+static void sbgEmulatorUsage(const char *pName)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -p, --port URI        device to serve (default " SBG_EMU_DEFAULT_PORT ")\n"
+		"  -b, --baud N          emulated baud rate, outputs are paced accordingly (default 921600, 0 disables pacing)\n"
+		"  -r, --rate HZ         main loop frequency (default 100)\n"
+		"  -d, --divider N       continuous output divider (default 1)\n"
+		"  -m, --mask MASK       default output mask (default 0x%X)\n"
+		"  -B, --big-endian      start in big endian output mode (default little endian)\n"
+		"  -f, --fixed           start in fixed point output mode (default float)\n"
+		"  -c, --continuous      start streaming without waiting for SBG_SET_CONTINUOUS_MODE\n"
+		"      --mag-rate HZ     magnetometers trigger rate (default 100)\n"
+		"      --baro-rate HZ    barometer trigger rate (default 25)\n"
+		"      --gps-rate HZ     GPS triggers rate (default 4)\n"
+		"  -t, --duration S      stop after S seconds (default 0, run until interrupted)\n"
+		"      --probe           embed the sample time of each output in the gyroscopes and the first position (float mode only)\n"
+		"  -v, --verbose         print the received commands\n",
+		pName, SBG_EMU_DEFAULT_MASK);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] =
+	{
+		{"port",		required_argument,	NULL, 'p'},
+		{"baud",		required_argument,	NULL, 'b'},
+		{"rate",		required_argument,	NULL, 'r'},
+		{"divider",		required_argument,	NULL, 'd'},
+		{"mask",		required_argument,	NULL, 'm'},
+		{"big-endian",	no_argument,		NULL, 'B'},
+		{"fixed",		no_argument,		NULL, 'f'},
+		{"continuous",	no_argument,		NULL, 'c'},
+		{"mag-rate",	required_argument,	NULL, 'M'},
+		{"baro-rate",	required_argument,	NULL, 'P'},
+		{"gps-rate",	required_argument,	NULL, 'G'},
+		{"duration",	required_argument,	NULL, 't'},
+		{"verbose",		no_argument,		NULL, 'v'},
+		{"probe",		no_argument,		NULL, 'T'},
+		{"help",		no_argument,		NULL, 'h'},
+		{NULL,			0,					NULL, 0}
+	};
+	SbgEmulator emu;
+	const char *pPort = SBG_EMU_DEFAULT_PORT;
+	uint32 baudRate = 921600;
+	double loopFrequency = 100.0;
+	double magRate = 100.0, baroRate = 25.0, gpsRate = 4.0;
+	double duration = 0.0;
+	uint32 outputMask = SBG_EMU_DEFAULT_MASK;
+	uint8 outputMode = SBG_OUTPUT_MODE_LITTLE_ENDIAN | SBG_OUTPUT_MODE_FLOAT;
+	uint8 data[SBG_MAX_DATA_LENGTH];
+	uint64 nextLoop, stopTime, currentTime;
+	SbgErrorCode errorCode;
+	uint16 size;
+	uint8 cmd;
+	uint32 i;
+	bool skipOutput;
+	int option;
+
+	memset(&emu, 0, sizeof(emu));
+	emu.divider = 1;
+	emu.rngState = 1;
+
+	while ((option = getopt_long(argc, argv, "p:b:r:d:m:Bfct:vh", options, NULL)) != -1)
+	{
+		switch (option)
+		{
+		case 'p': pPort = optarg; break;
+		case 'b': baudRate = (uint32)strtoul(optarg, NULL, 0); break;
+		case 'r': loopFrequency = strtod(optarg, NULL); break;
+		case 'd': emu.divider = (uint8)strtoul(optarg, NULL, 0); break;
+		case 'm': outputMask = (uint32)strtoul(optarg, NULL, 0); break;
+		case 'B': outputMode &= ~SBG_OUTPUT_MODE_LITTLE_ENDIAN; break;
+		case 'f': outputMode |= SBG_OUTPUT_MODE_FIXED; break;
+		case 'c': emu.continuousMode = SBG_CONTINUOUS_MODE_ENABLE; break;
+		case 'M': magRate = strtod(optarg, NULL); break;
+		case 'P': baroRate = strtod(optarg, NULL); break;
+		case 'G': gpsRate = strtod(optarg, NULL); break;
+		case 't': duration = strtod(optarg, NULL); break;
+		case 'v': emu.verbose = TRUE; break;
+		case 'T': emu.probe = TRUE; break;
+		default:
+			sbgEmulatorUsage(argv[0]);
+			return (option == 'h')?EXIT_SUCCESS:EXIT_FAILURE;
+		}
+	}
+
+	if ( (loopFrequency <= 0.0) || (emu.divider == 0) )
+	{
+		sbgEmulatorUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//
+	// The protocol handle parses the host commands and holds the output mode and mask of the emulated device
+	//
+	errorCode = sbgProtocolInit(pPort, baudRate, &emu.protocolHandle);
+	if (errorCode != SBG_NO_ERROR)
+	{
+		fprintf(stderr, "sbgEmulator: Unable to open %s\n", pPort);
+		return EXIT_FAILURE;
+	}
+
+	sbgProtocolSetTargetOutput(emu.protocolHandle, outputMode, outputMask);
+
+	emu.byteTimeNs = (baudRate > 0)?SBG_UART_BITS_PER_BYTE*1000000000ull/baudRate:0;
+	emu.loopPeriodNs = (uint64)(1e9/loopFrequency);
+	emu.magDivider = sbgEmulatorDivider(loopFrequency, magRate);
+	emu.baroDivider = sbgEmulatorDivider(loopFrequency, baroRate);
+	emu.gpsDivider = sbgEmulatorDivider(loopFrequency, gpsRate);
+
+	signal(SIGINT, sbgEmulatorStop);
+	signal(SIGTERM, sbgEmulatorStop);
+
+	fprintf(stderr, "sbgEmulator: serving %s, %u bauds, main loop %.1f Hz, mask 0x%X, %s endian %s%s\n", pPort, baudRate, loopFrequency,
+			outputMask, (outputMode & SBG_OUTPUT_MODE_LITTLE_ENDIAN)?"little":"big", (outputMode & SBG_OUTPUT_MODE_FIXED)?"fixed":"float",
+			emu.probe?", sample time probe":"");
+
+	emu.startTime = sbgGetTimeNs();
+	emu.sampleTime = emu.startTime;
+	nextLoop = emu.startTime;
+	stopTime = (duration > 0.0)?emu.startTime + (uint64)(duration*1e9):0;
+
+	while (!gStopRequested)
+	{
+		//
+		// Answer every complete command, a bounded number of parse errors per pass
+		//
+		for (i = 0; i < 64; i++)
+		{
+			errorCode = sbgProtocolReceive(emu.protocolHandle, &cmd, data, &size, sizeof(data));
+
+			if (errorCode == SBG_NO_ERROR)
+			{
+				sbgEmulatorHandleCommand(&emu, cmd, data, size);
+			}
+			else if (errorCode == SBG_NOT_READY)
+			{
+				break;
+			}
+		}
+
+		currentTime = sbgGetTimeNs();
+
+		if ( (stopTime) && (currentTime >= stopTime) )
+		{
+			break;
+		}
+
+		if (currentTime >= nextLoop)
+		{
+			//
+			// More than one iteration late: the line can't carry the outputs, drop them like the device does
+			//
+			// The status bit is held for a while, so the periodic status requests see intermittent drops
+			//
+			skipOutput = (currentTime >= nextLoop + emu.loopPeriodNs);
+			if (skipOutput)
+			{
+				emu.lastDropTime = currentTime;
+			}
+			emu.saturated = (emu.lastDropTime) && (currentTime - emu.lastDropTime < SBG_EMU_SATURATION_HOLD_NS);
+			emu.sampleTime = currentTime;
+			sbgEmulatorLoop(&emu, skipOutput);
+			emu.loopCount++;
+			nextLoop += emu.loopPeriodNs;
+
+			//
+			// Don't try to catch up after a long stall such as a suspended process
+			//
+			if (currentTime > nextLoop + 1000000000ull)
+			{
+				nextLoop = currentTime;
+			}
+		}
+		else
+		{
+			sbgDeviceWaitReadableUntil(emu.protocolHandle->serialHandle, nextLoop);
+		}
+	}
+
+	fprintf(stderr, "sbgEmulator: %llu frames sent, %llu dropped (line saturated), %llu commands\n",
+			(unsigned long long)emu.framesSent, (unsigned long long)emu.framesDropped, (unsigned long long)emu.commandsReceived);
+
+	sbgProtocolClose(emu.protocolHandle);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,393 @@
+/*!
+ *	\file		sbgParserBench.c
+ *
+ *	\brief		Measures how the frame parser recovers from a noisy link.<br>
+ *				A known stream of frames is replayed through the fault:// transport with several fault profiles.
+ *				For each profile the benchmark reports the ratio of recovered frames, the bytes the parser had to
+ *				discard or check again to resync, and the parse CPU time per frame.
+ */
+
+#include "../src/sbgCom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+//------------------------------------------------------------------------------//
+//- Benchmark definitions                                                      -//
+//------------------------------------------------------------------------------//
+
+#define SBG_BENCH_DEFAULT_FRAMES			(200000)				/*!< Number of frames in the generated stream. */
+#define SBG_BENCH_MIN_DATA_SIZE				(8)						/*!< Smallest data field, holds the sequence number. */
+#define SBG_BENCH_MAX_DATA_SIZE				(160)					/*!< Largest data field. */
+#define SBG_BENCH_FRAME_OVERHEAD			(8)						/*!< SYNC, STX, CMD, SIZE, CRC and ETX bytes. */
+
+/*!
+ *	A fault profile: fault:// options applied to the generated stream.
+ */
+typedef struct _SbgBenchProfile
+{
+	const char	*pName;						/*!< Name printed in the report. */
+	const char	*pOptions;					/*!< fault:// options, without the seed. */
+} SbgBenchProfile;
+
+/*!
+ *	Results of one profile.
+ */
+typedef struct _SbgBenchResult
+{
+	uint32					recoveredFrames;	/*!< Frames received with the content that has been sent. */
+	uint32					falseFrames;		/*!< Frames with a valid CRC but a wrong content. */
+	uint64					validCheckedBytes;	/*!< Bytes of the frames with a valid CRC that went through the CRC. */
+	uint64					parseNs;			/*!< Thread CPU time spent reading and parsing. */
+	uint64					readNs;				/*!< Thread CPU time spent reading the faulted stream alone. */
+	SbgProtocolParserStats	parserStats;		/*!< Parser statistics. */
+	SbgFaultStats			faultStats;			/*!< Injected faults. */
+} SbgBenchResult;
+
+static const SbgBenchProfile gProfiles[] =
+{
+	{"clean",			""},
+	{"fragmented",		"frag=16"},
+	{"bytewise",		"frag=1"},
+	{"flip 1e-6",		"frag=64&flip=1e-6"},
+	{"flip 1e-5",		"frag=64&flip=1e-5"},
+	{"flip 1e-4",		"frag=64&flip=1e-4"},
+	{"drop 1e-4",		"frag=64&drop=1e-4"},
+	{"dup 1e-4",		"frag=64&dup=1e-4"},
+	{"bursts 1e-4",		"frag=64&burst=1e-4&burstlen=32"},
+	{"bursts 1e-3",		"frag=64&burst=1e-3&burstlen=64"},
+	{"motor noise",		"frag=64&flip=1e-5&drop=1e-5&dup=1e-5&burst=1e-4&burstlen=32"}
+};
+
+//------------------------------------------------------------------------------//
+//- Stream                                                                     -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Returns the data field size of a frame.
+ *	\param[in]	sequence	Frame sequence number.
+ *	\return					Data field size.
+ */
+static uint16 sbgBenchDataSize(uint32 sequence)
+{
+	return (uint16)(SBG_BENCH_MIN_DATA_SIZE + (sequence*7919u) % (SBG_BENCH_MAX_DATA_SIZE - SBG_BENCH_MIN_DATA_SIZE + 1));
+}
+
+/*!
+ *	Fill the data field of a frame: its sequence number then a pattern derived from it.<br>
+ *	The pattern contains SYNC and STX chars like real float outputs do.
+ *	\param[in]	sequence	Frame sequence number.
+ *	\param[out]	pData		Data field.
+ *	\return					Data field size.
+ */
+static uint16 sbgBenchFillData(uint32 sequence, uint8 *pData)
+{
+	uint16 size = sbgBenchDataSize(sequence);
+	uint16 i;
+
+	pData[0] = (uint8)(sequence);
+	pData[1] = (uint8)(sequence >> 8);
+	pData[2] = (uint8)(sequence >> 16);
+	pData[3] = (uint8)(sequence >> 24);
+
+	for (i = 4; i < size; i++)
+	{
+		pData[i] = (uint8)((sequence*2654435761u) >> (i & 15)) ^ (uint8)(i*37);
+	}
+
+	return size;
+}
+
+/*!
+ *	Write the stream of frames to a raw file.
+ *	\param[in]	pFileName	File to create.
+ *	\param[in]	numFrames	Number of frames.
+ *	\return					Number of bytes written, 0 on error.
+ */
+static uint64 sbgBenchWriteStream(const char *pFileName, uint32 numFrames)
+{
+	uint8 frame[SBG_BENCH_MAX_DATA_SIZE + SBG_BENCH_FRAME_OVERHEAD];
+	uint64 totalSize = 0;
+	uint16 size;
+	uint16 crc;
+	uint32 i;
+	FILE *pFile;
+
+	pFile = fopen(pFileName, "wb");
+
+	if (!pFile)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < numFrames; i++)
+	{
+		size = sbgBenchFillData(i, frame + 5);
+		frame[0] = SBG_SYNC;
+		frame[1] = SBG_STX;
+		frame[2] = SBG_CONTINUOUS_DEFAULT_OUTPUT;
+		frame[3] = (uint8)(size >> 8);
+		frame[4] = (uint8)(size);
+		crc = sbgProtocolCalcCRC(frame + 2, size + 3);
+		frame[size + 5] = (uint8)(crc >> 8);
+		frame[size + 6] = (uint8)(crc);
+		frame[size + 7] = SBG_ETC;
+
+		if (fwrite(frame, 1, size + SBG_BENCH_FRAME_OVERHEAD, pFile) != (size_t)(size + SBG_BENCH_FRAME_OVERHEAD))
+		{
+			fclose(pFile);
+			return 0;
+		}
+		totalSize += size + SBG_BENCH_FRAME_OVERHEAD;
+	}
+
+	fclose(pFile);
+
+	return totalSize;
+}
+
+//------------------------------------------------------------------------------//
+//- Measures                                                                   -//
+//------------------------------------------------------------------------------//
+
+/*!
+ *	Returns the CPU time consumed by the calling thread.
+ *	\return					CPU time in ns.
+ */
+static uint64 sbgBenchCpuTimeNs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+	return (uint64)now.tv_sec*1000000000ull + (uint64)now.tv_nsec;
+}
+
+/*!
+ *	Read the whole faulted stream without parsing it, to subtract the cost of the injection.
+ *	\param[in]	pUri		fault:// URI.
+ *	\param[out]	pResult		Result, readNs is filled.
+ *	\return					SBG_NO_ERROR if the stream has been read.
+ */
+static SbgErrorCode sbgBenchRead(const char *pUri, SbgBenchResult *pResult)
+{
+	SbgDeviceHandle deviceHandle;
+	SbgErrorCode errorCode;
+	uint8 buffer[SBG_RX_BUFFER_SIZE];
+	uint32 numBytesRead;
+	uint64 startTime;
+
+	errorCode = sbgDeviceOpen(pUri, 0, &deviceHandle);
+
+	if (errorCode != SBG_NO_ERROR)
+	{
+		return errorCode;
+	}
+
+	startTime = sbgBenchCpuTimeNs();
+
+	for (;;)
+	{
+		if ( (sbgDeviceRead(deviceHandle, buffer, sizeof(buffer), &numBytesRead) != SBG_NO_ERROR) || (numBytesRead == 0) )
+		{
+			if (sbgDeviceWaitReadableUntil(deviceHandle, 0) != SBG_NO_ERROR)
+			{
+				break;
+			}
+		}
+	}
+
+	pResult->readNs = sbgBenchCpuTimeNs() - startTime;
+
+	return sbgDeviceClose(deviceHandle);
+}
+
+/*!
+ *	Parse the whole faulted stream and check each received frame against the sent one.
+ *	\param[in]	pUri		fault:// URI.
+ *	\param[in]	numFrames	Number of frames in the stream.
+ *	\param[in]	pReceived	Scratch flags, one per frame.
+ *	\param[out]	pResult		Result.
+ *	\return					SBG_NO_ERROR if the stream has been parsed.
+ */
+static SbgErrorCode sbgBenchParse(const char *pUri, uint32 numFrames, uint8 *pReceived, SbgBenchResult *pResult)
+{
+	SbgProtocolHandle protocolHandle;
+	SbgErrorCode errorCode;
+	uint8 data[SBG_MAX_DATA_LENGTH];
+	uint8 expected[SBG_BENCH_MAX_DATA_SIZE];
+	uint64 startTime;
+	uint32 sequence;
+	uint16 size;
+	uint8 cmd;
+
+	errorCode = sbgProtocolInit(pUri, 0, &protocolHandle);
+
+	if (errorCode != SBG_NO_ERROR)
+	{
+		return errorCode;
+	}
+
+	memset(pReceived, 0, numFrames);
+	startTime = sbgBenchCpuTimeNs();
+
+	for (;;)
+	{
+		errorCode = sbgProtocolReceive(protocolHandle, &cmd, data, &size, sizeof(data));
+
+		if (errorCode == SBG_NO_ERROR)
+		{
+			pResult->validCheckedBytes += size + 3;
+
+			//
+			// A frame counts as recovered only once and only with the exact content that has been sent
+			//
+			sequence = (size >= 4)?((uint32)data[0] | ((uint32)data[1]<<8) | ((uint32)data[2]<<16) | ((uint32)data[3]<<24)):numFrames;
+
+			if ( (cmd == SBG_CONTINUOUS_DEFAULT_OUTPUT) && (sequence < numFrames) && (!pReceived[sequence]) &&
+				 (size == sbgBenchFillData(sequence, expected)) && (memcmp(data, expected, size) == 0) )
+			{
+				pReceived[sequence] = 1;
+				pResult->recoveredFrames++;
+			}
+			else
+			{
+				pResult->falseFrames++;
+			}
+		}
+		else if (errorCode == SBG_NOT_READY)
+		{
+			if (sbgDeviceWaitReadableUntil(protocolHandle->serialHandle, 0) != SBG_NO_ERROR)
+			{
+				break;
+			}
+		}
+	}
+
+	pResult->parseNs = sbgBenchCpuTimeNs() - startTime;
+
+	sbgProtocolGetParserStats(protocolHandle, &pResult->parserStats);
+	sbgDeviceGetFaultStats(protocolHandle->serialHandle, &pResult->faultStats);
+
+	return sbgProtocolClose(protocolHandle);
+}
+
+/*!
+ *	Print the command line options.
+ *	\param[in]	pName		Program name.
+ */
+static void sbgBenchUsage(const char *pName)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -n, --frames N        number of frames in the generated stream (default %u)\n"
+		"  -s, --seed N          fault injection seed (default 1)\n"
+		"  -f, --fault OPTIONS   run a single profile with these fault:// options, e.g. frag=8&flip=1e-5\n",
+		pName, SBG_BENCH_DEFAULT_FRAMES);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] =
+	{
+		{"frames",	required_argument,	NULL, 'n'},
+		{"seed",	required_argument,	NULL, 's'},
+		{"fault",	required_argument,	NULL, 'f'},
+		{"help",	no_argument,		NULL, 'h'},
+		{NULL,		0,					NULL, 0}
+	};
+	SbgBenchProfile customProfile;
+	const SbgBenchProfile *pProfiles = gProfiles;
+	uint32 numProfiles = sizeof(gProfiles)/sizeof(gProfiles[0]);
+	uint32 numFrames = SBG_BENCH_DEFAULT_FRAMES;
+	unsigned long long seed = 1;
+	char fileName[] = "/tmp/sbgParserBenchXXXXXX";
+	char uri[512];
+	SbgBenchResult result;
+	uint64 streamSize;
+	uint64 resyncBytes;
+	uint32 lostFrames;
+	uint8 *pReceived;
+	uint32 i;
+	int fileId;
+	int option;
+
+	while ((option = getopt_long(argc, argv, "n:s:f:h", options, NULL)) != -1)
+	{
+		switch (option)
+		{
+		case 'n': numFrames = (uint32)strtoul(optarg, NULL, 0); break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'f':
+			customProfile.pName = "custom";
+			customProfile.pOptions = optarg;
+			pProfiles = &customProfile;
+			numProfiles = 1;
+			break;
+		default:
+			sbgBenchUsage(argv[0]);
+			return (option == 'h')?EXIT_SUCCESS:EXIT_FAILURE;
+		}
+	}
+
+	fileId = mkstemp(fileName);
+	pReceived = (uint8*)malloc(numFrames ? numFrames : 1);
+
+	if ( (fileId == -1) || (!pReceived) || (numFrames == 0) )
+	{
+		fprintf(stderr, "sbgParserBench: Unable to create the stream\n");
+		return EXIT_FAILURE;
+	}
+	close(fileId);
+
+	streamSize = sbgBenchWriteStream(fileName, numFrames);
+
+	if (streamSize == 0)
+	{
+		fprintf(stderr, "sbgParserBench: Unable to write %s\n", fileName);
+		unlink(fileName);
+		return EXIT_FAILURE;
+	}
+
+	printf("%u frames, %llu bytes, seed %llu\n", numFrames, (unsigned long long)streamSize, seed);
+	printf("%-12s %10s %8s %8s %9s %9s %9s %10s %10s\n", "profile", "recovered", "lost", "false", "faults", "resync B", "B/lost", "ns/frame", "MB/s");
+
+	for (i = 0; i < numProfiles; i++)
+	{
+		memset(&result, 0, sizeof(result));
+
+		snprintf(uri, sizeof(uri), "fault://file://%s?speed=0#seed=%llu%s%s", fileName, seed,
+				 (pProfiles[i].pOptions[0])?"&":"", pProfiles[i].pOptions);
+
+		if ( (sbgBenchRead(uri, &result) != SBG_NO_ERROR) || (sbgBenchParse(uri, numFrames, pReceived, &result) != SBG_NO_ERROR) )
+		{
+			fprintf(stderr, "sbgParserBench: Unable to open %s\n", uri);
+			break;
+		}
+
+		//
+		// Resync cost: bytes thrown away plus bytes whose CRC has been computed for nothing
+		//
+		resyncBytes = result.parserStats.bytesDiscarded + result.parserStats.bytesChecked - result.validCheckedBytes;
+		lostFrames = numFrames - result.recoveredFrames;
+
+		printf("%-12s %9.4f%% %8u %8u %9llu %9llu %9.1f %10.1f %10.1f\n", pProfiles[i].pName,
+			   100.0*result.recoveredFrames/numFrames, lostFrames, result.falseFrames,
+			   (unsigned long long)(result.faultStats.bitsFlipped + result.faultStats.bytesDropped + result.faultStats.bytesDuplicated + result.faultStats.bursts),
+			   (unsigned long long)resyncBytes, (lostFrames)?(double)resyncBytes/lostFrames:0.0,
+			   (result.parseNs > result.readNs)?(double)(result.parseNs - result.readNs)/numFrames:0.0,
+			   (result.parseNs > result.readNs)?(double)result.faultStats.bytesDelivered*1e3/(result.parseNs - result.readNs):0.0);
+	}
+
+	printf("\nrecovered: frames received with their exact content, false: valid CRC but wrong content\n"
+		   "resync B: bytes discarded plus bytes checked again after a false start of frame\n"
+		   "ns/frame, MB/s: parse CPU time, the fault injection cost measured alone is subtracted\n");
+
+	free(pReceived);
+	unlink(fileName);
+
+	return EXIT_SUCCESS;
+}
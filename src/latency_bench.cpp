@@ -0,0 +1,253 @@
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <sensor_msgs/msg/imu.hpp>
+#include <sensor_msgs/msg/nav_sat_fix.hpp>
+#include "sbg/latency_histogram.hpp"
+
+using namespace std;
+
+namespace sbg {
+
+// Mide la latencia desde cada muestra del dispositivo hasta el callback de un suscriptor de imu, imu_ned y gps.
+// reference probe: sbgEmulator --probe lleva en cada frame el instante en que calculo la muestra (reloj
+//                  monotono, el mismo que steady_clock), en los giroscopos y en la primera posicion; en
+//                  polling la respuesta lleva la ultima muestra, asi que tambien cuenta su antiguedad
+// reference stamp: cualquier fuente (captura, dispositivo real), se mide desde header.stamp; con
+//                  time_source host es la llegada del primer byte reconstruida por sbgCom
+// Como componente (sbg::LatencyBench) en el contenedor del nodo mide la ruta intra-proceso.
+class LatencyBench : public rclcpp::Node {
+private:
+  struct TopicStats {
+    string name;
+    sbg::LatencyHistogram histogram;
+    uint64_t dropped = 0;
+    uint64_t repeated = 0;        // la misma muestra publicada otra vez (polling mas rapido que el dispositivo)
+    int64_t last_send_ns = 0;
+  };
+
+  string reference = "probe";
+  double expected_rate = 0.0;   // Hz de las muestras, 0: no se cuentan perdidas
+  double duration = 10.0;       // s, 0: hasta Ctrl-C
+  double warmup = 1.0;          // s descartados al principio
+  double report_period = 1.0;   // s entre informes parciales, 0: solo el final
+  int qos_depth = 10;
+  string label = "";            // identifica la ejecucion en el CSV, p. ej. streaming@200
+  string output = "";           // CSV al que se anaden los resultados, vacio: no se escribe
+  bool use_probe_ = true;
+
+  TopicStats imu_, imu_ned_, gps_;
+  // Con probe, imu no lleva el instante de envio: se empareja con imu_ned por header.stamp,
+  // se publican juntos pero los callbacks pueden llegar en cualquier orden
+  map<int64_t, int64_t> imu_ned_send_ns_;    // stamp -> envio
+  map<int64_t, int64_t> imu_pending_ns_;     // stamp -> callback de imu aun sin su imu_ned
+  static constexpr size_t MAX_PENDING = 256;
+  uint64_t unmatched_ = 0;
+
+  int64_t start_ns_ = 0;         // primera muestra, el calentamiento y la duracion cuentan desde aqui
+  bool finished_ = false;
+
+  rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr imu_sub;
+  rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr imu_ned_sub;
+  rclcpp::Subscription<sensor_msgs::msg::NavSatFix>::SharedPtr gps_sub;
+  rclcpp::TimerBase::SharedPtr report_timer_;
+  rclcpp::TimerBase::SharedPtr stop_timer_;
+
+  static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static int64_t stampNs(const builtin_interfaces::msg::Time &stamp) {
+    return int64_t(stamp.sec) * 1000000000 + stamp.nanosec;
+  }
+
+  // Deshace lo que escribe sbgEmulatorEmbedProbe: 24 bits por giroscopo, los bajos primero
+  static int64_t probeNs(const geometry_msgs::msg::Vector3 &gyroscopes) {
+    return int64_t(uint64_t(gyroscopes.x) | (uint64_t(gyroscopes.y) << 24) | (uint64_t(gyroscopes.z) << 48));
+  }
+
+  // Latencia desde el reloj de referencia: monotono con probe, el del nodo con stamp
+  int64_t callbackNs() {
+    return use_probe_ ? steadyNs() : this->now().nanoseconds();
+  }
+
+  void record(TopicStats &stats, int64_t send_ns, int64_t callback_ns) {
+    if (finished_) return;
+    if (start_ns_ == 0) start_ns_ = steadyNs();
+    if (steadyNs() - start_ns_ < int64_t(warmup * 1e9)) {
+      stats.last_send_ns = send_ns;
+      return;
+    }
+
+    // Los huecos entre envios consecutivos, en periodos esperados, son muestras que no han llegado
+    if (send_ns == stats.last_send_ns) stats.repeated++;
+    if (expected_rate > 0.0 && stats.last_send_ns != 0 && send_ns > stats.last_send_ns) {
+      const int64_t missing = llround(double(send_ns - stats.last_send_ns) * expected_rate / 1e9) - 1;
+      if (missing > 0) stats.dropped += missing;
+    }
+    stats.last_send_ns = send_ns;
+    stats.histogram.record(callback_ns - send_ns);
+  }
+
+  void onImu(const sensor_msgs::msg::Imu::ConstSharedPtr msg) {
+    const int64_t callback_ns = callbackNs();
+    const int64_t stamp_ns = stampNs(msg->header.stamp);
+    if (!use_probe_) {
+      record(imu_, stamp_ns, callback_ns);
+      return;
+    }
+    auto send = imu_ned_send_ns_.find(stamp_ns);
+    if (send != imu_ned_send_ns_.end()) {
+      record(imu_, send->second, callback_ns);
+      imu_ned_send_ns_.erase(imu_ned_send_ns_.begin(), std::next(send));
+      return;
+    }
+    imu_pending_ns_[stamp_ns] = callback_ns;
+    trimPending(imu_pending_ns_);
+  }
+
+  void onImuNed(const sensor_msgs::msg::Imu::ConstSharedPtr msg) {
+    const int64_t callback_ns = callbackNs();
+    const int64_t stamp_ns = stampNs(msg->header.stamp);
+    const int64_t send_ns = use_probe_ ? probeNs(msg->angular_velocity) : stamp_ns;
+    record(imu_ned_, send_ns, callback_ns);
+    if (!use_probe_) return;
+
+    auto pending = imu_pending_ns_.find(stamp_ns);
+    if (pending != imu_pending_ns_.end()) {
+      record(imu_, send_ns, pending->second);
+      imu_pending_ns_.erase(imu_pending_ns_.begin(), std::next(pending));
+      return;
+    }
+    imu_ned_send_ns_[stamp_ns] = send_ns;
+    trimPending(imu_ned_send_ns_);
+  }
+
+  void onGps(const sensor_msgs::msg::NavSatFix::ConstSharedPtr msg) {
+    const int64_t callback_ns = callbackNs();
+    const int64_t send_ns = use_probe_ ? int64_t(msg->latitude) : stampNs(msg->header.stamp);
+    record(gps_, send_ns, callback_ns);
+  }
+
+  // Las entradas que nunca se emparejan (la otra muestra se perdio) no deben crecer sin limite
+  void trimPending(map<int64_t, int64_t> &pending) {
+    while (pending.size() > MAX_PENDING) {
+      pending.erase(pending.begin());
+      unmatched_++;
+    }
+  }
+
+  static double us(int64_t ns) {return double(ns) / 1000.0;}
+
+  void printStats(const TopicStats &stats) {
+    const sbg::LatencyHistogram &h = stats.histogram;
+    const double lost = h.count() + stats.dropped ? 100.0 * stats.dropped / double(h.count() + stats.dropped) : 0.0;
+    printf("%-8s %9" PRIu64 " %8" PRIu64 " %6.2f%% %8" PRIu64 " %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+           stats.name.c_str(), h.count(), stats.dropped, lost, stats.repeated, us(h.min()), us(h.percentile(50.0)),
+           us(h.percentile(90.0)), us(h.percentile(99.0)), us(h.percentile(99.9)), us(h.max()), h.mean() / 1000.0);
+  }
+
+  void printReport(const char *title) {
+    printf("%s%s%s (reference %s, latencies in us)\n", title, label.empty() ? "" : " ", label.c_str(), reference.c_str());
+    printf("%-8s %9s %8s %7s %8s %9s %9s %9s %9s %9s %9s %9s\n",
+           "topic", "samples", "dropped", "lost", "repeated", "min", "p50", "p90", "p99", "p99.9", "max", "mean");
+    printStats(imu_);
+    printStats(imu_ned_);
+    printStats(gps_);
+    if (unmatched_)
+      printf("%" PRIu64 " imu samples without their imu_ned pair\n", unmatched_);
+    fflush(stdout);
+  }
+
+  void writeCsv() {
+    if (output.empty()) return;
+    FILE *file = fopen(output.c_str(), "a");
+    if (!file) {
+      RCLCPP_ERROR(this->get_logger(), "Unable to open %s", output.c_str());
+      return;
+    }
+    if (ftell(file) == 0)
+      fprintf(file, "label,reference,expected_rate,topic,samples,dropped,repeated,min_us,p50_us,p90_us,p99_us,p999_us,max_us,mean_us\n");
+    for (const TopicStats *stats : {&imu_, &imu_ned_, &gps_}) {
+      const sbg::LatencyHistogram &h = stats->histogram;
+      fprintf(file, "%s,%s,%g,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+              label.c_str(), reference.c_str(), expected_rate, stats->name.c_str(), h.count(), stats->dropped, stats->repeated,
+              us(h.min()), us(h.percentile(50.0)), us(h.percentile(90.0)), us(h.percentile(99.0)),
+              us(h.percentile(99.9)), us(h.max()), h.mean() / 1000.0);
+    }
+    fclose(file);
+  }
+
+  void checkDuration() {
+    if (start_ns_ != 0 && steadyNs() - start_ns_ >= int64_t((warmup + duration) * 1e9))
+      finish();
+  }
+
+  void finish() {
+    if (finished_) return;
+    finished_ = true;
+    printReport("Final");
+    writeCsv();
+    // Tambien cierra el contenedor si se ha cargado como componente: la medida ha terminado
+    rclcpp::shutdown();
+  }
+
+public:
+  explicit LatencyBench(const rclcpp::NodeOptions &options) : Node("sbg_latency_bench", options) {
+    reference = this->declare_parameter<string>("reference", reference);
+    expected_rate = this->declare_parameter<double>("expected_rate", expected_rate);
+    duration = this->declare_parameter<double>("duration", duration);
+    warmup = this->declare_parameter<double>("warmup", warmup);
+    report_period = this->declare_parameter<double>("report_period", report_period);
+    qos_depth = this->declare_parameter<int>("qos_depth", qos_depth);
+    label = this->declare_parameter<string>("label", label);
+    output = this->declare_parameter<string>("output", output);
+
+    if (reference != "probe" && reference != "stamp") {
+      RCLCPP_WARN(this->get_logger(), "Unknown reference '%s', using probe", reference.c_str());
+      reference = "probe";
+    }
+    use_probe_ = (reference == "probe");
+
+    imu_.name = "imu";
+    imu_ned_.name = "imu_ned";
+    gps_.name = "gps";
+
+    imu_sub = this->create_subscription<sensor_msgs::msg::Imu>(
+      "imu", qos_depth, std::bind(&LatencyBench::onImu, this, std::placeholders::_1));
+    imu_ned_sub = this->create_subscription<sensor_msgs::msg::Imu>(
+      "imu_ned", qos_depth, std::bind(&LatencyBench::onImuNed, this, std::placeholders::_1));
+    gps_sub = this->create_subscription<sensor_msgs::msg::NavSatFix>(
+      "gps", qos_depth, std::bind(&LatencyBench::onGps, this, std::placeholders::_1));
+
+    if (report_period > 0.0)
+      report_timer_ = this->create_wall_timer(std::chrono::duration<double>(report_period),
+                                              [this] { if (!finished_) printReport("Partial"); });
+    if (duration > 0.0)
+      stop_timer_ = this->create_wall_timer(std::chrono::milliseconds(100), std::bind(&LatencyBench::checkDuration, this));
+
+    RCLCPP_INFO(this->get_logger(), "Measuring imu, imu_ned and gps latency (reference %s)", reference.c_str());
+  }
+
+  ~LatencyBench() {
+    // Ctrl-C antes de acabar: se informa de lo medido hasta entonces
+    if (!finished_) {
+      finished_ = true;
+      printReport("Final");
+      writeCsv();
+    }
+  }
+};
+
+}  // namespace sbg
+
+// El ejecutable sbg_latency_bench lo genera rclcpp_components_register_node
+RCLCPP_COMPONENTS_REGISTER_NODE(sbg::LatencyBench)
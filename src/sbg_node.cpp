@@ -1,16 +1,41 @@
 #include <rclcpp/rclcpp.hpp>
 #include <unistd.h> // para Linux 
 #include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 #include <sbgCom/sbgCom.h>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <rosidl_runtime_cpp/traits.hpp>
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
+#include <sensor_msgs/msg/fluid_pressure.hpp>
 #include <sensor_msgs/msg/imu.hpp>
+#include <sensor_msgs/msg/magnetic_field.hpp>
 #include <sensor_msgs/msg/nav_sat_fix.hpp>
 #include <sensor_msgs/msg/nav_sat_status.hpp>
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2/LinearMath/Matrix3x3.h>
 #include <tf2/LinearMath/Vector3.h>
+#include "sbg/clock_estimator.hpp"
+#include "sbg/spsc_queue.hpp"
+#include "sbg/static_output_decoder.hpp"
 
 using namespace std;
 
+namespace sbg {
+
+// Componente de rclcpp_components (sbg::SBGNode): cargado en el mismo contenedor que sus consumidores y con
+// use_intra_process_comms, las muestras les llegan sin serializar ni copiar
 class SBGNode : public rclcpp::Node {
 private:
   string port = "/dev/sbg";
@@ -19,9 +44,154 @@ private:
   string imu_frame_ned_id = imu_frame_id + "_ned";
   string gps_frame_id = "gps";
   int frequency = 500;
+  // streaming: publica desde los frames continuos/disparados en cuanto llegan
+  // polling:   diseño anterior, una peticion sbgGetDefaultOutput por tick
+  // reader_thread: hilo dedicado bloqueado en el puerto serie, fuera del executor
+  string pipeline_mode = "streaming";
+  std::atomic<bool> streaming_{false};
+  // device: sella con timeSinceReset llevado al reloj del host por el estimador de reloj
+  // host:    sella con la hora de llegada de la muestra
+  string time_source = "device";
+  bool use_device_clock_ = true;
+  // Adaptadores USB-serie: ASYNC_LOW_LATENCY y latency timer (FTDI acumula hasta 16 ms por defecto)
+  bool low_latency = false;
+  int latency_timer_ms = 1;     // 0: no se cambia
+  SbgDeviceLatencyInfo latency_info_{};
+  // port file://captura.bin[?speed=x]: se reproduce una captura, no hay dispositivo al que configurar
+  bool replay_ = false;
+  // Grabacion del flujo crudo del puerto en una captura reproducible con file://
+  string record_path = "";      // vacio: no se graba
+  bool record_direct_io = false;
+  SbgCaptureHandle capture_handle_ = SBG_INVALID_CAPTURE_HANDLE;
+  // Mensajes prestados por el middleware (borrow_loaned_message) cuando el RMW lo admite, solo para
+  // tipos de tamano fijo: Imu y NavSatFix llevan el std::string de frame_id y nunca se prestan
+  bool loaned_messages = false;
+  std::atomic<uint64_t> loaned_publishes_{0};
+  std::atomic<uint64_t> owned_publishes_{0};
+  // continuous: una trama con todos los campos en cada ciclo del bucle principal
+  // triggered:  una condicion de disparo por clase de datos, cada una solo cuando hay un dato nuevo
+  string output_routing = "continuous";
+  bool triggered_ = false;
+  // Presupuesto del enlace serie: bytes/s de las salidas frente a los que caben al baud rate
+  // warn: avisa si no cabe, refuse: no arranca, divider: baja la frecuencia de salida hasta que cabe
+  string bandwidth_policy = "warn";
+  double bandwidth_max_load = SBG_BANDWIDTH_DEFAULT_MAX_LOAD;
+  double device_loop_rate = 100.0;    // bucle principal del dispositivo, Hz
+  double mag_rate = 100.0;            // ritmo de SBG_TRIGGER_MAGNETOMETERS, Hz
+  double baro_rate = 25.0;            // ritmo de SBG_TRIGGER_BAROMETER, Hz
+  double gps_rate = 4.0;              // ritmo de cada disparo del GPS, Hz
+  uint8 output_divider_ = 1;
+  SbgBandwidthReport bandwidth_{};
+  // Bit SBG_PROTOCOL_OUTPUT_STATUS_MASK del deviceStatus que llega en cada trama; saturation_events_ cuenta
+  // los pasos de no saturado a saturado
+  std::atomic<bool> output_saturated_{false};
+  std::atomic<uint64_t> saturation_events_{0};
+
+  // Parametros del hilo lector (reader_thread)
+  int reader_cpu = -1;          // -1: sin afinidad
+  int reader_priority = 0;      // 0: SCHED_OTHER, 1-99: SCHED_FIFO
+  bool reader_mlockall = false;
+  int reader_queue_size = 64;
+
+  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/Imu.html
+  //orientation, angular_velocity, linear_acceleration
+  static constexpr uint32 IMU_OUTPUT_MASK = SBG_OUTPUT_MATRIX |
+                                            SBG_OUTPUT_GYROSCOPES |
+                                            SBG_OUTPUT_ACCELEROMETERS;
+
+  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/NavSatStatus.html
+  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/NavSatFix.html
+  static constexpr uint32 GPS_OUTPUT_MASK = SBG_OUTPUT_POSITION |
+                                            SBG_OUTPUT_NAV_ACCURACY |
+                                            SBG_OUTPUT_GPS_INFO;
+
+  // Reloj del dispositivo para sellar las muestras
+  static constexpr uint32 TIME_OUTPUT_MASK = SBG_OUTPUT_TIME_SINCE_RESET;
+
+  // Estado del dispositivo, para saber si su buffer de salida se satura sin consultarlo aparte
+  static constexpr uint32 STATUS_OUTPUT_MASK = SBG_OUTPUT_DEVICE_STATUS;
+
+  // Campos que lleva toda trama, sea cual sea la mascara negociada
+  static constexpr uint32 COMMON_OUTPUT_MASK = TIME_OUTPUT_MASK | STATUS_OUTPUT_MASK;
+
+  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/MagneticField.html
+  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/FluidPressure.html
+  static constexpr uint32 MAG_OUTPUT_MASK = SBG_OUTPUT_MAGNETOMETERS;
+  static constexpr uint32 BARO_OUTPUT_MASK = SBG_OUTPUT_BARO_PRESSURE;
+
+  // Mascara por defecto del modo continuo
+  static constexpr uint32 OUTPUT_MASK = IMU_OUTPUT_MASK |
+                                        GPS_OUTPUT_MASK |
+                                        COMMON_OUTPUT_MASK;
+
+  // Todos los campos que publica el nodo, magnetometros y barometro solo se piden si tienen suscriptores
+  // o en modo triggered, a su propio ritmo
+  static constexpr uint32 PUBLISHED_OUTPUT_MASK = OUTPUT_MASK | MAG_OUTPUT_MASK | BARO_OUTPUT_MASK;
+
+  // Condiciones de disparo del modo triggered, una por clase de datos (condId = indice, el dispositivo
+  // admite 4). Cada trama lleva tambien COMMON_OUTPUT_MASK para sellarla y vigilar la saturacion.
+  struct TriggerRoute {
+    const char *name;
+    uint32 triggers;
+    uint32 fields;
+  };
+  static constexpr TriggerRoute TRIGGER_ROUTES[] = {
+    {"imu", SBG_TRIGGER_MAIN_LOOP_DIVIDER, IMU_OUTPUT_MASK},
+    {"gps", SBG_TRIGGER_GPS_POSITION | SBG_TRIGGER_GPS_VELOCITY, GPS_OUTPUT_MASK},
+    {"mag", SBG_TRIGGER_MAGNETOMETERS, MAG_OUTPUT_MASK},
+    {"baro", SBG_TRIGGER_BAROMETER, BARO_OUTPUT_MASK},
+  };
+
+  // Decodificador generado para los campos publicados, las tramas que no reconoce pasan por la ruta generica de sbgCom
+  using OutputDecoder = sbg::StaticOutputDecoder<PUBLISHED_OUTPUT_MASK, sbg::kNativeOutputMode>;
+  using Output = OutputDecoder::Output;
+
+  // Mascaras que puede negociar el modo continuo: TIME_OUTPUT_MASK mas cualquier combinacion de las clases.
+  // STATUS_OUTPUT_MASK es opcional para seguir decodificando capturas grabadas sin el.
+  static constexpr uint32 negotiableMask(size_t classes) {
+    return TIME_OUTPUT_MASK | ((classes & 1) ? IMU_OUTPUT_MASK : 0) | ((classes & 2) ? GPS_OUTPUT_MASK : 0) |
+           ((classes & 4) ? MAG_OUTPUT_MASK : 0) | ((classes & 8) ? BARO_OUTPUT_MASK : 0) |
+           ((classes & 16) ? STATUS_OUTPUT_MASK : 0);
+  }
+
+  template <size_t... I>
+  static bool decodeNegotiated(uint8 mode, uint32 mask, const uint8 *pBuffer, uint16 size, Output &output,
+                               std::index_sequence<I...>) {
+    return OutputDecoder::tryDecodeSubset<negotiableMask(I)...>(mode, mask, pBuffer, size, output);
+  }
+
+  // Mascara negociada segun los suscriptores: solo se piden al dispositivo los campos de los topics
+  // con suscriptores, COMMON_OUTPUT_MASK siempre para el estimador de reloj y la saturacion
+  bool dynamic_output_mask = true;
+  double output_mask_release_s = 2.0;     // tiempo sin suscriptores antes de dejar de pedir sus campos
+  uint32 output_mask_ = OUTPUT_MASK;
+  // Mascara enviada con sbgSetDefaultOutputMask cuyo ACK aun no ha llegado (0 si ninguna): el dispositivo
+  // ya puede enviar tramas con ella mientras sbgCom sigue con la anterior en targetDefaultOutputMask
+  std::atomic<uint32> pending_output_mask_{0};
+  std::chrono::steady_clock::time_point release_since_{};
+  rclcpp::TimerBase::SharedPtr output_mask_timer_;
+
+  // Muestra decodificada con el instante en que se recibio, del hilo lector al de publicacion
+  struct Sample {
+    Output output;
+    rclcpp::Time stamp;
+  };
+  std::unique_ptr<sbg::SpscQueue<Sample>> sample_queue_;
+  std::thread reader_thread_;
+  std::thread publisher_thread_;
+  std::atomic<bool> reader_running_{false};
+  std::atomic<uint64_t> dropped_samples_{0};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  // Serializa el acceso al handle entre el hilo lector y los comandos de configuracion
+  std::mutex protocol_mutex_;
+
+  // Relacion entre timeSinceReset y el reloj monotono del host, se actualiza con cada muestra
+  sbg::ClockEstimator clock_estimator_;
+  std::mutex clock_mutex_;
 
   SbgOutput pOutput;
-  SbgProtocolHandle protocol_handle_; 
+  SbgProtocolHandle protocol_handle_ = SBG_INVALID_PROTOCOL_HANDLE;
   SbgErrorCode last_error_;
 
   tf2::Vector3 _vec;
@@ -33,51 +203,548 @@ private:
 
   double gravity = 9.81;
 
-  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/Imu.html
-  //orientation, angular_velocity, linear_acceleration
   const double IMU_COVARIANCES[3] = {0.0174532925, 0.00872664625, 0.049};
-  std::shared_ptr<sensor_msgs::msg::Imu> imu_msg = std::make_shared<sensor_msgs::msg::Imu>();
-  std::shared_ptr<sensor_msgs::msg::Imu> imu_ned_msg = std::make_shared<sensor_msgs::msg::Imu>();
-  const int IMU_OUTPUT_MASK = SBG_OUTPUT_MATRIX | 
-                              SBG_OUTPUT_GYROSCOPES |
-                              SBG_OUTPUT_ACCELEROMETERS;
-
-  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/NavSatStatus.html
-  // https://docs.ros2.org/foxy/api/sensor_msgs/msg/NavSatFix.html
-  std::shared_ptr<sensor_msgs::msg::NavSatFix> gps_msg = std::make_shared<sensor_msgs::msg::NavSatFix>();
-  const int GPS_OUTPUT_MASK = SBG_OUTPUT_POSITION |
-                              SBG_OUTPUT_NAV_ACCURACY |
-                              SBG_OUTPUT_GPS_INFO;  
-
-  const int OUTPUT_MASK = IMU_OUTPUT_MASK |
-                          GPS_OUTPUT_MASK;
+  // Plantillas con los campos constantes (frame_id, covarianzas): cada muestra se publica en un
+  // unique_ptr nuevo que pasa al suscriptor, sin copias si esta en el mismo proceso
+  sensor_msgs::msg::Imu imu_template_;
+  sensor_msgs::msg::Imu imu_ned_template_;
+  sensor_msgs::msg::NavSatFix gps_template_;
+  sensor_msgs::msg::MagneticField mag_template_;
+  sensor_msgs::msg::FluidPressure pressure_template_;
 
   rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_pub;
   rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_ned_pub;
   rclcpp::Publisher<sensor_msgs::msg::NavSatFix>::SharedPtr gps_pub;
+  rclcpp::Publisher<sensor_msgs::msg::MagneticField>::SharedPtr mag_pub;
+  rclcpp::Publisher<sensor_msgs::msg::FluidPressure>::SharedPtr pressure_pub;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub;
   rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
 
+  // Modo polling: pide la salida por defecto al dispositivo en cada tick
   void periodicTask() {
+    std::lock_guard<std::mutex> lock(protocol_mutex_);
     sbgProtocolContinuousModeHandle(protocol_handle_);
-    sbgGetDefaultOutput(protocol_handle_, &pOutput);
+    if (sbgGetDefaultOutput(protocol_handle_, &pOutput) == SBG_NO_ERROR) {
+      Output output;
+      OutputDecoder::fromSbgOutput(pOutput, output);
+      trackSaturation(output);
+      publishOutput(output, stampOutput(output, frameArrivalNs(protocol_handle_)));
+    }
+  }
+
+  // Modo streaming: espera en el puerto serie hasta el final del periodo del timer y vacia cada frame en cuanto
+  // llega, cada uno se publica desde su callback. La latencia no depende del periodo: este solo marca cada
+  // cuanto se devuelve el executor al resto de callbacks.
+  void drainTask() {
+    const uint64 deadline_ns = sbgGetTimeNs() + static_cast<uint64>(1e9 / frequency);
+    do {
+      std::lock_guard<std::mutex> lock(protocol_mutex_);
+      sbgProtocolContinuousModeHandle(protocol_handle_);
+    } while (sbgDeviceWaitReadableUntil(protocol_handle_->serialHandle, deadline_ns) == SBG_NO_ERROR);
+  }
+
+  // Modo reader_thread: duerme en poll() hasta que llegan bytes y decodifica los frames al momento
+  void readerLoop() {
+    applyReaderThreadSettings();
+    while (reader_running_) {
+      SbgErrorCode error = sbgProtocolWaitData(protocol_handle_, 100);
+      if (error == SBG_TIME_OUT) continue;
+      if (error != SBG_NO_ERROR) {
+        RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                             "Error waiting for SBG data: %d", error);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(protocol_mutex_);
+      sbgProtocolContinuousModeHandle(protocol_handle_);
+    }
+  }
+
+  // Publica las muestras que deja el hilo lector, fuera del camino critico de lectura
+  void publisherLoop() {
+    Sample sample;
+    while (reader_running_) {
+      {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait(lock, [this] { return !sample_queue_->empty() || !reader_running_; });
+      }
+      while (sample_queue_->pop(sample))
+        publishOutput(sample.output, sample.stamp);
+    }
+  }
+
+  void applyReaderThreadSettings() {
+    if (reader_cpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(reader_cpu, &cpus);
+      int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (error)
+        RCLCPP_WARN(this->get_logger(), "Unable to pin SBG reader thread to CPU %d: %s", reader_cpu, strerror(error));
+    }
+    if (reader_priority > 0) {
+      sched_param param{};
+      param.sched_priority = reader_priority;
+      int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (error)
+        RCLCPP_WARN(this->get_logger(), "Unable to set SCHED_FIFO priority %d on SBG reader thread "
+                    "(check CAP_SYS_NICE / rtprio limits): %s", reader_priority, strerror(error));
+    }
+  }
+
+  void startReaderThread() {
+    if (reader_mlockall && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+      RCLCPP_WARN(this->get_logger(), "mlockall failed (check memlock limits): %s", strerror(errno));
 
-    if (pOutput.outputMask)
+    sample_queue_ = std::make_unique<sbg::SpscQueue<Sample>>(reader_queue_size);
+    reader_running_ = true;
+    publisher_thread_ = std::thread(&SBGNode::publisherLoop, this);
+    reader_thread_ = std::thread(&SBGNode::readerLoop, this);
+  }
+
+  void stopReaderThread() {
+    reader_running_ = false;
     {
-      if (pOutput.outputMask & IMU_OUTPUT_MASK) {
-        imu_msg->header.stamp = this->now();
-        imu_msg->header.frame_id = imu_frame_id;
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_all();
+    if (reader_thread_.joinable()) reader_thread_.join();
+    if (publisher_thread_.joinable()) publisher_thread_.join();
+  }
+
+  // Llegada del primer byte del ultimo frame recibido, en reloj monotono (el mismo que steady_clock).
+  // sbgCom la reconstruye a partir del sello de cada read() y del baudrate.
+  static int64_t frameArrivalNs(SbgProtocolHandle handle) {
+    uint64 arrival_ns = 0;
+    if (sbgProtocolGetFrameTimeStamp(handle, &arrival_ns) != SBG_NO_ERROR || arrival_ns == 0)
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<int64_t>(arrival_ns);
+  }
 
-        imu_ned_msg->header.stamp = this->now();
-        imu_ned_msg->header.frame_id = imu_frame_ned_id;
+  // Sello de la muestra: la recta estimada evaluada en timeSinceReset, o la hora de llegada
+  // si el reloj del dispositivo no esta disponible
+  rclcpp::Time stampOutput(const Output &output, int64_t arrival_ns) {
+    const int64_t steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    const rclcpp::Time now = this->now();
+
+    int64_t stamp_ns = arrival_ns;
+    if (use_device_clock_ && (output.outputMask & SBG_OUTPUT_TIME_SINCE_RESET)) {
+      std::lock_guard<std::mutex> lock(clock_mutex_);
+      stamp_ns = clock_estimator_.stamp(output.timeSinceReset, arrival_ns);
+    }
+    // El estimador trabaja en reloj monotono, se pasa al reloj del nodo con la diferencia actual entre ambos
+    return now - rclcpp::Duration(std::chrono::nanoseconds(steady_ns - stamp_ns));
+  }
+
+  uint16 frameBytes(uint32 mask) const {
+    return sbgCalculateOutputBufferSize(protocol_handle_->targetOutputMode, mask);
+  }
+
+  uint32 requiredOutputMask() const {
+    uint32 mask = COMMON_OUTPUT_MASK;
+    if (imu_pub->get_subscription_count() > 0 || imu_ned_pub->get_subscription_count() > 0)
+      mask |= IMU_OUTPUT_MASK;
+    if (gps_pub->get_subscription_count() > 0)
+      mask |= GPS_OUTPUT_MASK;
+    if (mag_pub->get_subscription_count() > 0)
+      mask |= MAG_OUTPUT_MASK;
+    if (pressure_pub->get_subscription_count() > 0)
+      mask |= BARO_OUTPUT_MASK;
+    return mask;
+  }
+
+  SbgBandwidthConfig bandwidthConfig(uint32 mask) const {
+    SbgBandwidthConfig config;
+    sbgBandwidthInitConfig(&config);
+    config.outputMode = protocol_handle_->targetOutputMode;
+    config.divider = output_divider_;
+    config.mainLoopRate = device_loop_rate;
+    config.magRate = mag_rate;
+    config.baroRate = baro_rate;
+    config.gpsRate = gps_rate;
+    config.baudRate = baudrate;
+    if (triggered_) {
+      config.contMode = SBG_TRIGGERED_MODE_ENABLE;
+      for (uint8 cond = 0; cond < std::size(TRIGGER_ROUTES); cond++) {
+        if (!(mask & TRIGGER_ROUTES[cond].fields)) continue;
+        config.triggerMasks[cond] = TRIGGER_ROUTES[cond].triggers;
+        config.triggerOutputMasks[cond] = TRIGGER_ROUTES[cond].fields | COMMON_OUTPUT_MASK;
+      }
+    } else {
+      config.defaultOutputMask = mask;
+    }
+    return config;
+  }
+
+  // Comprueba que las salidas de mask caben en el enlace. Al arrancar, con bandwidth_policy divider se elige
+  // el menor divisor (la mayor frecuencia) que cabe; con refuse devuelve false y la mascara no se aplica.
+  bool planBandwidth(uint32 mask, bool startup) {
+    SbgBandwidthConfig config = bandwidthConfig(mask);
+    SbgBandwidthReport report;
+    if (sbgBandwidthCompute(&config, &report) != SBG_NO_ERROR) {
+      RCLCPP_WARN(this->get_logger(), "Invalid bandwidth budget parameters, link load not checked");
+      return true;
+    }
+    if (report.load <= bandwidth_max_load) {
+      bandwidth_ = report;
+      if (startup)
+        RCLCPP_INFO(this->get_logger(), "SBG outputs: %.0f of %.0f bytes/s at %d baud (load %.1f %%)",
+                    report.bytesPerSecond, report.lineBytesPerSecond, baudrate, 100.0 * report.load);
+      return true;
+    }
+
+    const uint8 divider = sbgBandwidthFindDivider(&config, bandwidth_max_load);
+    const uint32 min_baud = sbgBandwidthFindBaudRate(&config, bandwidth_max_load);
+    if (startup && bandwidth_policy == "divider" && divider) {
+      output_divider_ = divider;
+      config.divider = divider;
+      sbgBandwidthCompute(&config, &bandwidth_);
+      RCLCPP_WARN(this->get_logger(), "SBG outputs need %.0f bytes/s, more than %.0f %% of %.0f bytes/s at %d baud: "
+                  "output divider %u (%.1f Hz), load %.1f %%", report.bytesPerSecond, 100.0 * bandwidth_max_load,
+                  report.lineBytesPerSecond, baudrate, divider, device_loop_rate / divider, 100.0 * bandwidth_.load);
+      return true;
+    }
+
+    const string advice = (divider ? "highest rate divider " + std::to_string(divider) : string("no divider fits")) +
+                          (min_baud ? ", lowest baud " + std::to_string(min_baud) : string(", too much for 921600 baud"));
+    if (bandwidth_policy == "refuse") {
+      RCLCPP_ERROR(this->get_logger(), "SBG output mask 0x%08x needs %.0f of %.0f bytes/s at %d baud (load %.1f %%), "
+                   "refused (%s)", mask, report.bytesPerSecond, report.lineBytesPerSecond, baudrate,
+                   100.0 * report.load, advice.c_str());
+      return false;
+    }
+    bandwidth_ = report;
+    RCLCPP_WARN(this->get_logger(), "SBG output mask 0x%08x needs %.0f of %.0f bytes/s at %d baud (load %.1f %%), "
+                "the device will saturate (%s)", mask, report.bytesPerSecond, report.lineBytesPerSecond, baudrate,
+                100.0 * report.load, advice.c_str());
+    return true;
+  }
+
+  // Campos de las condiciones que han disparado una trama
+  static uint32 routedFields(uint32 triggerMask) {
+    uint32 fields = COMMON_OUTPUT_MASK;
+    for (const TriggerRoute &route : TRIGGER_ROUTES)
+      if (triggerMask & route.triggers)
+        fields |= route.fields;
+    return fields;
+  }
+
+  // Programa la condicion de cada clase de datos: activa si la mascara tiene sus campos, si no desactivada.
+  // Solo se envian las que cambian respecto a current, todas si force.
+  SbgErrorCode configureTriggers(uint32 target, uint32 current, bool force) {
+    for (uint8 cond = 0; cond < std::size(TRIGGER_ROUTES); cond++) {
+      const TriggerRoute &route = TRIGGER_ROUTES[cond];
+      const bool enabled = (target & route.fields) != 0;
+      if (!force && enabled == ((current & route.fields) != 0)) continue;
+      SbgErrorCode error = enabled ?
+        sbgSetTriggeredMode(protocol_handle_, cond, route.triggers, route.fields | COMMON_OUTPUT_MASK) :
+        sbgSetTriggeredMode(protocol_handle_, cond, SBG_TRIGGER_DISABLED, 0);
+      if (error != SBG_NO_ERROR) return error;
+    }
+    return SBG_NO_ERROR;
+  }
+
+  // Ajusta la mascara por defecto del dispositivo a los suscriptores actuales. Los campos de un suscriptor
+  // nuevo se piden en el momento; los que ya nadie usa se dejan de pedir tras output_mask_release_s, para no
+  // reconfigurar el dispositivo con cada suscriptor efimero. El modo continuo sigue activo durante el cambio.
+  void updateOutputMask() {
+    const uint32 required = requiredOutputMask();
+    const auto now = std::chrono::steady_clock::now();
+
+    uint32 target = output_mask_ | required;
+    if ((output_mask_ & ~required) == 0) {
+      release_since_ = {};
+    } else if (release_since_ == std::chrono::steady_clock::time_point{}) {
+      release_since_ = now;
+    } else if (now - release_since_ >= std::chrono::duration<double>(output_mask_release_s)) {
+      target = required;
+    }
+    if (target == output_mask_) return;
+    if (!planBandwidth(target, false)) return;
+
+    SbgErrorCode error;
+    {
+      std::lock_guard<std::mutex> lock(protocol_mutex_);
+      if (triggered_) {
+        error = configureTriggers(target, output_mask_, false);
+      } else {
+        pending_output_mask_ = target;
+        error = sbgSetDefaultOutputMask(protocol_handle_, target);
+        pending_output_mask_ = 0;
+      }
+    }
+    if (error != SBG_NO_ERROR) {
+      RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 5000,
+                           "Unable to set SBG output mask 0x%08x: %d", target, error);
+      return;
+    }
+    if (triggered_)
+      RCLCPP_INFO(this->get_logger(), "SBG triggered outputs 0x%08x -> 0x%08x", output_mask_, target);
+    else
+      RCLCPP_INFO(this->get_logger(), "SBG output mask 0x%08x -> 0x%08x (%u -> %u bytes per frame)",
+                  output_mask_, target, frameBytes(output_mask_), frameBytes(target));
+    output_mask_ = target;
+    release_since_ = {};
+  }
+
+  // Prestamos de cada publicador, p. ej. "imu on, imu_ned on, gps off"
+  string loanStatus() const {
+    auto state = [this](const char *name, bool loan) {
+      return string(name) + (loan ? " on" : " off");
+    };
+    return state("imu", useLoan(*imu_pub)) + ", " + state("imu_ned", useLoan(*imu_ned_pub)) + ", " +
+           state("gps", useLoan(*gps_pub));
+  }
+
+  // Publica el estado del estimador de reloj a 1 Hz
+  void publishDiagnostics() {
+    // Saturacion del buffer de salida del dispositivo: el enlace no da abasto con las salidas configuradas
+    if (output_saturated_)
+      RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 10000,
+                           "SBG output buffer saturated at %d baud (planned load %.1f %%)", baudrate,
+                           100.0 * bandwidth_.load);
+
+    sbg::ClockEstimatorState state;
+    {
+      std::lock_guard<std::mutex> lock(clock_mutex_);
+      state = clock_estimator_.state();
+    }
+
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = std::string(this->get_name()) + ": clock";
+    status.hardware_id = port;
+    if (!use_device_clock_) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = "Host arrival time";
+    } else if (state.valid) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = "Device clock locked";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "Waiting for device clock samples";
+    }
+    if (output_saturated_ && status.level == diagnostic_msgs::msg::DiagnosticStatus::OK) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "Device output buffer saturated";
+    }
+
+    auto add = [&status](const string &key, const string &value) {
+      diagnostic_msgs::msg::KeyValue kv;
+      kv.key = key;
+      kv.value = value;
+      status.values.push_back(kv);
+    };
+    add("time_source", time_source);
+    add("offset_ns", std::to_string(state.offset_ns));
+    add("drift_ppm", std::to_string(state.drift_ppm));
+    add("residual_us", std::to_string(state.residual_ns / 1000.0));
+    add("samples", std::to_string(state.samples));
+    add("accepted", std::to_string(state.accepted));
+    add("rejected", std::to_string(state.rejected));
+    add("wraps", std::to_string(state.wraps));
+    add("resets", std::to_string(state.resets));
+    add("dropped_samples", std::to_string(dropped_samples_.load()));
+    add("loaned_messages", loanStatus());
+    add("loaned_publishes", std::to_string(loaned_publishes_.load()));
+    add("owned_publishes", std::to_string(owned_publishes_.load()));
+    add("output_routing", output_routing);
+    add("output_divider", std::to_string(output_divider_));
+    add("bandwidth_bytes_per_s", std::to_string(bandwidth_.bytesPerSecond));
+    add("bandwidth_load", std::to_string(bandwidth_.load));
+    add("output_saturated", output_saturated_ ? "true" : "false");
+    add("saturation_events", std::to_string(saturation_events_.load()));
+    // La mascara de sbgCom la cambian los comandos y, al reproducir una captura, el hilo de lectura
+    uint32 mask = output_mask_;
+    if (!triggered_) {
+      std::lock_guard<std::mutex> lock(protocol_mutex_);
+      mask = protocol_handle_->targetDefaultOutputMask;
+    }
+    char mask_text[16];
+    snprintf(mask_text, sizeof(mask_text), "0x%08x", mask);
+    add("output_mask", mask_text);
+    if (triggered_) {
+      // Trama de cada condicion activa: mascara de disparo y de salida (8 bytes) mas los campos
+      string frame_bytes;
+      for (const TriggerRoute &route : TRIGGER_ROUTES) {
+        if (!(mask & route.fields)) continue;
+        if (!frame_bytes.empty()) frame_bytes += ", ";
+        frame_bytes += string(route.name) + " " +
+                       std::to_string(2 * sizeof(uint32) + frameBytes(route.fields | COMMON_OUTPUT_MASK));
+      }
+      add("output_frame_bytes", frame_bytes);
+    } else {
+      add("output_frame_bytes", std::to_string(frameBytes(mask)));
+    }
+    add("serial_baudrate", std::to_string(latency_info_.baudRate));
+    add("serial_low_latency", latency_info_.lowLatency ? "true" : "false");
+    add("serial_latency_timer_ms", std::to_string(latency_info_.latencyTimerMs));
+    SbgCaptureStats capture_stats{};
+    if (sbgCaptureGetStats(capture_handle_, &capture_stats) == SBG_NO_ERROR) {
+      add("record_written_bytes", std::to_string(capture_stats.writtenBytes));
+      add("record_dropped_chunks", std::to_string(capture_stats.droppedRecords));
+      add("record_write_errors", std::to_string(capture_stats.writeErrors));
+      add("record_max_write_ms", std::to_string(capture_stats.maxWriteTimeNs / 1e6));
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = this->now();
+    msg.status.push_back(status);
+    diagnostics_pub->publish(msg);
+  }
+
+  // Saturacion segun el deviceStatus de la muestra, sin ninguna consulta al dispositivo
+  void trackSaturation(const Output &output) {
+    if (!(output.outputMask & STATUS_OUTPUT_MASK)) return;
+    const bool saturated = !(output.deviceStatus & SBG_PROTOCOL_OUTPUT_STATUS_MASK);
+    if (!output_saturated_.exchange(saturated) && saturated)
+      saturation_events_++;
+  }
+
+  // Se llama desde el hilo que decodifica los frames (executor o hilo lector)
+  void handleOutput(const Output &output, int64_t arrival_ns) {
+    trackSaturation(output);
+    const rclcpp::Time stamp = stampOutput(output, arrival_ns);
+    if (!sample_queue_) {
+      publishOutput(output, stamp);
+      return;
+    }
+    if (!sample_queue_->push(Sample{output, stamp})) {
+      dropped_samples_++;
+      RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                           "SBG sample queue full, %lu samples dropped", (unsigned long)dropped_samples_.load());
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+  }
+
+  // Ruta rapida: la trama continua se decodifica con el codigo generado si su mascara es una de las que
+  // negocia el nodo y tiene exactamente su tamaño. Se prueba la mascara vigente en sbgCom y, mientras
+  // sbgSetDefaultOutputMask espera su ACK, la pendiente. Cualquier otra trama (otra mascara del mismo
+  // tamaño, la mascara de fabrica, otro modo) devuelve false y sbgCom la decodifica con la ruta generica
+  // y llama a onContinuousFrame.
+  static bool onContinuousRawFrame(SbgProtocolHandleInt *pHandler, uint32 outputMask, const uint8 *pBuffer,
+                                   uint16 size, void *pUsrArg) {
+    SBGNode *node = static_cast<SBGNode *>(pUsrArg);
+    if (!node->streaming_)
+      return true;
+    constexpr auto classes = std::make_index_sequence<32>{};
+    const uint8 mode = pHandler->targetOutputMode;
+    const uint32 pending = node->pending_output_mask_;
+    Output output;
+    if (!decodeNegotiated(mode, outputMask, pBuffer, size, output, classes) &&
+        !(pending && decodeNegotiated(mode, pending, pBuffer, size, output, classes))) {
+      RCLCPP_WARN_ONCE(node->get_logger(), "SBG output mask 0x%08x / mode %u / %u bytes don't match the compiled "
+                       "decoder (masks within 0x%08x / %u), using the generic decoder", outputMask, mode, size,
+                       OutputDecoder::mask, OutputDecoder::mode);
+      return false;
+    }
+    node->handleOutput(output, frameArrivalNs(pHandler));
+    return true;
+  }
+
+  static void onContinuousFrame(SbgProtocolHandleInt *pHandler, SbgOutput *pOutput, void *pUsrArg) {
+    SBGNode *node = static_cast<SBGNode *>(pUsrArg);
+    if (node->streaming_) {
+      Output output;
+      OutputDecoder::fromSbgOutput(*pOutput, output);
+      node->handleOutput(output, frameArrivalNs(pHandler));
+    }
+  }
+
+  // Cada condicion envia sus propias tramas: por triggerMask se sabe que clase de datos es nueva y solo se
+  // publican sus topics, aunque la trama lleve mas campos
+  static void onTriggeredFrame(SbgProtocolHandleInt *pHandler, uint32 triggerMask, SbgOutput *pOutput,
+                               void *pUsrArg) {
+    SBGNode *node = static_cast<SBGNode *>(pUsrArg);
+    if (node->streaming_) {
+      Output output;
+      OutputDecoder::fromSbgOutput(*pOutput, output);
+      output.outputMask &= routedFields(triggerMask);
+      node->handleOutput(output, frameArrivalNs(pHandler));
+    }
+  }
+
+  static void onContinuousError(SbgProtocolHandleInt *, SbgErrorCode errorCode, void *pUsrArg) {
+    SBGNode *node = static_cast<SBGNode *>(pUsrArg);
+    RCLCPP_WARN_THROTTLE(node->get_logger(), *node->get_clock(), 1000,
+                         "Error on SBG continuous frame: %d", errorCode);
+  }
+
+  // Mensaje en construccion: prestado por el middleware si el RMW lo admite (p. ej. memoria compartida) y
+  // se rellena directamente en su memoria; si no, un unique_ptr nuevo. Con suscriptores intra-proceso
+  // se usa siempre el unique_ptr, que les llega sin copias.
+  // Un prestamo real no construye el mensaje: solo los tipos planos (is_plain, sin strings ni secuencias)
+  // pueden recibir la plantilla por asignacion, el resto no compila la ruta del prestamo.
+  template <typename MessageT>
+  class OutgoingMessage {
+  public:
+    static constexpr bool loanable = rosidl_generator_traits::is_plain<MessageT>::value;
+
+    OutgoingMessage(rclcpp::Publisher<MessageT> &publisher, const MessageT &message_template, bool loan)
+    : publisher_(publisher)
+    {
+      if constexpr (loanable) {
+        if (loan) {
+          loaned_.emplace(publisher.borrow_loaned_message());
+          loaned_->get() = message_template;
+          return;
+        }
+      }
+      owned_ = std::make_unique<MessageT>(message_template);
+    }
+
+    MessageT *operator->() {return loaned_ ? &loaned_->get() : owned_.get();}
+    bool loaned() const {return loaned_.has_value();}
+
+    void publish() {
+      if (loaned_)
+        publisher_.publish(std::move(*loaned_));
+      else
+        publisher_.publish(std::move(owned_));
+    }
+
+  private:
+    rclcpp::Publisher<MessageT> &publisher_;
+    std::optional<rclcpp::LoanedMessage<MessageT>> loaned_;
+    std::unique_ptr<MessageT> owned_;
+  };
+
+  template <typename MessageT>
+  bool useLoan(const rclcpp::Publisher<MessageT> &publisher) const {
+    if constexpr (!OutgoingMessage<MessageT>::loanable) return false;
+    return loaned_messages && publisher.can_loan_messages() && publisher.get_intra_process_subscription_count() == 0;
+  }
+
+  template <typename MessageT>
+  void publishMessage(OutgoingMessage<MessageT> &message) {
+    (message.loaned() ? loaned_publishes_ : owned_publishes_)++;
+    message.publish();
+  }
+
+  void publishOutput(const Output &output, const rclcpp::Time &stamp) {
+    if (output.outputMask)
+    {
+      if (output.outputMask & IMU_OUTPUT_MASK) {
+        OutgoingMessage<sensor_msgs::msg::Imu> imu_msg(*imu_pub, imu_template_, useLoan(*imu_pub));
+        OutgoingMessage<sensor_msgs::msg::Imu> imu_ned_msg(*imu_ned_pub, imu_ned_template_, useLoan(*imu_ned_pub));
+
+        imu_msg->header.stamp = stamp;
+        imu_ned_msg->header.stamp = stamp;
 
         // Applied a 180 degrees rotation around the X axis to match car standard orientation
 
         // https://es.mathworks.com/help/map/choose-a-3-d-coordinate-system.html
 
-        //pOutput.stateMatrix[0]
-        _output_matrix.setValue(pOutput.stateMatrix[0], pOutput.stateMatrix[1], pOutput.stateMatrix[2],
-                      pOutput.stateMatrix[3], pOutput.stateMatrix[4], pOutput.stateMatrix[5],
-                      pOutput.stateMatrix[6], pOutput.stateMatrix[7], pOutput.stateMatrix[8]);
+        //output.stateMatrix[0]
+        _output_matrix.setValue(output.stateMatrix[0], output.stateMatrix[1], output.stateMatrix[2],
+                      output.stateMatrix[3], output.stateMatrix[4], output.stateMatrix[5],
+                      output.stateMatrix[6], output.stateMatrix[7], output.stateMatrix[8]);
         /*
         _aux = IMU2ROS * _output_matrix;
         _aux.getRotation(_quat);
@@ -87,14 +754,14 @@ private:
         imu_msg->orientation.y = _quat.y();
         imu_msg->orientation.z = _quat.z();
 
-        _vec.setValue(pOutput.gyroscopes[0], pOutput.gyroscopes[1], pOutput.gyroscopes[2]);
+        _vec.setValue(output.gyroscopes[0], output.gyroscopes[1], output.gyroscopes[2]);
         _vec = IMU2ROS * _vec;
 
         imu_msg->angular_velocity.x = _vec.x();
         imu_msg->angular_velocity.y = _vec.y();
         imu_msg->angular_velocity.z = _vec.z();
 
-        _vec.setValue(pOutput.accelerometers[0], pOutput.accelerometers[1], pOutput.accelerometers[2]);
+        _vec.setValue(output.accelerometers[0], output.accelerometers[1], output.accelerometers[2]);
         _vec = IMU2ROS * _vec;
 
         imu_msg->linear_acceleration.x = _vec.x();
@@ -108,25 +775,25 @@ private:
         imu_ned_msg->orientation.y = _quat.y();
         imu_ned_msg->orientation.z = _quat.z();
 
-        imu_ned_msg->angular_velocity.x = pOutput.gyroscopes[0];
-        imu_ned_msg->angular_velocity.y = pOutput.gyroscopes[1];
-        imu_ned_msg->angular_velocity.z = pOutput.gyroscopes[2];
+        imu_ned_msg->angular_velocity.x = output.gyroscopes[0];
+        imu_ned_msg->angular_velocity.y = output.gyroscopes[1];
+        imu_ned_msg->angular_velocity.z = output.gyroscopes[2];
 
-        imu_ned_msg->linear_acceleration.x = pOutput.accelerometers[0];
-        imu_ned_msg->linear_acceleration.y = pOutput.accelerometers[1];
-        imu_ned_msg->linear_acceleration.z = pOutput.accelerometers[2];
+        imu_ned_msg->linear_acceleration.x = output.accelerometers[0];
+        imu_ned_msg->linear_acceleration.y = output.accelerometers[1];
+        imu_ned_msg->linear_acceleration.z = output.accelerometers[2];
 
-        imu_pub->publish(*imu_msg);
-        imu_ned_pub->publish(*imu_ned_msg);
+        publishMessage(imu_msg);
+        publishMessage(imu_ned_msg);
       }
-      if (pOutput.outputMask & GPS_OUTPUT_MASK) {
+      if (output.outputMask & GPS_OUTPUT_MASK) {
         
-        gps_msg->header.stamp = this->now();
-        gps_msg->header.frame_id = gps_frame_id;
+        OutgoingMessage<sensor_msgs::msg::NavSatFix> gps_msg(*gps_pub, gps_template_, useLoan(*gps_pub));
+        gps_msg->header.stamp = stamp;
 
-        gps_msg->latitude = pOutput.position[0]; // tambe podem tindre la mesura directa del gps 
-        gps_msg->longitude = pOutput.position[1];
-        gps_msg->altitude = pOutput.position[2]; 
+        gps_msg->latitude = output.position[0]; // tambe podem tindre la mesura directa del gps 
+        gps_msg->longitude = output.position[1];
+        gps_msg->altitude = output.position[2]; 
         
         for (int i = 0; i < 9; i++)
             gps_msg->position_covariance[i] = 0;
@@ -134,15 +801,34 @@ private:
         //0 = desconocida, 1 = aproximada, 2 = solo diagonal, 3 = matriz entera
         gps_msg->position_covariance_type = 1;
         for (int i = 0; i <= 8; i+=4) //la covarianza es en metros, no relativa a la lat/long
-            gps_msg->position_covariance[i] = pOutput.positionAccuracy; //o al cuadrado??
+            gps_msg->position_covariance[i] = output.positionAccuracy; //o al cuadrado??
 
-        if ((pOutput.gpsFlags & 0x03))
+        if ((output.gpsFlags & 0x03))
             gps_msg->status.status =  0; // we have 3D location
         else 
             gps_msg->status.status = -1; // we don't have enough info
         gps_msg->status.service = 1; //gps
 
-        gps_pub->publish(*gps_msg);
+        publishMessage(gps_msg);
+      }
+      if (output.outputMask & MAG_OUTPUT_MASK) {
+        OutgoingMessage<sensor_msgs::msg::MagneticField> mag_msg(*mag_pub, mag_template_, useLoan(*mag_pub));
+        mag_msg->header.stamp = stamp;
+
+        // Ejes del dispositivo (NED) como imu_ned, en las unidades normalizadas del dispositivo
+        mag_msg->magnetic_field.x = output.magnetometers[0];
+        mag_msg->magnetic_field.y = output.magnetometers[1];
+        mag_msg->magnetic_field.z = output.magnetometers[2];
+
+        publishMessage(mag_msg);
+      }
+      if (output.outputMask & BARO_OUTPUT_MASK) {
+        OutgoingMessage<sensor_msgs::msg::FluidPressure> pressure_msg(*pressure_pub, pressure_template_,
+                                                                      useLoan(*pressure_pub));
+        pressure_msg->header.stamp = stamp;
+        pressure_msg->fluid_pressure = output.baroPressure;   // Pa
+
+        publishMessage(pressure_msg);
       }
     }    
   }
@@ -157,8 +843,66 @@ private:
     return false;
   }
 
+  // Fallo al arrancar: se cierra el puerto y la excepcion hace fallar la carga del componente, en vez de
+  // dejar cargado un nodo sin publicadores ni timers
+  [[noreturn]] void failInit(const string &what) {
+    if (protocol_handle_ != SBG_INVALID_PROTOCOL_HANDLE) {
+      sbgProtocolClose(protocol_handle_);
+      protocol_handle_ = SBG_INVALID_PROTOCOL_HANDLE;
+    }
+    throw std::runtime_error(what);
+  }
+
+  void checkInit(const string &call) {
+    if (last_error_ != SBG_NO_ERROR)
+      failInit("SBG " + call + " failed on " + port + ": error " + std::to_string(last_error_));
+  }
+
+  // Sin dispositivo no se puede preguntar el modo de salida ni la mascara: se toman de la cabecera de la captura
+  void startReplay() {
+    SbgCaptureHeader header{};
+    uint32 output_mode = sbg::kNativeOutputMode;
+    uint32 output_mask = OUTPUT_MASK;
+
+    if (sbgDeviceGetCaptureHeader(protocol_handle_->serialHandle, &header) == SBG_NO_ERROR) {
+      if (header.outputMode != SBG_CAPTURE_UNKNOWN) output_mode = header.outputMode;
+      if (header.defaultOutputMask != SBG_CAPTURE_UNKNOWN) output_mask = header.defaultOutputMask;
+      // El baud rate grabado fecha los frames, no el del parametro
+      if (header.baudRate != SBG_CAPTURE_UNKNOWN && header.baudRate != 0)
+        sbgProtocolChangeBaud(protocol_handle_, header.baudRate);
+    }
+    sbgProtocolSetTargetOutput(protocol_handle_, output_mode, output_mask);
+
+    RCLCPP_INFO(this->get_logger(), "Replaying %s: output mode 0x%x, output mask 0x%x", port.c_str(),
+                output_mode, output_mask);
+  }
+
+  // El hilo de escritura de sbgCom vuelca la captura, la lectura del puerto nunca espera al disco
+  void startRecording() {
+    SbgCaptureHeader header{};
+    header.baudRate = latency_info_.baudRate ? latency_info_.baudRate : (uint32)baudrate;
+    header.outputMode = protocol_handle_->targetOutputMode;
+    header.defaultOutputMask = protocol_handle_->targetDefaultOutputMask;
+
+    if (sbgCaptureOpen(record_path.c_str(), &header, 0, record_direct_io, &capture_handle_) != SBG_NO_ERROR) {
+      RCLCPP_ERROR(this->get_logger(), "Unable to record to %s", record_path.c_str());
+      return;
+    }
+    sbgProtocolSetCapture(protocol_handle_, capture_handle_);
+    RCLCPP_INFO(this->get_logger(), "Recording %s to %s%s", port.c_str(), record_path.c_str(),
+                record_direct_io ? " (O_DIRECT)" : "");
+  }
+
+  void stopRecording() {
+    if (capture_handle_ == SBG_INVALID_CAPTURE_HANDLE) return;
+    sbgProtocolSetCapture(protocol_handle_, SBG_INVALID_CAPTURE_HANDLE);
+    if (sbgCaptureClose(capture_handle_) != SBG_NO_ERROR)
+      RCLCPP_ERROR(this->get_logger(), "Capture %s incomplete, write errors", record_path.c_str());
+    capture_handle_ = SBG_INVALID_CAPTURE_HANDLE;
+  }
+
 public:
-  SBGNode(const rclcpp::NodeOptions &options) : Node("sbg_node", options){
+  explicit SBGNode(const rclcpp::NodeOptions &options) : Node("sbg_node", options){
     this->declare_parameter("port", port);
     this->get_parameter("port", port);
 
@@ -174,44 +918,205 @@ public:
     this->declare_parameter("frequency", frequency);
     this->get_parameter("frequency", frequency);
 
-    last_error_ = sbgComInit(port.c_str(), baudrate, &protocol_handle_);
-    if(checkError("sbgComInit")) return;
-    usleep(50*1000);    // time_period en microsegundos
+    this->declare_parameter("pipeline_mode", pipeline_mode);
+    this->get_parameter("pipeline_mode", pipeline_mode);
+    if (pipeline_mode != "streaming" && pipeline_mode != "polling" && pipeline_mode != "reader_thread") {
+      RCLCPP_WARN(this->get_logger(), "Unknown pipeline_mode '%s', using 'streaming'", pipeline_mode.c_str());
+      pipeline_mode = "streaming";
+    }
+
+    this->declare_parameter("time_source", time_source);
+    this->get_parameter("time_source", time_source);
+    if (time_source != "device" && time_source != "host") {
+      RCLCPP_WARN(this->get_logger(), "Unknown time_source '%s', using 'device'", time_source.c_str());
+      time_source = "device";
+    }
+    use_device_clock_ = (time_source == "device");
+
+    this->declare_parameter("reader_thread.cpu", reader_cpu);
+    this->get_parameter("reader_thread.cpu", reader_cpu);
+
+    this->declare_parameter("reader_thread.priority", reader_priority);
+    this->get_parameter("reader_thread.priority", reader_priority);
+    if (reader_priority < 0 || reader_priority > sched_get_priority_max(SCHED_FIFO)) {
+      RCLCPP_WARN(this->get_logger(), "Invalid reader_thread.priority %d, using SCHED_OTHER", reader_priority);
+      reader_priority = 0;
+    }
+
+    this->declare_parameter("reader_thread.mlockall", reader_mlockall);
+    this->get_parameter("reader_thread.mlockall", reader_mlockall);
+
+    this->declare_parameter("reader_thread.queue_size", reader_queue_size);
+    this->get_parameter("reader_thread.queue_size", reader_queue_size);
+    if (reader_queue_size < 2) reader_queue_size = 2;
+
+    this->declare_parameter("low_latency", low_latency);
+    this->get_parameter("low_latency", low_latency);
+
+    this->declare_parameter("latency_timer_ms", latency_timer_ms);
+    this->get_parameter("latency_timer_ms", latency_timer_ms);
+    if (latency_timer_ms < 0 || latency_timer_ms > 255) {
+      RCLCPP_WARN(this->get_logger(), "Invalid latency_timer_ms %d, using 1", latency_timer_ms);
+      latency_timer_ms = 1;
+    }
+
+    this->declare_parameter("record.path", record_path);
+    this->get_parameter("record.path", record_path);
+
+    this->declare_parameter("record.direct_io", record_direct_io);
+    this->get_parameter("record.direct_io", record_direct_io);
+
+    this->declare_parameter("loaned_messages", loaned_messages);
+    this->get_parameter("loaned_messages", loaned_messages);
+
+    this->declare_parameter("output_routing", output_routing);
+    this->get_parameter("output_routing", output_routing);
+
+    this->declare_parameter("bandwidth.policy", bandwidth_policy);
+    this->get_parameter("bandwidth.policy", bandwidth_policy);
+
+    this->declare_parameter("bandwidth.max_load", bandwidth_max_load);
+    this->get_parameter("bandwidth.max_load", bandwidth_max_load);
+
+    this->declare_parameter("bandwidth.loop_rate", device_loop_rate);
+    this->get_parameter("bandwidth.loop_rate", device_loop_rate);
+
+    this->declare_parameter("bandwidth.mag_rate", mag_rate);
+    this->get_parameter("bandwidth.mag_rate", mag_rate);
 
-    last_error_ = sbgSetDefaultOutputMask(protocol_handle_, OUTPUT_MASK);
-    if(checkError("sbgSetDefaultOutputMask")) return;
+    this->declare_parameter("bandwidth.baro_rate", baro_rate);
+    this->get_parameter("bandwidth.baro_rate", baro_rate);
 
-    last_error_ = sbgSetContinuousMode(protocol_handle_, SBG_CONTINUOUS_MODE_ENABLE, 1);
-    if(checkError("sbgSetContinuousMode: SBG_CONTINUOUS_MODE_ENABLE")) return;
+    this->declare_parameter("bandwidth.gps_rate", gps_rate);
+    this->get_parameter("bandwidth.gps_rate", gps_rate);
+
+    this->declare_parameter("dynamic_output_mask", dynamic_output_mask);
+    this->get_parameter("dynamic_output_mask", dynamic_output_mask);
+
+    this->declare_parameter("output_mask_release_s", output_mask_release_s);
+    this->get_parameter("output_mask_release_s", output_mask_release_s);
+
+    replay_ = (port.compare(0, 7, "file://") == 0);
+    if (output_routing != "continuous" && output_routing != "triggered") {
+      RCLCPP_WARN(this->get_logger(), "Unknown output_routing '%s', using 'continuous'", output_routing.c_str());
+      output_routing = "continuous";
+    }
+    if (output_routing == "triggered" && pipeline_mode == "polling") {
+      RCLCPP_WARN(this->get_logger(), "output_routing 'triggered' needs a streaming pipeline, using 'continuous'");
+      output_routing = "continuous";
+    }
+    // Al reproducir, las tramas son las de la captura y no se configura nada
+    triggered_ = (output_routing == "triggered") && !replay_;
+
+    if (replay_) {
+      if (pipeline_mode == "polling") {
+        RCLCPP_WARN(this->get_logger(), "pipeline_mode 'polling' needs a device, using 'streaming' to replay %s", port.c_str());
+        pipeline_mode = "streaming";
+      }
+      last_error_ = sbgProtocolInit(port.c_str(), baudrate, &protocol_handle_);
+      if (last_error_ != SBG_NO_ERROR) protocol_handle_ = SBG_INVALID_PROTOCOL_HANDLE;
+      checkInit("sbgProtocolInit");
+      startReplay();
+    } else {
+      // sbgComInit ya cierra el puerto si falla
+      last_error_ = sbgComInit(port.c_str(), baudrate, &protocol_handle_);
+      if (last_error_ != SBG_NO_ERROR) protocol_handle_ = SBG_INVALID_PROTOCOL_HANDLE;
+      checkInit("sbgComInit");
+    }
+
+    if (low_latency &&
+        sbgDeviceSetLowLatency(protocol_handle_->serialHandle, latency_timer_ms, &latency_info_) != SBG_NO_ERROR) {
+      RCLCPP_WARN(this->get_logger(), "Low latency mode not fully applied on %s (driver support or sysfs permissions)",
+                  port.c_str());
+    }
+    sbgDeviceGetLatencyInfo(protocol_handle_->serialHandle, &latency_info_);
+    RCLCPP_INFO(this->get_logger(), "Serial %s: %u baud, ASYNC_LOW_LATENCY %s, latency timer %s", port.c_str(),
+                latency_info_.baudRate, latency_info_.lowLatency ? "on" : "off",
+                latency_info_.latencyTimerMs < 0 ? "n/a" : (std::to_string(latency_info_.latencyTimerMs) + " ms").c_str());
+    if (!replay_) {
+      usleep(50*1000);    // time_period en microsegundos
+
+      // Se empieza con todas las condiciones, la mascara dinamica desactiva las que no tienen suscriptores
+      if (triggered_)
+        output_mask_ = PUBLISHED_OUTPUT_MASK;
+      // Con bandwidth.policy refuse el componente no llega a cargarse
+      if (!planBandwidth(output_mask_, true))
+        failInit("SBG outputs don't fit the serial link at " + std::to_string(baudrate) +
+                 " baud (bandwidth.policy refuse)");
+
+      last_error_ = sbgSetDefaultOutputMask(protocol_handle_, OUTPUT_MASK);
+      checkInit("sbgSetDefaultOutputMask");
+
+      if (triggered_) {
+        last_error_ = configureTriggers(output_mask_, 0, true);
+        checkInit("sbgSetTriggeredMode");
+
+        last_error_ = sbgSetContinuousMode(protocol_handle_, SBG_TRIGGERED_MODE_ENABLE, output_divider_);
+        checkInit("sbgSetContinuousMode: SBG_TRIGGERED_MODE_ENABLE");
+      } else {
+        last_error_ = sbgSetContinuousMode(protocol_handle_, SBG_CONTINUOUS_MODE_ENABLE, output_divider_);
+        checkInit("sbgSetContinuousMode: SBG_CONTINUOUS_MODE_ENABLE");
+      }
+    }
+
+    // Tras configurar el dispositivo, la cabecera lleva el modo de salida y la mascara efectivos
+    if (!record_path.empty())
+      startRecording();
 
     imu_pub = this->create_publisher<sensor_msgs::msg::Imu>("imu", 1);
     imu_ned_pub = this->create_publisher<sensor_msgs::msg::Imu>("imu_ned", 1);
     gps_pub = this->create_publisher<sensor_msgs::msg::NavSatFix>("gps", 1);
-    timer_ = this->create_wall_timer(std::chrono::duration<double>(1.0 / frequency), std::bind(&SBGNode::periodicTask, this));
+    mag_pub = this->create_publisher<sensor_msgs::msg::MagneticField>("mag", 1);
+    pressure_pub = this->create_publisher<sensor_msgs::msg::FluidPressure>("pressure", 1);
+    diagnostics_pub = this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 1);
+    diagnostics_timer_ = this->create_wall_timer(std::chrono::seconds(1), std::bind(&SBGNode::publishDiagnostics, this));
+    // Sin dispositivo (captura) no hay mascara que negociar
+    if (dynamic_output_mask && !replay_)
+      output_mask_timer_ = this->create_wall_timer(std::chrono::milliseconds(500), std::bind(&SBGNode::updateOutputMask, this));
+
+    if (pipeline_mode == "streaming" || pipeline_mode == "reader_thread") {
+      // Los frames continuos/disparados se decodifican en sbgCom y se publican desde el callback,
+      // nunca se hace una peticion al dispositivo
+      sbgSetContinuousRawCallback(protocol_handle_, &SBGNode::onContinuousRawFrame, this);
+      sbgSetContinuousModeCallback(protocol_handle_, &SBGNode::onContinuousFrame, this);
+      sbgSetTriggeredModeCallback(protocol_handle_, &SBGNode::onTriggeredFrame, this);
+      sbgSetContinuousErrorCallback(protocol_handle_, &SBGNode::onContinuousError, this);
+      streaming_ = true;
+      if (pipeline_mode == "streaming")  // el timer solo vacia el puerto serie
+        timer_ = this->create_wall_timer(std::chrono::duration<double>(1.0 / frequency), std::bind(&SBGNode::drainTask, this));
+    } else {
+      timer_ = this->create_wall_timer(std::chrono::duration<double>(1.0 / frequency), std::bind(&SBGNode::periodicTask, this));
+    }
 
     // Constants values
+    imu_template_.header.frame_id = imu_frame_id;
+    imu_ned_template_.header.frame_id = imu_frame_ned_id;
+    gps_template_.header.frame_id = gps_frame_id;
+    mag_template_.header.frame_id = imu_frame_ned_id;
+    pressure_template_.header.frame_id = imu_frame_id;
+
     for (int i = 0; i < 9; i++) {
-        imu_msg->orientation_covariance[i] = 0;
-        imu_msg->angular_velocity_covariance[i] = 0;
-        imu_msg->linear_acceleration_covariance[i] = 0;
+        imu_template_.orientation_covariance[i] = 0;
+        imu_template_.angular_velocity_covariance[i] = 0;
+        imu_template_.linear_acceleration_covariance[i] = 0;
     }
     
     for (int i = 0; i < 9; i+=3) {
-        imu_msg->orientation_covariance[i] = IMU_COVARIANCES[0];
-        imu_msg->angular_velocity_covariance[i] = IMU_COVARIANCES[1];
-        imu_msg->linear_acceleration_covariance[i] = IMU_COVARIANCES[2];
+        imu_template_.orientation_covariance[i] = IMU_COVARIANCES[0];
+        imu_template_.angular_velocity_covariance[i] = IMU_COVARIANCES[1];
+        imu_template_.linear_acceleration_covariance[i] = IMU_COVARIANCES[2];
     }
 
     for (int i = 0; i < 9; i++) {
-        imu_ned_msg->orientation_covariance[i] = 0;
-        imu_ned_msg->angular_velocity_covariance[i] = 0;
-        imu_ned_msg->linear_acceleration_covariance[i] = 0;
+        imu_ned_template_.orientation_covariance[i] = 0;
+        imu_ned_template_.angular_velocity_covariance[i] = 0;
+        imu_ned_template_.linear_acceleration_covariance[i] = 0;
     }
     
     for (int i = 0; i < 9; i+=3) {
-        imu_ned_msg->orientation_covariance[i] = IMU_COVARIANCES[0];
-        imu_ned_msg->angular_velocity_covariance[i] = IMU_COVARIANCES[1];
-        imu_ned_msg->linear_acceleration_covariance[i] = IMU_COVARIANCES[2];
+        imu_ned_template_.orientation_covariance[i] = IMU_COVARIANCES[0];
+        imu_ned_template_.angular_velocity_covariance[i] = IMU_COVARIANCES[1];
+        imu_ned_template_.linear_acceleration_covariance[i] = IMU_COVARIANCES[2];
     }
 
     IMU2ROS.setValue(1.0,  0.0,  0.0,
@@ -222,13 +1127,29 @@ public:
                      1.0,  0.0,  0.0,
                      0.0,  0.0, -1.0);
 
-    RCLCPP_INFO(this->get_logger(), "SBG node started");
+    // Los mensajes ya estan inicializados, el hilo de publicacion puede usarlos
+    if (pipeline_mode == "reader_thread")
+      startReaderThread();
+
+    RCLCPP_INFO(this->get_logger(), "SBG node started (%s, %s output, intra-process %s, loaned messages: %s)",
+                pipeline_mode.c_str(), output_routing.c_str(),
+                this->get_node_options().use_intra_process_comms() ? "on" : "off", loanStatus().c_str());
   }
 
   // Destructor
   ~SBGNode() {
-    last_error_ = sbgSetContinuousMode(protocol_handle_, SBG_CONT_TRIGGER_MODE_DISABLE, 1);
-    if(checkError("sbgSetContinuousMode: SBG_CONT_TRIGGER_MODE_DISABLE")) return;
+    // Los frames que lleguen mientras se desactiva el modo continuo ya no se publican
+    streaming_ = false;
+    stopReaderThread();
+    stopRecording();
+
+    if (protocol_handle_ == SBG_INVALID_PROTOCOL_HANDLE) return;
+
+    // Aunque el dispositivo no conteste, el puerto se cierra igualmente
+    if (!replay_) {
+      last_error_ = sbgSetContinuousMode(protocol_handle_, SBG_CONT_TRIGGER_MODE_DISABLE, 1);
+      checkError("sbgSetContinuousMode: SBG_CONT_TRIGGER_MODE_DISABLE");
+    }
 
     last_error_ = sbgProtocolClose(protocol_handle_);
     if(checkError("sbgProtocolClose")) return;
@@ -237,11 +1158,7 @@ public:
   }
 };
 
-int main(int argc, char **argv)
-{
-  rclcpp::init(argc, argv);
-  rclcpp::NodeOptions options;
-  rclcpp::spin(std::make_shared<SBGNode>(options));
-  rclcpp::shutdown();
-  return 0;   
-}
\ No newline at end of file
+}  // namespace sbg
+
+// El ejecutable sbg_node lo genera rclcpp_components_register_node
+RCLCPP_COMPONENTS_REGISTER_NODE(sbg::SBGNode)
\ No newline at end of file